@@ -0,0 +1,279 @@
+#include "ipv6_sockets.h"
+#include <time.h>
+
+// Захват пакетов в файл pcapng без форматирования на пути приема.
+// Каждый поток приема пишет кадры в собственное кольцо (один писатель - один читатель, без блокировок),
+// а фоновый поток вычерпывает все кольца и пишет блоки pcapng большими порциями через буфер stdio.
+
+#define CAPTURE_RING_SIZE (4u << 20) // Размер кольца одного потока, степень двойки
+#define CAPTURE_SKIP 0xFFFFFFFFu     // Метка "остаток до конца кольца пуст, продолжить с начала"
+
+// pcapng: типы блоков и тип канального уровня
+#define PCAPNG_SHB 0x0A0D0D0Au
+#define PCAPNG_IDB 0x00000001u
+#define PCAPNG_EPB 0x00000006u
+#define PCAPNG_BYTE_ORDER_MAGIC 0x1A2B3C4Du
+// LINKTYPE_USER0: кадры начинаются с нашей структуры ipv6_header, а не с настоящего
+// заголовка IPv6 (порядок битовых полей зависит от платформы), поэтому используется
+// пользовательский тип, а разбор выполняет capture_dump.
+#define PCAPNG_LINKTYPE_USER0 147
+
+// Заголовок записи в кольце. Записи выровнены на 8 байт.
+struct capture_record
+{
+    uint32_t len;       // Сохраненная длина кадра или CAPTURE_SKIP
+    uint32_t orig_len;  // Исходная длина кадра
+    uint64_t timestamp; // Время получения, наносекунды CLOCK_REALTIME
+};
+
+// Кольцо одного потока приема
+struct capture_ring
+{
+    uint64_t head; // Позиция чтения (только фоновый поток)
+    char pad1[56]; // head и tail в разных строках кэша, чтобы писатель и читатель не мешали друг другу
+    uint64_t tail; // Позиция записи (только поток приема)
+    char pad2[56];
+    uint64_t dropped; // Кадры, не поместившиеся в кольцо
+    struct capture_ring *next;
+    char data[CAPTURE_RING_SIZE];
+};
+
+volatile int log_level = LOG_EVENTS;
+
+static volatile int capture_active = 0;
+static struct capture_ring *capture_rings = NULL; // Список колец всех потоков
+static __thread struct capture_ring *thread_ring = NULL;
+static FILE *capture_file = NULL;
+static pthread_t capture_thread;
+static uint64_t capture_written = 0;
+
+static size_t record_size(uint32_t len)
+{
+    return (sizeof(struct capture_record) + len + 7) & ~(size_t)7;
+}
+
+// Кольцо текущего потока. Создается при первом захвате в потоке и добавляется
+// в общий список CAS-операцией; кольца не удаляются до остановки захвата.
+static struct capture_ring *get_thread_ring()
+{
+    if (thread_ring)
+        return thread_ring;
+
+    struct capture_ring *ring = calloc(1, sizeof(*ring));
+    if (ring == NULL)
+        return NULL;
+
+    ring->next = __atomic_load_n(&capture_rings, __ATOMIC_ACQUIRE);
+    while (!__atomic_compare_exchange_n(&capture_rings, &ring->next, ring, 1,
+                                        __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+        ;
+
+    thread_ring = ring;
+    return ring;
+}
+
+// Копирование кадра с отметкой времени в кольцо потока. Никогда не блокирует прием:
+// если фоновый поток не успевает и места нет, кадр отбрасывается и учитывается в dropped.
+void capture_frame(const void *data, size_t len)
+{
+    if (!capture_active)
+        return;
+
+    struct capture_ring *ring = get_thread_ring();
+    if (ring == NULL)
+        return;
+
+    uint32_t stored = len > CAPTURE_SNAPLEN ? CAPTURE_SNAPLEN : (uint32_t)len;
+    size_t need = record_size(stored);
+    uint64_t tail = ring->tail;
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    size_t offset = tail & (CAPTURE_RING_SIZE - 1);
+    size_t to_end = CAPTURE_RING_SIZE - offset;
+
+    // Запись не разрывается на конце кольца: остаток помечается как пропуск
+    size_t total = need <= to_end ? need : to_end + need;
+    if (CAPTURE_RING_SIZE - (tail - head) < total)
+    {
+        ring->dropped++;
+        return;
+    }
+
+    if (need > to_end)
+    {
+        ((struct capture_record *)(ring->data + offset))->len = CAPTURE_SKIP;
+        tail += to_end;
+        offset = 0;
+    }
+
+    // clock_gettime(CLOCK_REALTIME): Выполняется через vDSO, без системного вызова.
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    struct capture_record *rec = (struct capture_record *)(ring->data + offset);
+    rec->len = stored;
+    rec->orig_len = (uint32_t)len;
+    rec->timestamp = (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+    memcpy(rec + 1, data, stored);
+
+    // RELEASE: фоновый поток увидит новое значение tail только вместе с данными записи
+    __atomic_store_n(&ring->tail, tail + need, __ATOMIC_RELEASE);
+}
+
+static void write_block_header(uint32_t type, uint32_t total_len)
+{
+    fwrite(&type, sizeof(type), 1, capture_file);
+    fwrite(&total_len, sizeof(total_len), 1, capture_file);
+}
+
+// Заголовок файла pcapng: Section Header Block и Interface Description Block
+static void write_file_header()
+{
+    uint32_t magic = PCAPNG_BYTE_ORDER_MAGIC;
+    uint16_t version[2] = {1, 0};
+    int64_t section_len = -1;
+    uint32_t shb_len = 28;
+
+    write_block_header(PCAPNG_SHB, shb_len);
+    fwrite(&magic, sizeof(magic), 1, capture_file);
+    fwrite(version, sizeof(version), 1, capture_file);
+    fwrite(&section_len, sizeof(section_len), 1, capture_file);
+    fwrite(&shb_len, sizeof(shb_len), 1, capture_file);
+
+    // Опция if_tsresol = 9: отметки времени в наносекундах
+    uint16_t link[2] = {PCAPNG_LINKTYPE_USER0, 0};
+    uint32_t snaplen = CAPTURE_SNAPLEN;
+    uint16_t tsresol_opt[2] = {9, 1};
+    uint8_t tsresol[4] = {9, 0, 0, 0};
+    uint32_t end_of_opt = 0;
+    uint32_t idb_len = 32;
+
+    write_block_header(PCAPNG_IDB, idb_len);
+    fwrite(link, sizeof(link), 1, capture_file);
+    fwrite(&snaplen, sizeof(snaplen), 1, capture_file);
+    fwrite(tsresol_opt, sizeof(tsresol_opt), 1, capture_file);
+    fwrite(tsresol, sizeof(tsresol), 1, capture_file);
+    fwrite(&end_of_opt, sizeof(end_of_opt), 1, capture_file);
+    fwrite(&idb_len, sizeof(idb_len), 1, capture_file);
+}
+
+// Enhanced Packet Block для одной записи
+static void write_packet(const struct capture_record *rec)
+{
+    static const char zeros[4] = {0};
+    uint32_t padded = (rec->len + 3) & ~3u;
+    uint32_t total_len = 32 + padded;
+    uint32_t fields[5] = {0, (uint32_t)(rec->timestamp >> 32), (uint32_t)rec->timestamp,
+                          rec->len, rec->orig_len};
+
+    write_block_header(PCAPNG_EPB, total_len);
+    fwrite(fields, sizeof(fields), 1, capture_file);
+    fwrite(rec + 1, 1, rec->len, capture_file);
+    fwrite(zeros, 1, padded - rec->len, capture_file);
+    fwrite(&total_len, sizeof(total_len), 1, capture_file);
+}
+
+// Вычерпывание всех колец. Возвращает число записанных кадров.
+static size_t drain_rings()
+{
+    size_t count = 0;
+
+    for (struct capture_ring *ring = __atomic_load_n(&capture_rings, __ATOMIC_ACQUIRE); ring; ring = ring->next)
+    {
+        uint64_t head = ring->head;
+        uint64_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+        while (head != tail)
+        {
+            size_t offset = head & (CAPTURE_RING_SIZE - 1);
+            const struct capture_record *rec = (const struct capture_record *)(ring->data + offset);
+
+            if (rec->len == CAPTURE_SKIP)
+            {
+                head += CAPTURE_RING_SIZE - offset;
+                continue;
+            }
+
+            write_packet(rec);
+            head += record_size(rec->len);
+            count++;
+        }
+
+        // RELEASE: поток приема может переиспользовать место только после того, как запись прочитана
+        __atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+    }
+
+    capture_written += count;
+    return count;
+}
+
+// Фоновый поток записи
+static void *capture_writer(void *arg)
+{
+    (void)arg;
+
+    while (capture_active)
+    {
+        if (drain_rings() == 0)
+        {
+            // Кольца пусты: накопленное сбрасывается на диск, поток засыпает на 1 мс
+            fflush(capture_file);
+            usleep(1000);
+        }
+    }
+
+    drain_rings();
+    return NULL;
+}
+
+// Запуск захвата в файл pcapng
+int capture_start(const char *path)
+{
+    if ((capture_file = fopen(path, "wb")) == NULL)
+    {
+        perror("Ошибка открытия файла захвата");
+        return -1;
+    }
+
+    // setvbuf: Буфер stdio 1 МБ - блоки pcapng уходят в файл крупными вызовами write.
+    setvbuf(capture_file, NULL, _IOFBF, 1 << 20);
+    write_file_header();
+
+    capture_active = 1;
+    if (pthread_create(&capture_thread, NULL, capture_writer, NULL))
+    {
+        perror("Ошибка создания потока захвата");
+        capture_active = 0;
+        fclose(capture_file);
+        capture_file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+// Остановка захвата: фоновый поток записывает оставшиеся кадры, кольца освобождаются.
+// Вызывается после остановки потоков приема.
+void capture_stop()
+{
+    if (capture_file == NULL)
+        return;
+
+    capture_active = 0;
+    pthread_join(capture_thread, NULL);
+
+    uint64_t dropped = 0;
+    struct capture_ring *ring = capture_rings;
+    while (ring)
+    {
+        struct capture_ring *next = ring->next;
+        dropped += ring->dropped;
+        free(ring);
+        ring = next;
+    }
+    capture_rings = NULL;
+
+    fclose(capture_file);
+    capture_file = NULL;
+
+    if (log_level >= LOG_EVENTS)
+        printf("Захват: записано %lu кадров, отброшено %lu\n", capture_written, dropped);
+}
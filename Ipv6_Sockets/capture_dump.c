@@ -0,0 +1,122 @@
+#include "ipv6_sockets.h"
+#include <time.h>
+
+// Разбор файла pcapng, записанного сервером с параметром --capture.
+// Форматирование пакетов выполняется здесь, вне пути приема, теми же функциями print_frame.
+
+#define PCAPNG_SHB 0x0A0D0D0Au
+#define PCAPNG_EPB 0x00000006u
+
+// Заголовок любого блока pcapng
+struct block_header
+{
+    uint32_t type;
+    uint32_t total_len;
+};
+
+// Вывод отметки времени (наносекунды с начала эпохи)
+static void print_timestamp(uint64_t timestamp)
+{
+    time_t seconds = timestamp / 1000000000ull;
+    struct tm tm;
+    char text[32];
+
+    // localtime_r: Потокобезопасное преобразование времени в календарное по местному часовому поясу.
+    localtime_r(&seconds, &tm);
+    strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &tm);
+    printf("%s.%09lu", text, (unsigned long)(timestamp % 1000000000ull));
+}
+
+// Разбор одного Enhanced Packet Block
+static void dump_packet(const char *body, size_t body_len, unsigned long number)
+{
+    uint32_t fields[5]; // interface_id, ts_high, ts_low, captured_len, orig_len
+
+    if (body_len < sizeof(fields))
+    {
+        printf("Пакет %lu: поврежденный блок\n", number);
+        return;
+    }
+    memcpy(fields, body, sizeof(fields));
+
+    uint64_t timestamp = ((uint64_t)fields[1] << 32) | fields[2];
+    uint32_t captured = fields[3];
+    if (captured > body_len - sizeof(fields))
+        captured = body_len - sizeof(fields);
+
+    printf("\n##### Пакет %lu, ", number);
+    print_timestamp(timestamp);
+    printf(", %u из %u байт #####", captured, fields[4]);
+
+    struct ipv6_frame frame;
+    if (ipv6_frame_parse(body + sizeof(fields), captured, &frame) == 1)
+        print_frame(&frame);
+    else
+        printf("\nКадр не распознан как IPv6\n");
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Использование: %s FILE.pcapng\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if (file == NULL)
+    {
+        perror("Ошибка открытия файла");
+        return 1;
+    }
+
+    struct block_header block;
+    char *body = NULL;
+    size_t body_capacity = 0;
+    unsigned long packets = 0;
+    int first = 1;
+
+    while (fread(&block, sizeof(block), 1, file) == 1)
+    {
+        if (first && block.type != PCAPNG_SHB)
+        {
+            fprintf(stderr, "Файл не является pcapng\n");
+            break;
+        }
+        first = 0;
+
+        // total_len включает заголовок блока и завершающую копию длины
+        if (block.total_len < sizeof(block) + sizeof(uint32_t) || block.total_len % 4 != 0)
+        {
+            fprintf(stderr, "Поврежденный блок длиной %u\n", block.total_len);
+            break;
+        }
+
+        size_t body_len = block.total_len - sizeof(block);
+        if (body_len > body_capacity)
+        {
+            char *grown = realloc(body, body_len);
+            if (grown == NULL)
+            {
+                perror("Ошибка выделения памяти");
+                break;
+            }
+            body = grown;
+            body_capacity = body_len;
+        }
+
+        if (fread(body, 1, body_len, file) != body_len)
+        {
+            fprintf(stderr, "Файл обрезан\n");
+            break;
+        }
+
+        if (block.type == PCAPNG_EPB)
+            dump_packet(body, body_len - sizeof(uint32_t), ++packets);
+    }
+
+    printf("\nВсего пакетов: %lu\n", packets);
+    free(body);
+    fclose(file);
+    return 0;
+}
@@ -0,0 +1,186 @@
+#include "ipv6_sockets.h"
+
+// Таблица соединений: растущий массив записей client_t, разбитый на блоки по CONN_CHUNK_SIZE.
+// Блоки выделяются по мере необходимости и никогда не перемещаются, поэтому указатель на запись
+// остается действительным все время работы сервера. Свободные записи образуют стек Трайбера
+// (lock-free список), а номер поколения в дескрипторе защищает от обращения к уже освобожденной
+// и повторно выданной записи.
+struct conn_table connections;
+
+// Вершина списка свободных записей хранится как (метка << 32) | (индекс + 1).
+// Метка увеличивается при каждом изменении вершины и исключает проблему ABA при CAS.
+#define FREE_INDEX(head) ((uint32_t)((head) & 0xFFFFFFFFu))
+#define FREE_TAG(head) ((head) >> 32)
+#define FREE_HEAD(tag, slot) (((uint64_t)(tag) << 32) | (slot))
+#define FREE_NONE 0xFFFFFFFFu
+
+#define HANDLE_INDEX(handle) ((uint32_t)((handle) & 0xFFFFFFFFu))
+#define HANDLE_GENERATION(handle) ((uint32_t)((handle) >> 32))
+
+// Адрес записи по индексу: O(1), без блокировок
+static client_t *conn_slot(struct conn_table *table, uint32_t index)
+{
+    client_t *chunk = __atomic_load_n(&table->chunks[index >> CONN_CHUNK_SHIFT], __ATOMIC_ACQUIRE);
+    return chunk ? &chunk[index & (CONN_CHUNK_SIZE - 1)] : NULL;
+}
+
+// Выделение блока записей, если его еще нет. Несколько потоков могут одновременно
+// попытаться создать один и тот же блок - публикуется только первый, остальные освобождаются.
+static client_t *conn_chunk(struct conn_table *table, uint32_t chunk_index)
+{
+    client_t *chunk = __atomic_load_n(&table->chunks[chunk_index], __ATOMIC_ACQUIRE);
+    if (chunk)
+        return chunk;
+
+    client_t *fresh = calloc(CONN_CHUNK_SIZE, sizeof(client_t));
+    if (fresh == NULL)
+        return NULL;
+    for (uint32_t i = 0; i < CONN_CHUNK_SIZE; i++)
+    {
+        fresh[i].sockfd = -1;
+        fresh[i].generation = 1;
+        fresh[i].next_free = FREE_NONE;
+    }
+
+    client_t *expected = NULL;
+    if (__atomic_compare_exchange_n(&table->chunks[chunk_index], &expected, fresh, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return fresh;
+
+    free(fresh);
+    return expected;
+}
+
+void conn_table_init(struct conn_table *table)
+{
+    memset(table, 0, sizeof(*table));
+}
+
+// Освобождение всех блоков. Вызывается, когда ни один поток уже не работает с таблицей.
+void conn_table_destroy(struct conn_table *table)
+{
+    for (uint32_t i = 0; i < CONN_MAX_CHUNKS; i++)
+    {
+        if (table->chunks[i] == NULL)
+            continue;
+        for (uint32_t j = 0; j < CONN_CHUNK_SIZE; j++)
+            frame_ring_free(&table->chunks[i][j].ring);
+        free(table->chunks[i]);
+        table->chunks[i] = NULL;
+    }
+    table->free_head = 0;
+    table->next_unused = 0;
+    table->active = 0;
+}
+
+// Получение свободной записи. Сначала берется запись из списка свободных,
+// если он пуст - следующая ни разу не использованная запись (при необходимости в новом блоке).
+// Возвращает NULL, если таблица заполнена или не хватило памяти.
+client_t *conn_table_acquire(struct conn_table *table)
+{
+    client_t *slot = NULL;
+    uint64_t head = __atomic_load_n(&table->free_head, __ATOMIC_ACQUIRE);
+
+    while (FREE_INDEX(head) != 0)
+    {
+        uint32_t index = FREE_INDEX(head) - 1;
+        client_t *candidate = conn_slot(table, index);
+        uint32_t next = __atomic_load_n(&candidate->next_free, __ATOMIC_RELAXED);
+        uint64_t new_head = FREE_HEAD(FREE_TAG(head) + 1, next == FREE_NONE ? 0 : next + 1);
+
+        // Если между чтением вершины и CAS другой поток изменил список, метка не совпадет,
+        // head перечитается, и попытка повторится.
+        if (__atomic_compare_exchange_n(&table->free_head, &head, new_head, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        {
+            slot = candidate;
+            break;
+        }
+    }
+
+    if (slot == NULL)
+    {
+        uint32_t index = __atomic_fetch_add(&table->next_unused, 1, __ATOMIC_RELAXED);
+        if (index >= CONN_MAX_CHUNKS * CONN_CHUNK_SIZE)
+        {
+            __atomic_fetch_sub(&table->next_unused, 1, __ATOMIC_RELAXED);
+            errno = ENOSPC;
+            return NULL;
+        }
+
+        client_t *chunk = conn_chunk(table, index >> CONN_CHUNK_SHIFT);
+        if (chunk == NULL)
+        {
+            // Индекс уже занят счетчиком - возвращать его некуда, поэтому он просто пропускается.
+            errno = ENOMEM;
+            return NULL;
+        }
+        slot = &chunk[index & (CONN_CHUNK_SIZE - 1)];
+        slot->index = index;
+    }
+
+    slot->handle = ((uint64_t)slot->generation << 32) | slot->index;
+    __atomic_add_fetch(&table->active, 1, __ATOMIC_RELAXED);
+    return slot;
+}
+
+// Возврат записи в список свободных. Поколение увеличивается, поэтому все ранее
+// выданные дескрипторы этой записи перестают находиться через conn_table_get.
+void conn_table_release(struct conn_table *table, client_t *slot)
+{
+    uint32_t generation = slot->generation + 1;
+    if (generation == 0)
+        generation = 1; // Поколение 0 зарезервировано: дескриптор 0 всегда недействителен
+
+    // Отображение буфера кадров сохраняется для следующего соединения в этой записи,
+    // чтобы не создавать его заново (memfd_create и три mmap) на каждое подключение.
+    slot->ring.head = 0;
+    slot->ring.tail = 0;
+    slot->sockfd = -1;
+    __atomic_store_n(&slot->generation, generation, __ATOMIC_RELEASE);
+
+    uint64_t head = __atomic_load_n(&table->free_head, __ATOMIC_ACQUIRE);
+    uint64_t new_head;
+    do
+    {
+        uint32_t top = FREE_INDEX(head);
+        __atomic_store_n(&slot->next_free, top == 0 ? FREE_NONE : top - 1, __ATOMIC_RELAXED);
+        new_head = FREE_HEAD(FREE_TAG(head) + 1, slot->index + 1);
+    } while (!__atomic_compare_exchange_n(&table->free_head, &head, new_head, 1,
+                                          __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+
+    __atomic_sub_fetch(&table->active, 1, __ATOMIC_RELAXED);
+}
+
+// Поиск записи по дескриптору за O(1). Возвращает NULL, если запись уже освобождена.
+client_t *conn_table_get(struct conn_table *table, conn_handle_t handle)
+{
+    uint32_t index = HANDLE_INDEX(handle);
+
+    if (index >= __atomic_load_n(&table->next_unused, __ATOMIC_ACQUIRE))
+        return NULL;
+
+    client_t *slot = conn_slot(table, index);
+    if (slot == NULL || __atomic_load_n(&slot->generation, __ATOMIC_ACQUIRE) != HANDLE_GENERATION(handle))
+        return NULL;
+    return slot;
+}
+
+// Число занятых записей (атомарный счетчик, без блокировок)
+int conn_table_active(struct conn_table *table)
+{
+    return __atomic_load_n(&table->active, __ATOMIC_RELAXED);
+}
+
+// Обход занятых записей. Используется при остановке сервера, а не на горячем пути.
+void conn_table_foreach(struct conn_table *table, void (*fn)(client_t *client, void *arg), void *arg)
+{
+    uint32_t used = __atomic_load_n(&table->next_unused, __ATOMIC_ACQUIRE);
+
+    for (uint32_t index = 0; index < used; index++)
+    {
+        client_t *slot = conn_slot(table, index);
+        if (slot && slot->sockfd != -1)
+            fn(slot, arg);
+    }
+}
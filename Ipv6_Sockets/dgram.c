@@ -0,0 +1,416 @@
+#include "ipv6_sockets.h"
+#include <signal.h>
+#include <netinet/udp.h>
+
+// Датаграммный режим (UDP). Каждое сообщение протокола - самостоятельный кадр
+// ipv6_header + dest_options + данные, поэтому одна датаграмма несет ровно один кадр:
+// не нужны ни состояние соединения, ни буфер сборки кадров, а потеря одного сообщения
+// не задерживает остальные (нет блокировки очереди, как в TCP).
+// recvmmsg/sendmmsg передают десятки датаграмм за один системный вызов.
+// С параметром --gso отправитель склеивает одинаковые по размеру сообщения в одну
+// "большую" датаграмму (UDP GSO), которую ядро режет на части уже после прохода по стеку,
+// а сервер с UDP GRO получает склеенные датаграммы целиком и режет их сам.
+
+#define DGRAM_BATCH 64                 // Датаграмм за один recvmmsg
+#define DGRAM_BUF_SIZE 65536           // Буфер одной датаграммы (склеенная GRO - до 64 КБ)
+#define DGRAM_MAX_SEGMENTS 64          // UDP_MAX_SEGMENTS ядра: частей в одной отправке GSO
+#define DGRAM_GSO_MAX_BYTES (65535 - 8) // Поле длины IPv6 минус заголовок UDP
+#define DGRAM_LINE_SIZE 4096           // Максимальная длина строки клиента
+#define DGRAM_MAX_WORKERS 256
+
+// Поток приема датаграмм со своим сокетом SO_REUSEPORT
+struct dgram_worker
+{
+    int id;
+    int fd;
+    pthread_t thread;
+    const struct server_config *config;
+    uint64_t datagrams; // Принято датаграмм (склеенная GRO считается одной)
+    uint64_t frames;    // Передано обработчику кадров
+    uint64_t errors;    // Датаграмм, не являющихся целым кадром IPv6
+    uint64_t syscalls;  // Вызовов recvmmsg
+};
+
+static int dgram_fds[DGRAM_MAX_WORKERS];
+static int dgram_fd_count = 0;
+
+// Остановка по SIGINT/SIGTERM. shutdown(SHUT_RD) будит потоки, ожидающие в recvmmsg;
+// функция безопасна для вызова из обработчика сигнала.
+static void handle_dgram_stop(int sig)
+{
+    (void)sig;
+    server_active = 0;
+    for (int i = 0; i < dgram_fd_count; i++)
+        shutdown(dgram_fds[i], SHUT_RD);
+}
+
+// Создание сокета UDP, привязанного к порту сервера
+static int open_dgram_socket(int reuseport, int gro)
+{
+    struct sockaddr_in6 addr;
+    int one = 1;
+
+    // SOCK_DGRAM: Сокет датаграмм (UDP). Границы сообщений сохраняются ядром.
+    int fd = socket(AF_INET6, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        perror("Ошибка создания IPv6 сокета UDP");
+        exit(EXIT_FAILURE);
+    }
+
+    if (setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &one, sizeof(one)))
+        perror("Ошибка IPV6_V6ONLY");
+
+    // SO_REUSEPORT: У каждого потока свой сокет, ядро распределяет датаграммы по хешу адресов отправителя.
+    if (reuseport && setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)))
+    {
+        perror("Ошибка SO_REUSEPORT");
+        exit(EXIT_FAILURE);
+    }
+
+    // UDP_GRO: Сокет готов принимать склеенные датаграммы; размер части приходит в cmsg UDP_GRO.
+    if (gro && setsockopt(fd, SOL_UDP, UDP_GRO, &one, sizeof(one)))
+        perror("Ошибка UDP_GRO");
+
+    // SO_RCVBUF: Больший буфер приема сглаживает всплески, пока поток обрабатывает пачку.
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_addr = in6addr_any;
+    addr.sin6_port = htons(PORT);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("Ошибка привязки IPv6 сокета UDP");
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+// Кадры пачки recvmmsg (с GRO - части склеенных датаграмм) перед проверкой и разбором
+struct dgram_batch
+{
+    struct iovec frames[64];
+    int source[64]; // Номер датаграммы в пачке: по нему берется адрес отправителя
+    int count;
+};
+
+// Пакетная проверка заголовков накопленных кадров (ipv6_validate_batch) и передача
+// обработчику прошедших проверку. Каждая часть должна содержать ровно один целый кадр.
+static void dgram_deliver(struct dgram_worker *worker, struct dgram_batch *batch, client_t *peer,
+                          const struct sockaddr_in6 *addrs)
+{
+    uint64_t valid = ipv6_validate_batch(batch->frames, batch->count);
+    struct ipv6_frame frame;
+
+    for (int i = 0; i < batch->count; i++)
+    {
+        if (!(valid >> i & 1) || ipv6_frame_parse(batch->frames[i].iov_base, batch->frames[i].iov_len, &frame) != 1)
+        {
+            worker->errors++;
+            continue;
+        }
+
+        peer->addr = addrs[batch->source[i]];
+        worker->frames++;
+        worker->config->on_packet(peer, &frame);
+    }
+    batch->count = 0;
+}
+
+// Цикл потока приема: пачка датаграмм за один recvmmsg
+static void *dgram_worker_loop(void *arg)
+{
+    struct dgram_worker *worker = (struct dgram_worker *)arg;
+    struct mmsghdr msgs[DGRAM_BATCH];
+    struct iovec iovs[DGRAM_BATCH];
+    struct sockaddr_in6 addrs[DGRAM_BATCH];
+    char control[DGRAM_BATCH][CMSG_SPACE(sizeof(int))];
+    char *buffers = malloc((size_t)DGRAM_BATCH * DGRAM_BUF_SIZE);
+    struct dgram_batch batch;
+    client_t peer;
+
+    if (buffers == NULL)
+    {
+        perror("Ошибка выделения памяти для приема");
+        return NULL;
+    }
+
+    // У датаграмм нет записи в таблице соединений: обработчик получает временную запись
+    // с сокетом сервера и адресом отправителя.
+    memset(&peer, 0, sizeof(peer));
+    peer.sockfd = worker->fd;
+    peer.thread_id = pthread_self();
+    peer.owner = worker->id;
+    batch.count = 0;
+
+    while (server_active)
+    {
+        // Ядро изменяет длины адреса и управляющих данных, поэтому они восстанавливаются перед каждым вызовом
+        for (int i = 0; i < DGRAM_BATCH; i++)
+        {
+            iovs[i].iov_base = buffers + (size_t)i * DGRAM_BUF_SIZE;
+            iovs[i].iov_len = DGRAM_BUF_SIZE;
+            memset(&msgs[i].msg_hdr, 0, sizeof(msgs[i].msg_hdr));
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(addrs[i]);
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+
+        // recvmmsg: Прием нескольких датаграмм одним системным вызовом.
+        // MSG_WAITFORONE: Ждать только первую датаграмму, остальные забрать, если они уже есть.
+        count_syscall();
+        worker->syscalls++;
+        int n = recvmmsg(worker->fd, msgs, DGRAM_BATCH, MSG_WAITFORONE, NULL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (server_active)
+                perror("Ошибка recvmmsg");
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            const char *data = iovs[i].iov_base;
+            size_t len = msgs[i].msg_len;
+            size_t segment = len;
+
+            if (len == 0)
+                continue;
+
+            // cmsg UDP_GRO: датаграмма склеена из частей размером segment (последняя может быть короче)
+            for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cm; cm = CMSG_NXTHDR(&msgs[i].msg_hdr, cm))
+            {
+                if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO)
+                    segment = *(int *)CMSG_DATA(cm);
+            }
+
+            worker->datagrams++;
+            for (size_t off = 0; off < len; off += segment)
+            {
+                batch.frames[batch.count].iov_base = (void *)(data + off);
+                batch.frames[batch.count].iov_len = len - off < segment ? len - off : segment;
+                batch.source[batch.count] = i;
+                if (++batch.count == 64)
+                    dgram_deliver(worker, &batch, &peer, addrs);
+            }
+        }
+        if (batch.count)
+            dgram_deliver(worker, &batch, &peer, addrs);
+    }
+
+    free(buffers);
+    return NULL;
+}
+
+// Запуск датаграммного сервера: N потоков, у каждого свой сокет SO_REUSEPORT
+void start_dgram_server(const struct server_config *config)
+{
+    int workers = config->workers;
+    if (workers <= 0)
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (workers <= 0)
+        workers = 1;
+    if (workers > DGRAM_MAX_WORKERS)
+        workers = DGRAM_MAX_WORKERS;
+
+    struct dgram_worker *pool = calloc(workers, sizeof(*pool));
+    if (pool == NULL)
+    {
+        perror("Ошибка выделения памяти для рабочих потоков");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < workers; i++)
+    {
+        pool[i].id = i;
+        pool[i].config = config;
+        pool[i].fd = open_dgram_socket(workers > 1, config->gso);
+        dgram_fds[i] = pool[i].fd;
+    }
+    dgram_fd_count = workers;
+    server_active = 1;
+
+    // sigaction без SA_RESTART: recvmmsg прерывается сигналом и не перезапускается
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_dgram_stop;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    printf("Сервер IPv6 (UDP) запущен на порту %d\n", PORT);
+    printf("Прием датаграмм: %d рабочих потоков%s\n", workers, config->gso ? ", UDP GRO" : "");
+
+    for (int i = 0; i < workers; i++)
+    {
+        int err = pthread_create(&pool[i].thread, NULL, dgram_worker_loop, &pool[i]);
+        if (err)
+        {
+            errno = err;
+            perror("Ошибка создания рабочего потока");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    uint64_t datagrams = 0, frames = 0, errors = 0, syscalls = 0;
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_join(pool[i].thread, NULL);
+        close(pool[i].fd);
+        datagrams += pool[i].datagrams;
+        frames += pool[i].frames;
+        errors += pool[i].errors;
+        syscalls += pool[i].syscalls;
+    }
+    dgram_fd_count = 0;
+    free(pool);
+
+    if (log_level >= LOG_EVENTS)
+        printf("Принято датаграмм: %lu, кадров: %lu, ошибочных: %lu, вызовов recvmmsg: %lu\n",
+               datagrams, frames, errors, syscalls);
+    printf("Сервер IPv6 (UDP) остановлен\n");
+}
+
+// Длина кадра k в очереди отправителя и число его iovec
+static size_t queued_frame_len(const struct ipv6_sender *sender, int k, int *iov_count)
+{
+    size_t len = sizeof(struct ipv6_header) + ntohs(sender->headers[k].fields.payload_len);
+    *iov_count = len > sizeof(struct ipv6_header) + sender->options_len ? 3 : 2;
+    return len;
+}
+
+// Отправка очереди отправителя датаграммами: каждое сообщение - отдельная датаграмма,
+// вся очередь уходит одним sendmmsg. При gso подряд идущие сообщения одинаковой длины
+// объединяются в одну отправку с cmsg UDP_SEGMENT. Возвращает число датаграмм или -1.
+int dgram_flush(struct ipv6_sender *sender, int gso)
+{
+    struct mmsghdr msgs[SENDER_MAX_QUEUE];
+    char control[SENDER_MAX_QUEUE][CMSG_SPACE(sizeof(uint16_t))];
+    int count = 0;
+    int iov_index = 0;
+    int result = sender->queued;
+
+    for (int k = 0; k < sender->queued; count++)
+    {
+        struct msghdr *msg = &msgs[count].msg_hdr;
+        int iovs;
+        size_t len = queued_frame_len(sender, k, &iovs);
+        size_t total = len;
+        int segments = 1;
+
+        memset(msg, 0, sizeof(*msg));
+        msg->msg_iov = &sender->iov[iov_index];
+        msg->msg_iovlen = iovs;
+        iov_index += iovs;
+        k++;
+
+        // GSO: части должны быть одного размера и вместе не превышать максимальную датаграмму
+        while (gso && k < sender->queued && segments < DGRAM_MAX_SEGMENTS)
+        {
+            int next_iovs;
+            if (queued_frame_len(sender, k, &next_iovs) != len || total + len > DGRAM_GSO_MAX_BYTES)
+                break;
+            msg->msg_iovlen += next_iovs;
+            iov_index += next_iovs;
+            total += len;
+            segments++;
+            k++;
+        }
+
+        if (segments > 1)
+        {
+            // UDP_SEGMENT: Размер части, на которые ядро разрежет эту отправку
+            msg->msg_control = control[count];
+            msg->msg_controllen = sizeof(control[count]);
+            struct cmsghdr *cm = CMSG_FIRSTHDR(msg);
+            cm->cmsg_level = SOL_UDP;
+            cm->cmsg_type = UDP_SEGMENT;
+            cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            *(uint16_t *)CMSG_DATA(cm) = (uint16_t)len;
+        }
+    }
+
+    sender->queued = 0;
+    sender->iov_first = 0;
+    sender->iov_count = 0;
+    sender->queued_bytes = 0;
+
+    for (int sent = 0; sent < count;)
+    {
+        // sendmmsg: Отправка нескольких датаграмм одним системным вызовом.
+        count_syscall();
+        int n = sendmmsg(sender->sockfd, msgs + sent, count - sent, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        sender->syscalls++;
+        sent += n;
+    }
+
+    return result;
+}
+
+// Клиент датаграммного режима. В интерактивном режиме каждая строка отправляется сразу,
+// а при вводе из файла или канала строки накапливаются и уходят пачками по SENDER_MAX_QUEUE.
+void start_dgram_client(const char *ipv6_addr, int gso)
+{
+    int sockfd;
+    uint64_t datagrams = 0;
+
+    // static: Строки очереди должны жить до отправки, а очередь отправителя велика для стека.
+    static struct ipv6_sender sender;
+    static char lines[SENDER_MAX_QUEUE][DGRAM_LINE_SIZE];
+
+    connect_to_ipv6_server(ipv6_addr, &sockfd, SOCK_DGRAM);
+    ipv6_sender_init(&sender, sockfd, 0);
+
+    // isatty: Проверяет, связан ли дескриптор с терминалом.
+    int interactive = isatty(STDIN_FILENO);
+
+    while (1)
+    {
+        if (interactive)
+        {
+            printf("> ");
+            fflush(stdout);
+        }
+
+        char *line = lines[sender.queued];
+        if (fgets(line, DGRAM_LINE_SIZE, stdin) == NULL)
+            break;
+        line[strcspn(line, "\n")] = '\0';
+        if (strcmp(line, "exit") == 0)
+            break;
+
+        ipv6_sender_queue(&sender, line, strlen(line));
+        if (interactive || sender.queued == SENDER_MAX_QUEUE)
+        {
+            int sent = dgram_flush(&sender, gso);
+            if (sent < 0)
+                perror("Ошибка отправки датаграмм");
+            else
+                datagrams += sent;
+        }
+    }
+
+    if (sender.queued > 0)
+    {
+        int sent = dgram_flush(&sender, gso);
+        if (sent < 0)
+            perror("Ошибка отправки датаграмм");
+        else
+            datagrams += sent;
+    }
+
+    close(sockfd);
+    printf("Отправлено сообщений: %lu, вызовов sendmmsg: %lu\n", datagrams, sender.syscalls);
+}
@@ -0,0 +1,456 @@
+#include "ipv6_sockets.h"
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <sched.h>
+#include <linux/filter.h>
+
+#define MAX_EVENTS 256
+
+static int stop_fd = -1;
+
+// Перевод дескриптора в неблокирующий режим
+static int set_nonblocking(int fd)
+{
+    // fcntl(F_GETFL/F_SETFL): Читает и изменяет флаги открытого файла.
+    // O_NONBLOCK: Вызовы accept/recv возвращают EAGAIN вместо блокировки, когда данных нет.
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0)
+        return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+// Поднимает мягкий лимит открытых файлов до жесткого, чтобы обслуживать тысячи соединений
+static void raise_fd_limit()
+{
+    struct rlimit rl;
+
+    // getrlimit/setrlimit: Чтение и изменение ограничений ресурсов процесса.
+    // RLIMIT_NOFILE: Максимальное число открытых файловых дескрипторов.
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max)
+    {
+        rl.rlim_cur = rl.rlim_max;
+        if (setrlimit(RLIMIT_NOFILE, &rl))
+            perror("Ошибка setrlimit");
+    }
+}
+
+static void handle_stop_signal(int sig)
+{
+    (void)sig;
+    stop_event_server();
+}
+
+// Закрытие соединения и возврат его записи в таблицу
+void close_conn(client_t *client)
+{
+    if (log_level >= LOG_EVENTS)
+    {
+        char client_ip[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &client->addr.sin6_addr, client_ip, sizeof(client_ip));
+        printf("IPv6 клиент отключен: %s\n", client_ip);
+    }
+
+    // close: Закрытие дескриптора автоматически удаляет его из всех наборов epoll.
+    count_syscall();
+    close(client->sockfd);
+    conn_table_release(&connections, client);
+}
+
+// Закрытие соединений, оставшихся после остановки рабочих потоков
+static void close_remaining(client_t *client, void *arg)
+{
+    (void)arg;
+    close_conn(client);
+}
+
+// Занятие записи таблицы для принятого соединения. Буфер кадров создается при первом
+// использовании записи и остается за ней, так что повторные подключения обходятся без mmap.
+// При ошибке сокет закрывается и возвращается NULL.
+client_t *open_conn(struct event_worker *worker, int fd, const struct sockaddr_in6 *addr)
+{
+    client_t *client = conn_table_acquire(&connections);
+    if (client == NULL || (client->ring.data == NULL && frame_ring_init(&client->ring) < 0))
+    {
+        perror("Ошибка выделения памяти для соединения");
+        close(fd);
+        if (client)
+            conn_table_release(&connections, client);
+        return NULL;
+    }
+    client->sockfd = fd;
+    client->addr = *addr;
+    client->thread_id = pthread_self();
+    client->owner = worker->id;
+    return client;
+}
+
+// Прием всех ожидающих подключений. Слушающий сокет зарегистрирован в режиме
+// edge-triggered, поэтому очередь нужно вычерпать до EAGAIN.
+static void accept_ready(struct event_worker *worker)
+{
+    while (server_active)
+    {
+        struct sockaddr_in6 client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+
+        // accept4: То же, что accept, но сразу устанавливает флаги нового сокета.
+        // SOCK_NONBLOCK: Новый сокет неблокирующий. SOCK_CLOEXEC: Закрывается при exec.
+        count_syscall();
+        int client_fd = accept4(worker->listen_fd, (struct sockaddr *)&client_addr, &addr_len,
+                                SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                perror("Ошибка accept");
+            return;
+        }
+
+        client_t *client = open_conn(worker, client_fd, &client_addr);
+        if (client == NULL)
+            continue;
+
+        // EPOLLIN: Данные доступны для чтения. EPOLLRDHUP: Клиент закрыл свою сторону соединения.
+        // EPOLLET: Режим edge-triggered - уведомление приходит только при поступлении новых данных.
+        // data.u64: Дескриптор записи; устаревшее событие закрытого соединения не найдет запись.
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+        ev.data.u64 = client->handle;
+        count_syscall();
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, client_fd, &ev) < 0)
+        {
+            perror("Ошибка epoll_ctl для клиента");
+            close(client_fd);
+            conn_table_release(&connections, client);
+            continue;
+        }
+
+        if (log_level >= LOG_EVENTS)
+        {
+            char client_ip[INET6_ADDRSTRLEN];
+            inet_ntop(AF_INET6, &client_addr.sin6_addr, client_ip, sizeof(client_ip));
+            printf("IPv6 клиент подключен: %s (поток %d)\n", client_ip, worker->id);
+        }
+    }
+}
+
+// Чтение всех доступных данных соединения и передача обработчику каждого полного кадра.
+// Один recv забирает столько данных, сколько помещается в буфер, и из них разбираются все кадры.
+static void read_ready(struct event_worker *worker, client_t *client)
+{
+    struct ipv6_frame frame;
+
+    for (;;)
+    {
+        ssize_t recv_bytes = frame_ring_recv(&client->ring, client->sockfd);
+
+        if (recv_bytes > 0)
+        {
+            int status;
+            while ((status = frame_ring_next(&client->ring, &frame)) > 0)
+            {
+                worker->config->on_packet(client, &frame);
+                frame_ring_consume(&client->ring, &frame);
+            }
+
+            if (status < 0)
+            {
+                fprintf(stderr, "Поврежденный IPv6 поток, соединение закрыто\n");
+                close_conn(client);
+                return;
+            }
+            continue;
+        }
+
+        if (recv_bytes < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return;
+            perror("Ошибка чтения IPv6");
+        }
+
+        close_conn(client);
+        return;
+    }
+}
+
+// Цикл событий рабочего потока
+static void *event_worker_loop(void *arg)
+{
+    struct event_worker *worker = (struct event_worker *)arg;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (server_active)
+    {
+        // epoll_wait: Ожидает событий на зарегистрированных дескрипторах и возвращает
+        // только готовые, поэтому стоимость не зависит от общего числа соединений.
+        count_syscall();
+        int n = epoll_wait(worker->epoll_fd, events, MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Ошибка epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            uint64_t tag = events[i].data.u64;
+
+            if (tag == STOP_TAG)
+                continue;
+            if (tag == LISTEN_TAG)
+            {
+                accept_ready(worker);
+                continue;
+            }
+
+            // Поиск соединения по дескриптору за O(1)
+            client_t *client = conn_table_get(&connections, tag);
+            if (client && (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)))
+                read_ready(worker, client);
+        }
+    }
+
+    return NULL;
+}
+
+// Создание неблокирующего слушающего сокета
+static int open_listener(int reuseport)
+{
+    int fd;
+
+    setup_server_socket(&fd, reuseport);
+
+    // Повторный listen увеличивает очередь ожидающих подключений для всплесков соединений.
+    if (listen(fd, SOMAXCONN) < 0 || set_nonblocking(fd) < 0)
+    {
+        perror("Ошибка настройки слушающего сокета");
+        close(fd);
+        exit(EXIT_FAILURE);
+    }
+    return fd;
+}
+
+// Привязка выбора сокета в группе SO_REUSEPORT к ядру, обработавшему входящий SYN.
+// Программа classic BPF возвращает номер сокета: (номер ядра) % workers. Сокеты в группе
+// нумеруются в порядке bind, а сокет i принадлежит потоку, закрепленному за ядром i,
+// поэтому соединение принимается и обслуживается на том же ядре, где пришел SYN.
+static void attach_cpu_steering(int fd, int workers)
+{
+    struct sock_filter code[] = {
+        // A = номер текущего ядра
+        {BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU},
+        // A = A % workers
+        {BPF_ALU | BPF_MOD | BPF_K, 0, 0, (uint32_t)workers},
+        // return A
+        {BPF_RET | BPF_A, 0, 0, 0},
+    };
+    struct sock_fprog prog = {sizeof(code) / sizeof(code[0]), code};
+
+    // SO_ATTACH_REUSEPORT_CBPF: Программа выбора сокета для всей группы SO_REUSEPORT.
+    // Без нее ядро распределяет подключения по хешу адресов, не учитывая ядро.
+    if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog)))
+        perror("Ошибка SO_ATTACH_REUSEPORT_CBPF");
+}
+
+// Список ядер, на которых разрешено выполнение процесса (с учетом cpuset/taskset)
+static int allowed_cpus(int *cpus, int max)
+{
+    cpu_set_t set;
+    int count = 0;
+
+    // sched_getaffinity: Маска ядер, доступных текущему процессу.
+    if (sched_getaffinity(0, sizeof(set), &set) < 0)
+        return 0;
+
+    for (int cpu = 0; cpu < CPU_SETSIZE && count < max; cpu++)
+    {
+        if (CPU_ISSET(cpu, &set))
+            cpus[count++] = cpu;
+    }
+    return count;
+}
+
+// Запуск событийного сервера: N рабочих потоков, каждый со своим epoll или кольцом io_uring.
+// По умолчанию потоки совместно принимают подключения с одного слушающего сокета.
+// В режиме reuseport у каждого потока свой сокет SO_REUSEPORT и свое ядро процессора:
+// прием, чтение и разбор соединения целиком выполняются на ядре, которое его приняло.
+void start_event_server(const struct server_config *config)
+{
+    int workers = config->workers;
+    if (workers <= 0)
+    {
+        // sysconf(_SC_NPROCESSORS_ONLN): Количество доступных процессорных ядер.
+        workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+        if (workers <= 0)
+            workers = 1;
+    }
+
+    // Механизм io_uring может быть недоступен: старое ядро или запрет через sysctl kernel.io_uring_disabled
+    int backend = config->backend;
+    if (backend == BACKEND_URING && !uring_supported())
+    {
+        perror("io_uring недоступен, используется epoll");
+        backend = BACKEND_EPOLL;
+    }
+    void *(*worker_loop)(void *) = backend == BACKEND_URING ? uring_worker_loop : event_worker_loop;
+
+    raise_fd_limit();
+    conn_table_init(&connections);
+
+    // eventfd: Счетчик событий в виде дескриптора. Запись в него будит все циклы epoll при остановке.
+    if ((stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0)
+    {
+        perror("Ошибка eventfd");
+        exit(EXIT_FAILURE);
+    }
+
+    server_active = 1;
+
+    // sigaction: Устанавливает обработчик сигналов SIGINT/SIGTERM для корректной остановки.
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = handle_stop_signal;
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    struct event_worker *pool = calloc(workers, sizeof(*pool));
+    if (pool == NULL)
+    {
+        perror("Ошибка выделения памяти для рабочих потоков");
+        exit(EXIT_FAILURE);
+    }
+
+    int cpus[CPU_SETSIZE];
+    int cpu_count = config->reuseport ? allowed_cpus(cpus, CPU_SETSIZE) : 0;
+    int shared_fd = config->reuseport ? -1 : open_listener(0);
+
+    for (int i = 0; i < workers; i++)
+    {
+        struct event_worker *worker = &pool[i];
+        struct epoll_event ev;
+
+        worker->id = i;
+        worker->config = config;
+        worker->cpu = cpu_count > 0 ? cpus[i % cpu_count] : -1;
+        worker->stop_fd = stop_fd;
+        worker->epoll_fd = -1;
+
+        // Сокеты создаются строго по порядку потоков: их номер в группе SO_REUSEPORT
+        // совпадает с номером потока, который возвращает программа attach_cpu_steering.
+        worker->listen_fd = config->reuseport ? open_listener(1) : shared_fd;
+
+        // Поток io_uring сам создает свое кольцо и регистрирует в нем запросы приема
+        if (backend == BACKEND_URING)
+            continue;
+
+        // epoll_create1: Создает экземпляр epoll. У каждого потока свой экземпляр.
+        if ((worker->epoll_fd = epoll_create1(EPOLL_CLOEXEC)) < 0)
+        {
+            perror("Ошибка epoll_create1");
+            exit(EXIT_FAILURE);
+        }
+
+        // EPOLLEXCLUSIVE: При новом подключении на общем сокете будится только один из потоков,
+        // ожидающих на нем, а не все сразу.
+        ev.events = config->reuseport ? EPOLLIN | EPOLLET : EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+
+        ev.data.u64 = LISTEN_TAG;
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, worker->listen_fd, &ev) < 0)
+        {
+            perror("Ошибка epoll_ctl для слушающего сокета");
+            exit(EXIT_FAILURE);
+        }
+
+        ev.events = EPOLLIN;
+        ev.data.u64 = STOP_TAG;
+        if (epoll_ctl(worker->epoll_fd, EPOLL_CTL_ADD, stop_fd, &ev) < 0)
+        {
+            perror("Ошибка epoll_ctl для eventfd");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Программа выбора сокета привязывается к группе, когда все сокеты уже созданы.
+    // Номер ядра совпадает с номером сокета, только если доступны ядра 0..N-1 подряд.
+    int contiguous = cpu_count > 0;
+    for (int i = 0; i < cpu_count; i++)
+        contiguous &= cpus[i] == i;
+    if (config->reuseport && contiguous)
+        attach_cpu_steering(pool[0].listen_fd, workers);
+
+    printf("Сервер IPv6 запущен на порту %d\n", PORT);
+    printf("Ожидание IPv6 подключений...\n");
+
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+
+        if (pool[i].cpu >= 0)
+        {
+            // pthread_attr_setaffinity_np: Поток сразу стартует на своем ядре, поэтому
+            // и его стек, и память соединений выделяются в локальном для ядра узле NUMA.
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(pool[i].cpu, &set);
+            pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        }
+
+        int err = pthread_create(&pool[i].thread, &attr, worker_loop, &pool[i]);
+        pthread_attr_destroy(&attr);
+        if (err)
+        {
+            errno = err;
+            perror("Ошибка создания рабочего потока");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    const char *backend_name = backend == BACKEND_URING ? "io_uring" : "epoll";
+    if (config->reuseport)
+        printf("Цикл событий %s: %d рабочих потоков, свой сокет SO_REUSEPORT и ядро у каждого\n", backend_name, workers);
+    else
+        printf("Цикл событий %s: %d рабочих потоков\n", backend_name, workers);
+
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_join(pool[i].thread, NULL);
+        if (pool[i].epoll_fd >= 0)
+            close(pool[i].epoll_fd);
+        if (config->reuseport)
+            close(pool[i].listen_fd);
+    }
+
+    // Все рабочие потоки остановлены - оставшиеся соединения закрываются из основного потока
+    conn_table_foreach(&connections, close_remaining, NULL);
+    conn_table_destroy(&connections);
+
+    if (shared_fd >= 0)
+        close(shared_fd);
+    free(pool);
+    close(stop_fd);
+    stop_fd = -1;
+
+    printf("Сервер IPv6 остановлен\n");
+}
+
+// Остановка событийного сервера. Безопасна для вызова из обработчика сигнала.
+void stop_event_server()
+{
+    uint64_t one = 1;
+
+    server_active = 0;
+    if (stop_fd >= 0 && write(stop_fd, &one, sizeof(one)) < 0)
+    {
+        // Счетчик eventfd уже ненулевой - потоки и так будут разбужены.
+    }
+}
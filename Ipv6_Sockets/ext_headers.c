@@ -0,0 +1,290 @@
+#include "ipv6_sockets.h"
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Заголовки расширения IPv6 и опции назначения.
+// Между заголовком IPv6 и данными может стоять цепочка заголовков расширения: каждый
+// указывает в next_header тип следующего. Опции внутри заголовка опций назначения
+// записаны подряд в формате TLV: байт типа, байт длины данных и сами данные
+// (кроме Pad1 - это один нулевой байт без длины).
+
+// Обработчик опции: opt указывает на байт типа, длина данных уже проверена по границам заголовка.
+// Возвращает 0 или -1, если опция некорректна и кадр следует отбросить.
+typedef int (*ext_option_fn)(const uint8_t *opt, struct ext_options *out);
+
+static int opt_pad(const uint8_t *opt, struct ext_options *out)
+{
+    out->pad_bytes += 2 + opt[1];
+    return 0;
+}
+
+// LOCN: 8 байт адреса в сетевом порядке. Адрес может быть не выровнен, поэтому копируется через memcpy.
+// Места хватает всегда: в заголовок помещается не больше EXT_MAX_LOCN таких опций.
+static int opt_locn(const uint8_t *opt, struct ext_options *out)
+{
+    uint64_t address;
+
+    if (opt[1] != 8)
+        return -1;
+    memcpy(&address, opt + 2, sizeof(address));
+    out->locn[out->locn_count++] = ntohll(address);
+    return 0;
+}
+
+// Таблица обработчиков по типу опции, заполняется при компиляции.
+// Разбор опции - одно чтение таблицы и косвенный вызов, без ветвления по типам.
+static const ext_option_fn option_handlers[256] = {
+    [OPT_PADN] = opt_pad,
+    [OPT_LOCN] = opt_locn,
+};
+
+// Обход опций TLV одного заголовка опций назначения длиной len байт.
+// Возвращает число разобранных опций или -1, если заголовок поврежден либо содержит
+// неизвестную опцию, требующую отбросить пакет.
+int ext_options_walk(const struct dest_options *opts, size_t len, struct ext_options *out)
+{
+    const uint8_t *p = opts->options;
+    const uint8_t *end = (const uint8_t *)opts + len;
+    int count = 0;
+
+    out->locn_count = 0;
+    out->pad_bytes = 0;
+    out->skipped = 0;
+
+    while (p < end)
+    {
+        // Pad1: единственная опция без байта длины
+        if (*p == OPT_PAD1)
+        {
+            out->pad_bytes++;
+            p++;
+            continue;
+        }
+
+        if (end - p < 2 || end - p < 2 + p[1])
+            return -1;
+
+        ext_option_fn handler = option_handlers[*p];
+        if (handler)
+        {
+            if (handler(p, out) < 0)
+                return -1;
+        }
+        else
+        {
+            // Два старших бита типа задают действие для неизвестной опции (RFC 8200, раздел 4.2):
+            // 00 - пропустить, иначе пакет отбрасывается.
+            if (*p >> 6)
+                return -1;
+            out->skipped++;
+        }
+
+        p += 2 + p[1];
+        count++;
+    }
+
+    return count;
+}
+
+// Сборка заголовка опций назначения с count адресами LOCN (подряд, по 10 байт).
+// Хвост дополняется Pad1 или PadN до кратной 8 байтам длины. Возвращает длину заголовка.
+size_t ext_options_build(uint8_t *buf, uint8_t next_header, const uint64_t *locn, int count)
+{
+    if (count > EXT_MAX_LOCN)
+        count = EXT_MAX_LOCN;
+
+    size_t len = 2;
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t address = htonll(locn[i]);
+
+        buf[len] = OPT_LOCN;
+        buf[len + 1] = 8;
+        memcpy(buf + len + 2, &address, sizeof(address));
+        len += OPT_LOCN_SIZE;
+    }
+
+    size_t pad = (8 - len % 8) % 8;
+    if (pad == 1)
+    {
+        buf[len] = OPT_PAD1;
+    }
+    else if (pad > 1)
+    {
+        buf[len] = OPT_PADN;
+        buf[len + 1] = pad - 2;
+        memset(buf + len + 2, 0, pad - 2);
+    }
+    len += pad;
+
+    buf[0] = next_header;
+    buf[1] = len / 8 - 1; // hdr_ext_len: длина в блоках по 8 байт без первого блока
+    return len;
+}
+
+// Проход по цепочке заголовков расширения, начиная с типа next_header, в пределах данных кадра.
+// Сдвигает frame->payload за последний заголовок расширения и запоминает первый заголовок
+// опций назначения. Возвращает 0 или -1, если заголовок выходит за границы кадра.
+int ext_chain_parse(struct ipv6_frame *frame, uint8_t next_header)
+{
+    for (;;)
+    {
+        const uint8_t *ext = (const uint8_t *)frame->payload;
+        size_t len;
+
+        switch (next_header)
+        {
+        case 0:  // Hop-by-Hop Options
+        case 43: // Routing
+        case 60: // Destination Options
+            if (frame->payload_len < 8)
+                return -1;
+            len = ((size_t)ext[1] + 1) * 8;
+            break;
+        case 44: // Fragment: фиксированные 8 байт
+            len = 8;
+            break;
+        case 51: // Authentication Header: длина в 4-байтных словах минус 2
+            if (frame->payload_len < 8)
+                return -1;
+            len = ((size_t)ext[1] + 2) * 4;
+            break;
+        default: // Заголовок верхнего уровня или No Next Header (59)
+            return 0;
+        }
+
+        if (len > frame->payload_len)
+            return -1;
+
+        if (next_header == 60 && frame->opts == NULL)
+        {
+            frame->opts = (const struct dest_options *)ext;
+            frame->opts_len = len;
+        }
+
+        next_header = ext[0];
+        frame->payload += len;
+        frame->payload_len -= len;
+    }
+}
+
+// Пакетная проверка заголовков: поля кадров раскладываются по массивам (по одному
+// 32-битному элементу на кадр), а сравнения выполняются векторно сразу для 8 (AVX2)
+// или 4 (SSE2) кадров. Кадр корректен, если версия 6, payload_len совпадает с длиной
+// датаграммы и заголовок опций назначения (если он первый) помещается в кадр.
+struct batch_lanes
+{
+    int32_t version[64] __attribute__((aligned(32)));
+    int32_t frame_len[64] __attribute__((aligned(32)));    // 40 + payload_len из заголовка
+    int32_t received_len[64] __attribute__((aligned(32))); // Фактическая длина датаграммы
+    int32_t next_header[64] __attribute__((aligned(32)));
+    int32_t opts_len[64] __attribute__((aligned(32)));     // (hdr_ext_len + 1) * 8
+};
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static uint64_t validate_avx2(const struct batch_lanes *lanes, int count)
+{
+    const __m256i six = _mm256_set1_epi32(6);
+    const __m256i dest = _mm256_set1_epi32(60);
+    const __m256i header = _mm256_set1_epi32(sizeof(struct ipv6_header));
+    uint64_t mask = 0;
+
+    for (int i = 0; i < count; i += 8)
+    {
+        __m256i version = _mm256_load_si256((const __m256i *)&lanes->version[i]);
+        __m256i frame_len = _mm256_load_si256((const __m256i *)&lanes->frame_len[i]);
+        __m256i received = _mm256_load_si256((const __m256i *)&lanes->received_len[i]);
+        __m256i next = _mm256_load_si256((const __m256i *)&lanes->next_header[i]);
+        __m256i opts = _mm256_load_si256((const __m256i *)&lanes->opts_len[i]);
+
+        __m256i ok = _mm256_and_si256(_mm256_cmpeq_epi32(version, six), _mm256_cmpeq_epi32(frame_len, received));
+        __m256i too_long = _mm256_cmpgt_epi32(_mm256_add_epi32(opts, header), frame_len);
+        ok = _mm256_andnot_si256(_mm256_and_si256(_mm256_cmpeq_epi32(next, dest), too_long), ok);
+        mask |= (uint64_t)(uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(ok)) << i;
+    }
+    return mask;
+}
+
+static uint64_t validate_sse2(const struct batch_lanes *lanes, int count)
+{
+    const __m128i six = _mm_set1_epi32(6);
+    const __m128i dest = _mm_set1_epi32(60);
+    const __m128i header = _mm_set1_epi32(sizeof(struct ipv6_header));
+    uint64_t mask = 0;
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128i version = _mm_load_si128((const __m128i *)&lanes->version[i]);
+        __m128i frame_len = _mm_load_si128((const __m128i *)&lanes->frame_len[i]);
+        __m128i received = _mm_load_si128((const __m128i *)&lanes->received_len[i]);
+        __m128i next = _mm_load_si128((const __m128i *)&lanes->next_header[i]);
+        __m128i opts = _mm_load_si128((const __m128i *)&lanes->opts_len[i]);
+
+        __m128i ok = _mm_and_si128(_mm_cmpeq_epi32(version, six), _mm_cmpeq_epi32(frame_len, received));
+        __m128i too_long = _mm_cmpgt_epi32(_mm_add_epi32(opts, header), frame_len);
+        ok = _mm_andnot_si128(_mm_and_si128(_mm_cmpeq_epi32(next, dest), too_long), ok);
+        mask |= (uint64_t)(uint32_t)_mm_movemask_ps(_mm_castsi128_ps(ok)) << i;
+    }
+    return mask;
+}
+#else
+static uint64_t validate_scalar(const struct batch_lanes *lanes, int count)
+{
+    uint64_t mask = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        int ok = lanes->version[i] == 6 && lanes->frame_len[i] == lanes->received_len[i] &&
+                 (lanes->next_header[i] != 60 ||
+                  lanes->opts_len[i] + (int32_t)sizeof(struct ipv6_header) <= lanes->frame_len[i]);
+        mask |= (uint64_t)ok << i;
+    }
+    return mask;
+}
+#endif
+
+// Проверка до 64 датаграмм, каждая из которых должна быть ровно одним кадром.
+// Возвращает маску: бит i установлен, если frames[i] прошел проверку.
+uint64_t ipv6_validate_batch(const struct iovec *frames, int count)
+{
+    struct batch_lanes lanes;
+
+    if (count > 64)
+        count = 64;
+    int rounded = (count + 7) & ~7;
+
+    // Сбор полей. Короткие датаграммы и пустые элементы до кратного 8 числа
+    // получают версию 0 и не проходят проверку.
+    memset(&lanes, 0, sizeof(lanes));
+    for (int i = 0; i < count; i++)
+    {
+        const uint8_t *data = frames[i].iov_base;
+        size_t len = frames[i].iov_len;
+
+        if (len < sizeof(struct ipv6_header))
+            continue;
+
+        const struct ipv6_header *hdr = (const struct ipv6_header *)data;
+        lanes.version[i] = hdr->fields.version;
+        lanes.frame_len[i] = sizeof(struct ipv6_header) + ntohs(hdr->fields.payload_len);
+        lanes.received_len[i] = (int32_t)len;
+        lanes.next_header[i] = hdr->fields.next_header;
+        // Второй байт заголовка опций, если он получен; иначе длина заведомо больше кадра
+        lanes.opts_len[i] = len >= sizeof(struct ipv6_header) + 2 ? (data[sizeof(struct ipv6_header) + 1] + 1) * 8 : 65536;
+    }
+
+    uint64_t mask;
+#if defined(__x86_64__)
+    // __builtin_cpu_supports: Проверка возможностей процессора по CPUID (результат кэшируется libgcc)
+    if (__builtin_cpu_supports("avx2"))
+        mask = validate_avx2(&lanes, rounded);
+    else
+        mask = validate_sse2(&lanes, rounded);
+#else
+    mask = validate_scalar(&lanes, rounded);
+#endif
+
+    return count == 64 ? mask : mask & ((1ULL << count) - 1);
+}
@@ -0,0 +1,154 @@
+#include "ipv6_sockets.h"
+#include <sys/mman.h>
+
+// Создание кольцевого буфера с двойным отображением.
+// Одни и те же физические страницы отображаются дважды подряд: [0, cap) и [cap, 2*cap).
+// Благодаря этому любой участок длиной до cap, начинающийся внутри буфера, непрерывен в памяти,
+// и кадр, "перескочивший" через конец кольца, можно разбирать на месте без копирования.
+int frame_ring_init(struct frame_ring *ring)
+{
+    long page = sysconf(_SC_PAGESIZE);
+    size_t capacity = (FRAME_MAX_SIZE + page - 1) & ~(size_t)(page - 1);
+
+    // memfd_create: Создает анонимный файл в памяти, который можно отобразить несколько раз.
+    int fd = memfd_create("frame_ring", MFD_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    // ftruncate: Устанавливает размер файла в памяти равным емкости буфера.
+    if (ftruncate(fd, capacity) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // mmap(PROT_NONE): Резервирует непрерывный участок адресного пространства размером 2*cap.
+    char *base = mmap(NULL, 2 * capacity, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return -1;
+    }
+
+    // MAP_FIXED: Отображает файл точно по указанному адресу поверх зарезервированного участка.
+    // MAP_SHARED: Обе половины ссылаются на одни и те же страницы файла.
+    if (mmap(base, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED ||
+        mmap(base + capacity, capacity, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0) == MAP_FAILED)
+    {
+        munmap(base, 2 * capacity);
+        close(fd);
+        return -1;
+    }
+
+    // Отображения остаются действительными и после закрытия дескриптора.
+    close(fd);
+
+    ring->data = base;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+    return 0;
+}
+
+void frame_ring_free(struct frame_ring *ring)
+{
+    if (ring->data)
+        munmap(ring->data, 2 * ring->capacity);
+    ring->data = NULL;
+}
+
+// Счетчик системных вызовов ввода-вывода. Определен здесь, потому что сборка кадров
+// входит во все программы, включая capture_dump.
+uint64_t io_syscalls = 0;
+
+// Чтение из сокета во все свободное место буфера одним вызовом recv.
+// Возвращает результат recv: число байт, 0 при закрытии соединения, -1 при ошибке.
+ssize_t frame_ring_recv(struct frame_ring *ring, int sockfd)
+{
+    size_t free_space = ring->capacity - (ring->tail - ring->head);
+
+    // Буфер вмещает кадр максимального размера, поэтому он может быть заполнен
+    // только полными кадрами, которые вызывающий код еще не забрал.
+    if (free_space == 0)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    count_syscall();
+    ssize_t recv_bytes = recv(sockfd, ring->data + ring->tail, free_space, 0);
+    if (recv_bytes > 0)
+        ring->tail += recv_bytes;
+    return recv_bytes;
+}
+
+// Разбор кадра, начинающегося с data, по не более чем len доступным байтам.
+// Возвращает 1, если кадр собран целиком, 0 - если данных пока не хватает,
+// -1 - если данные не являются кадром IPv6 (поток рассинхронизирован).
+int ipv6_frame_parse(const char *data, size_t len, struct ipv6_frame *frame)
+{
+    if (len < sizeof(struct ipv6_header))
+        return 0;
+
+    const struct ipv6_header *hdr = (const struct ipv6_header *)data;
+
+    if (hdr->fields.version != 6)
+        return -1;
+
+    size_t frame_len = sizeof(struct ipv6_header) + ntohs(hdr->fields.payload_len);
+    if (len < frame_len)
+        return 0;
+
+    frame->hdr = hdr;
+    frame->frame_len = frame_len;
+    frame->opts = NULL;
+    frame->opts_len = 0;
+    frame->payload = data + sizeof(struct ipv6_header);
+    frame->payload_len = frame_len - sizeof(struct ipv6_header);
+
+    // Заголовки расширения (среди них опции назначения, next_header == 60) идут между
+    // заголовком IPv6 и данными; их длины берутся из самих заголовков.
+    if (ext_chain_parse(frame, hdr->fields.next_header) < 0)
+        return -1;
+
+    return 1;
+}
+
+// Поиск следующего полного кадра. Длина кадра определяется полем payload_len заголовка IPv6.
+// Возвращает 1 и заполняет frame, если кадр полностью получен; 0, если нужно дочитать данные;
+// -1, если поток поврежден (неверная версия или длина) и соединение следует закрыть.
+int frame_ring_next(struct frame_ring *ring, struct ipv6_frame *frame)
+{
+    return ipv6_frame_parse(ring->data + ring->head, ring->tail - ring->head, frame);
+}
+
+// Освобождение места, занятого обработанным кадром
+void frame_ring_consume(struct frame_ring *ring, const struct ipv6_frame *frame)
+{
+    ring->head += frame->frame_len;
+
+    if (ring->head == ring->tail)
+    {
+        // Буфер пуст: следующий recv снова начнется с первых страниц,
+        // так что при небольших сообщениях используется лишь их малая часть.
+        ring->head = 0;
+        ring->tail = 0;
+    }
+    else if (ring->head >= ring->capacity)
+    {
+        ring->head -= ring->capacity;
+        ring->tail -= ring->capacity;
+    }
+}
+
+// Копирование принятых данных в конец буфера (механизм io_uring принимает данные в свои буферы).
+// Копируется столько, сколько помещается; возвращает число скопированных байт.
+size_t frame_ring_append(struct frame_ring *ring, const void *data, size_t len)
+{
+    size_t free_space = ring->capacity - (ring->tail - ring->head);
+    size_t copied = len < free_space ? len : free_space;
+
+    memcpy(ring->data + ring->tail, data, copied);
+    ring->tail += copied;
+    return copied;
+}
@@ -0,0 +1,209 @@
+#include "ipv6_sockets.h"
+#include <sys/eventfd.h>
+#include <sys/resource.h>
+#include <time.h>
+
+// Сравнение механизмов ввода-вывода на петлевом интерфейсе ::1.
+// Для каждого механизма в этом же процессе запускается сервер с одним рабочим потоком,
+// клиенты отправляют одинаковый поток пакетов, а по окончании выводятся время,
+// число системных вызовов ввода-вывода (счетчик io_syscalls) и переключений контекста (getrusage).
+// Клиент в режиме epoll отправляет очередь каждого соединения своим вызовом sendmsg,
+// в режиме io_uring - очереди всех соединений одним io_uring_enter.
+
+#define COMPARE_CONNECTIONS 8   // Одновременных соединений
+#define COMPARE_MESSAGES 50000  // Пакетов на соединение
+#define COMPARE_BATCH 32        // Пакетов в очереди соединения перед отправкой
+#define COMPARE_PAYLOAD 64      // Размер полезной нагрузки пакета
+
+static uint64_t compare_expected;
+static uint64_t compare_received;
+static int compare_done_fd = -1;
+
+// Обработчик сервера: только подсчет пакетов. Последний пакет будит основной поток.
+static void count_packet(client_t *client, const struct ipv6_frame *frame)
+{
+    (void)client;
+    (void)frame;
+
+    if (__atomic_add_fetch(&compare_received, 1, __ATOMIC_RELAXED) == compare_expected)
+    {
+        uint64_t one = 1;
+        if (write(compare_done_fd, &one, sizeof(one)) < 0)
+            perror("Ошибка записи eventfd");
+    }
+}
+
+static void *compare_server(void *arg)
+{
+    start_event_server((const struct server_config *)arg);
+    return NULL;
+}
+
+// Подключение к ::1. Сервер запускается в соседнем потоке, поэтому при отказе попытка повторяется.
+static int connect_loopback()
+{
+    struct sockaddr_in6 addr;
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_port = htons(PORT);
+    addr.sin6_addr = in6addr_loopback;
+
+    for (int attempt = 0; attempt < 200; attempt++)
+    {
+        int fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0)
+            return -1;
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+        close(fd);
+        usleep(10000);
+    }
+    return -1;
+}
+
+struct compare_result
+{
+    double seconds;
+    uint64_t syscalls;
+    long context_switches;
+};
+
+// Один прогон: сервер и клиенты на заданном механизме
+static int compare_run(int backend, struct compare_result *result)
+{
+    // static: Очереди отправителей слишком велики для стека
+    static struct ipv6_sender senders[COMPARE_CONNECTIONS];
+    struct ipv6_sender *batch[COMPARE_CONNECTIONS];
+    struct server_config config = {.workers = 1, .backend = backend, .on_packet = count_packet};
+    static char payload[COMPARE_PAYLOAD];
+    struct uring uring;
+    pthread_t server_thread;
+
+    memset(payload, 'x', sizeof(payload));
+    compare_expected = (uint64_t)COMPARE_CONNECTIONS * COMPARE_MESSAGES;
+    compare_received = 0;
+
+    // eventfd: основной поток блокируется на чтении до получения сервером последнего пакета
+    if ((compare_done_fd = eventfd(0, EFD_CLOEXEC)) < 0)
+    {
+        perror("Ошибка eventfd");
+        return -1;
+    }
+
+    if (pthread_create(&server_thread, NULL, compare_server, &config))
+    {
+        perror("Ошибка создания потока сервера");
+        close(compare_done_fd);
+        return -1;
+    }
+
+    for (int i = 0; i < COMPARE_CONNECTIONS; i++)
+    {
+        int fd = connect_loopback();
+        if (fd < 0)
+        {
+            perror("Ошибка подключения к ::1");
+            exit(EXIT_FAILURE);
+        }
+        ipv6_sender_init(&senders[i], fd, 0);
+        batch[i] = &senders[i];
+    }
+
+    if (backend == BACKEND_URING && uring_init(&uring, 64, 0) < 0)
+    {
+        perror("Ошибка создания io_uring");
+        exit(EXIT_FAILURE);
+    }
+
+    struct rusage usage_start, usage_end;
+    struct timespec time_start, time_end;
+    uint64_t syscalls_start = __atomic_load_n(&io_syscalls, __ATOMIC_RELAXED);
+
+    getrusage(RUSAGE_SELF, &usage_start);
+    clock_gettime(CLOCK_MONOTONIC, &time_start);
+
+    for (int sent = 0; sent < COMPARE_MESSAGES; sent += COMPARE_BATCH)
+    {
+        int count = COMPARE_MESSAGES - sent < COMPARE_BATCH ? COMPARE_MESSAGES - sent : COMPARE_BATCH;
+
+        for (int i = 0; i < COMPARE_CONNECTIONS; i++)
+            for (int j = 0; j < count; j++)
+                ipv6_sender_queue(&senders[i], payload, sizeof(payload));
+
+        if (backend == BACKEND_URING)
+        {
+            if (uring_send_batch(&uring, batch, COMPARE_CONNECTIONS) < 0)
+            {
+                perror("Ошибка отправки через io_uring");
+                exit(EXIT_FAILURE);
+            }
+        }
+        else
+        {
+            for (int i = 0; i < COMPARE_CONNECTIONS; i++)
+            {
+                if (ipv6_sender_flush(&senders[i]) < 0)
+                {
+                    perror("Ошибка отправки sendmsg");
+                    exit(EXIT_FAILURE);
+                }
+            }
+        }
+    }
+
+    uint64_t done;
+    if (read(compare_done_fd, &done, sizeof(done)) < 0)
+        perror("Ошибка чтения eventfd");
+
+    clock_gettime(CLOCK_MONOTONIC, &time_end);
+    getrusage(RUSAGE_SELF, &usage_end);
+
+    result->syscalls = __atomic_load_n(&io_syscalls, __ATOMIC_RELAXED) - syscalls_start;
+    result->seconds = (time_end.tv_sec - time_start.tv_sec) + (time_end.tv_nsec - time_start.tv_nsec) / 1e9;
+    result->context_switches = (usage_end.ru_nvcsw - usage_start.ru_nvcsw) +
+                               (usage_end.ru_nivcsw - usage_start.ru_nivcsw);
+
+    if (backend == BACKEND_URING)
+        uring_free(&uring);
+    for (int i = 0; i < COMPARE_CONNECTIONS; i++)
+        close(senders[i].sockfd);
+
+    stop_event_server();
+    pthread_join(server_thread, NULL);
+    close(compare_done_fd);
+    compare_done_fd = -1;
+    return 0;
+}
+
+// Режим сравнения: прогон на epoll, затем на io_uring, и таблица результатов
+void run_io_compare()
+{
+    const char *names[] = {"epoll", "io_uring"};
+    struct compare_result results[2];
+    int runs = uring_supported() ? 2 : 1;
+    int saved_level = log_level;
+    uint64_t packets = (uint64_t)COMPARE_CONNECTIONS * COMPARE_MESSAGES;
+
+    if (runs == 1)
+        perror("io_uring недоступен, сравнение только для epoll");
+
+    log_level = LOG_QUIET;
+    for (int backend = 0; backend < runs; backend++)
+    {
+        if (compare_run(backend, &results[backend]) < 0)
+            return;
+    }
+    log_level = saved_level;
+
+    printf("\nСравнение на ::1: %d соединений, %lu пакетов по %d байт, очередь %d пакетов\n",
+           COMPARE_CONNECTIONS, packets, COMPARE_PAYLOAD, COMPARE_BATCH);
+    // Заголовок без ширины полей: printf считает байты, а не символы кириллицы
+    printf("Механизм     Время, с    Пакетов/с  Сист. вызовов  На 1000 пак.  Переключений\n");
+    for (int i = 0; i < runs; i++)
+    {
+        printf("%-10s %10.3f %12.0f %14lu %13.1f %13ld\n", names[i], results[i].seconds,
+               packets / results[i].seconds, results[i].syscalls,
+               results[i].syscalls * 1000.0 / packets, results[i].context_switches);
+    }
+}
@@ -1,92 +1,15 @@
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <unistd.h>
-#include <sys/socket.h>
-#include <sys/types.h>
-#include <ifaddrs.h>
-#include <netdb.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
-#include <pthread.h>
-#include <errno.h>
-#include <endian.h>
-#include <net/if.h>
-
-#define PORT 8080
-#define MAX_CLIENTS 100
-#define BUFFER_SIZE 1024
-
-// Структура IPv6 заголовка
-struct ipv6_header
-{
-    union
-    {
-        struct
-        {
-#if __BYTE_ORDER == __LITTLE_ENDIAN
-            uint32_t traffic_class : 8;
-            uint32_t flow_label : 20;
-            uint32_t version : 4;
-#else
-            uint32_t version : 4;
-            uint32_t traffic_class : 8;
-            uint32_t flow_label : 20;
-#endif
-            uint16_t payload_len;
-            uint8_t next_header;
-            uint8_t hop_limit;
-            struct in6_addr src_addr;
-            struct in6_addr dst_addr;
-        } fields;
-        uint8_t raw[40];
-    };
-};
-
-// Структура для опций назначения
-struct dest_options
-{
-    uint8_t next_header;
-    uint8_t hdr_ext_len;
-    uint8_t opt_type;
-    uint8_t opt_len;
-    uint64_t ram_address;
-    uint8_t padding[6];
-};
-
-// Информация о клиенте
-typedef struct
-{
-    int sockfd;
-    struct sockaddr_in6 addr;
-    pthread_t thread_id;
-} client_t;
+#include "ipv6_sockets.h"
+#include <getopt.h>
 
 // Глобальные переменные сервера
-pthread_mutex_t clients_mutex = PTHREAD_MUTEX_INITIALIZER;
-client_t clients[MAX_CLIENTS];
-int active_clients = 0;
-int server_active = 1;
-
-// Прототипы функций
-void start_server();
-void start_client(const char *ipv6_addr);
-void *handle_client(void *client_data);
-void setup_server_socket(int *server_fd);
-void accept_connections(int server_fd);
-void cleanup_resources(int server_fd);
-void *receive_messages(void *sock_ptr);
-void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd);
-void send_ipv6_packet(int sockfd, const char *message);
-void print_ipv6_header(const struct ipv6_header *hdr);
-void print_dest_options(const struct dest_options *opts);
-uint64_t htonll(uint64_t value);
-uint64_t ntohll(uint64_t value);
+volatile int server_active = 1;
+static int client_backend = BACKEND_EPOLL; // Механизм ввода-вывода клиента
 
 // ===================== СЕРВЕРНАЯ ЧАСТЬ =====================
 
-// Настройка IPv6 сокета
-void setup_server_socket(int *server_fd)
+// Настройка IPv6 сокета.
+// reuseport: Разрешить нескольким сокетам слушать один порт (по сокету на рабочий поток).
+void setup_server_socket(int *server_fd, int reuseport)
 {
     struct sockaddr_in6 server_addr;
 
@@ -109,6 +32,15 @@ void setup_server_socket(int *server_fd)
         perror("Ошибка SO_REUSEADDR");
     }
 
+    // SO_REUSEPORT: Несколько сокетов привязываются к одному порту, и ядро распределяет
+    // входящие подключения между ними, так что у каждого сокета своя очередь accept.
+    if (reuseport && setsockopt(*server_fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)))
+    {
+        perror("Ошибка SO_REUSEPORT");
+        close(*server_fd);
+        exit(EXIT_FAILURE);
+    }
+
     // IPV6_V6ONLY: Опция для сокета IPv6, которая определяет, будет ли сокет принимать только IPv6-соединения
     // или также и IPv4-соединения (в режиме совместимости). 1 - только IPv6.
     int v6only = 1;
@@ -143,16 +75,13 @@ void setup_server_socket(int *server_fd)
     }
 
     // listen: Переводит сокет в режим прослушивания входящих подключений.
-    // MAX_CLIENTS: Максимальная длина очереди ожидающих подключений.
-    if (listen(*server_fd, MAX_CLIENTS) < 0)
+    // SOMAXCONN: Максимальная длина очереди ожидающих подключений, разрешенная системой.
+    if (listen(*server_fd, SOMAXCONN) < 0)
     {
         perror("Ошибка прослушивания");
         close(*server_fd);
         exit(EXIT_FAILURE);
     }
-
-    printf("Сервер IPv6 запущен на порту %d\n", PORT);
-    printf("Ожидание IPv6 подключений...\n");
 }
 
 // Прием новых подключений
@@ -176,93 +105,56 @@ void accept_connections(int server_fd)
             continue;
         }
 
-        // pthread_mutex_lock: Блокирует мьютекс для защиты разделяемых данных (списка клиентов) от одновременного доступа из разных потоков.
-        pthread_mutex_lock(&clients_mutex);
-
-        if (active_clients >= MAX_CLIENTS)
+        // Запись берется из таблицы соединений без блокировок и без поиска свободного слота.
+        client_t *client = conn_table_acquire(&connections);
+        if (client == NULL)
         {
-            printf("Достигнут лимит IPv6 клиентов\n");
+            perror("Нет свободных записей для IPv6 клиента");
             close(client_fd);
-            pthread_mutex_unlock(&clients_mutex);
-            continue;
-        }
-
-        // Поиск свободного слота
-        int slot = -1;
-        for (int i = 0; i < MAX_CLIENTS; i++)
-        {
-            if (clients[i].sockfd == -1)
-            {
-                slot = i;
-                break;
-            }
-        }
-
-        if (slot == -1)
-        {
-            printf("Нет свободных слотов для IPv6 клиента\n");
-            close(client_fd);
-            pthread_mutex_unlock(&clients_mutex);
             continue;
         }
 
         // Сохранение информации о клиенте
-        clients[slot].sockfd = client_fd;
-        clients[slot].addr = client_addr;
-        active_clients++;
+        client->sockfd = client_fd;
+        client->addr = client_addr;
+        client->owner = -1;
+
+        // PTHREAD_CREATE_DETACHED: Ресурсы потока освобождаются автоматически при его завершении,
+        // без pthread_join. Завершение всех потоков отслеживается по счетчику таблицы.
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
 
         // pthread_create: Создает новый поток для обработки подключенного клиента.
-        // &clients[slot].thread_id: Указатель для хранения идентификатора нового потока.
-        // NULL: Атрибуты потока по умолчанию.
+        // &client->thread_id: Указатель для хранения идентификатора нового потока.
+        // &attr: Атрибуты потока (отсоединенный).
         // handle_client: Функция, которую будет выполнять новый поток.
-        // &clients[slot]: Аргумент, передаваемый в функцию потока.
-        if (pthread_create(&clients[slot].thread_id, NULL, handle_client, &clients[slot]))
+        // client: Аргумент, передаваемый в функцию потока.
+        if (pthread_create(&client->thread_id, &attr, handle_client, client))
         {
             perror("Ошибка создания потока IPv6 клиента");
             close(client_fd);
-            clients[slot].sockfd = -1;
-            active_clients--;
+            conn_table_release(&connections, client);
         }
-
-        // pthread_mutex_unlock: Разблокирует мьютекс после завершения работы с разделяемыми данными.
-        pthread_mutex_unlock(&clients_mutex);
+        pthread_attr_destroy(&attr);
     }
 }
 
-// Вывод IPv6 заголовка
-void print_ipv6_header(const struct ipv6_header *hdr)
+// Обработка полученного кадра: запись в файл захвата и, при высоком уровне подробности, вывод разбора.
+// Кадр уже собран кольцевым буфером (frame_buffer.c). В рабочем режиме (уровень LOG_EVENTS и ниже)
+// здесь нет никакого форматирования - разбор захваченных кадров выполняет capture_dump.
+// Используется как потоком клиента (handle_client), так и циклом событий (event_loop.c).
+void process_ipv6_packet(client_t *client, const struct ipv6_frame *frame)
 {
-    char src_ip[INET6_ADDRSTRLEN], dst_ip[INET6_ADDRSTRLEN];
-
-    // inet_ntop (network to presentation): Преобразует числовой IPv6-адрес из бинарного формата в текстовую строку.
-    inet_ntop(AF_INET6, &hdr->fields.src_addr, src_ip, sizeof(src_ip));
-    inet_ntop(AF_INET6, &hdr->fields.dst_addr, dst_ip, sizeof(dst_ip));
-
-    printf("\n=== IPv6 Header ===\n");
-    printf("Version: %u\n", hdr->fields.version);
-    printf("Traffic class: %u\n", hdr->fields.traffic_class);
-    printf("Flow label: %u\n", hdr->fields.flow_label);
-    // ntohs (network to host short): Преобразует 16-битное число из сетевого порядка байтов в порядок байтов хоста.
-    printf("Payload length: %u\n", ntohs(hdr->fields.payload_len));
-    printf("Next header: %u\n", hdr->fields.next_header);
-    printf("Hop limit: %u\n", hdr->fields.hop_limit);
-    printf("Source ip: %s\n", src_ip);
-    printf("Destination ip: %s\n", dst_ip);
-}
+    (void)client;
 
-// Вывод опций назначения
-void print_dest_options(const struct dest_options *opts)
-{
-    printf("\n=== Destination options header ===\n");
-    printf("Next header: %u\n", opts->next_header);
-    printf("Extension length: %u\n", opts->hdr_ext_len);
-    printf("Option type: 0x%02X\n", opts->opt_type);
-    printf("Option length: %u\n", opts->opt_len);
-    // ntohll (network to host long long): Пользовательская функция для преобразования 64-битного числа из сетевого порядка в хостовый.
-    printf("LOCN: 0x%016lX\n", ntohll(opts->ram_address));
+    capture_frame(frame->hdr, frame->frame_len);
+
+    if (log_level >= LOG_PACKETS)
+        print_frame(frame);
 }
 
-// Обработчик клиента
+// Обработчик клиента (режим "поток на клиента")
 void *handle_client(void *client_data)
 {
     // (client_t *)client_data: Приведение типа аргумента. Потоковая функция принимает указатель общего вида (void*),
@@ -270,25 +162,25 @@ void *handle_client(void *client_data)
     client_t *client = (client_t *)client_data;
     int sockfd = client->sockfd;
     char client_ip[INET6_ADDRSTRLEN];
-    char buffer[BUFFER_SIZE];
+    struct frame_ring *ring = &client->ring;
+    struct ipv6_frame frame;
 
     inet_ntop(AF_INET6, &client->addr.sin6_addr, client_ip, sizeof(client_ip));
-    printf("IPv6 клиент подключен: %s\n", client_ip);
+    if (log_level >= LOG_EVENTS)
+        printf("IPv6 клиент подключен: %s\n", client_ip);
 
-    while (server_active)
+    // Буфер создается при первом использовании записи таблицы и затем переиспользуется
+    if (ring->data == NULL && frame_ring_init(ring) < 0)
+    {
+        perror("Ошибка создания буфера приема");
+    }
+
+    while (server_active && ring->data)
     {
         // recv: Получает данные из сокета. Блокирует выполнение до получения данных.
         // Возвращает количество полученных байт, 0 при закрытии соединения клиентом, -1 при ошибке.
-        ssize_t recv_bytes = recv(sockfd, buffer, BUFFER_SIZE, 0);
-
-        printf("\n[СЕРВЕР] Получен сырой пакет (%ld байт):\n---\n", recv_bytes);
-        for (int i = 0; i < recv_bytes; i++)
-        {
-            printf("%02x ", (unsigned char)buffer[i]);
-            if ((i + 1) % 16 == 0)
-                printf("\n");
-        }
-        printf("\n---\n");
+        // Один recv может содержать несколько кадров или часть кадра - сборкой занимается кольцевой буфер.
+        ssize_t recv_bytes = frame_ring_recv(ring, sockfd);
 
         if (recv_bytes <= 0)
         {
@@ -297,80 +189,56 @@ void *handle_client(void *client_data)
             break;
         }
 
-        // Проверка на IPv6 пакет
-        if (recv_bytes >= sizeof(struct ipv6_header))
+        int status;
+        while ((status = frame_ring_next(ring, &frame)) > 0)
         {
-            // (struct ipv6_header *)buffer: Приведение типа. Указатель на начало буфера (char*) преобразуется
-            // в указатель на структуру ipv6_header. Это позволяет интерпретировать
-            // начальные байты полученных данных как заголовок IPv6 и обращаться к его полям.
-            struct ipv6_header *ip6hdr = (struct ipv6_header *)buffer;
-
-            if (ip6hdr->fields.version == 6)
-            {
-                print_ipv6_header(ip6hdr);
-
-                // Проверка на опции назначения
-                if (ip6hdr->fields.next_header == 60 &&
-                    recv_bytes >= sizeof(struct ipv6_header) + sizeof(struct dest_options))
-                {
-
-                    // (struct dest_options *)(buffer + sizeof(struct ipv6_header)): Приведение типа со смещением.
-                    // Указатель смещается на размер заголовка IPv6, чтобы указывать на начало следующего
-                    // заголовка (в данном случае, опций назначения), и приводится к соответствующему типу.
-                    struct dest_options *dest_opt = (struct dest_options *)(buffer + sizeof(struct ipv6_header));
-                    print_dest_options(dest_opt);
-
-                    // Вывод данных
-                    char *payload = buffer + sizeof(struct ipv6_header) + sizeof(struct dest_options);
-                    size_t payload_size = recv_bytes - sizeof(struct ipv6_header) - sizeof(struct dest_options);
+            process_ipv6_packet(client, &frame);
+            frame_ring_consume(ring, &frame);
+        }
 
-                    if (payload_size > 0)
-                    {
-                        printf("Payload: %.*s\n", (int)payload_size, payload);
-                    }
-                }
-            }
+        if (status < 0)
+        {
+            fprintf(stderr, "Поврежденный IPv6 поток от %s\n", client_ip);
+            break;
         }
 
         // Эхо-ответ был удален, сервер не отправляет ответ.
     }
 
-    printf("IPv6 клиент отключен: %s\n", client_ip);
+    if (log_level >= LOG_EVENTS)
+        printf("IPv6 клиент отключен: %s\n", client_ip);
     // close: Закрывает файловый дескриптор сокета, освобождая системные ресурсы.
     close(sockfd);
 
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++)
-    {
-        if (clients[i].sockfd == sockfd)
-        {
-            clients[i].sockfd = -1;
-            active_clients--;
-            break;
-        }
-    }
-    pthread_mutex_unlock(&clients_mutex);
+    // Возврат записи в таблицу за O(1): поиск по sockfd и общий мьютекс не нужны.
+    conn_table_release(&connections, client);
 
     return NULL;
 }
 
+// Прерывание ожидания recv в потоке клиента при остановке сервера
+static void shutdown_client(client_t *client, void *arg)
+{
+    (void)arg;
+    // shutdown: Закрывает соединение в обе стороны. Заблокированный recv в потоке клиента
+    // сразу возвращает 0, и поток сам закрывает сокет и освобождает запись.
+    shutdown(client->sockfd, SHUT_RDWR);
+}
+
 // Очистка ресурсов
 void cleanup_resources(int server_fd)
 {
     close(server_fd);
 
-    pthread_mutex_lock(&clients_mutex);
-    for (int i = 0; i < MAX_CLIENTS; i++)
+    conn_table_foreach(&connections, shutdown_client, NULL);
+
+    // Потоки клиентов отсоединены (pthread_detach), поэтому их завершение
+    // определяется по атомарному счетчику занятых записей таблицы.
+    while (conn_table_active(&connections) > 0)
     {
-        if (clients[i].sockfd != -1)
-        {
-            close(clients[i].sockfd);
-            // pthread_join: Ожидает завершения указанного потока.
-            // Это гарантирует, что все потоки клиентов завершат свою работу корректно перед остановкой сервера.
-            pthread_join(clients[i].thread_id, NULL);
-        }
+        usleep(1000);
     }
-    pthread_mutex_unlock(&clients_mutex);
+    conn_table_destroy(&connections);
 
     printf("Сервер IPv6 остановлен\n");
 }
@@ -380,35 +248,22 @@ void start_server()
 {
     int server_fd;
 
-    // Инициализация клиентов
-    for (int i = 0; i < MAX_CLIENTS; i++)
-    {
-        clients[i].sockfd = -1;
-    }
+    // Инициализация таблицы клиентов
+    conn_table_init(&connections);
 
-    setup_server_socket(&server_fd);
+    setup_server_socket(&server_fd, 0);
+    printf("Сервер IPv6 запущен на порту %d\n", PORT);
+    printf("Ожидание IPv6 подключений...\n");
     accept_connections(server_fd);
     cleanup_resources(server_fd);
 }
 
 // ===================== КЛИЕНТСКАЯ ЧАСТЬ =====================
 
-// Преобразование 64-битных значений из хостового в сетевой порядок байт
-uint64_t htonll(uint64_t value)
-{
-    // htonl (host to network long): Преобразует 32-битное число из порядка байтов хоста в сетевой.
-    return ((uint64_t)htonl(value & 0xFFFFFFFF) << 32) | htonl(value >> 32);
-}
-
-// Преобразование 64-битных значений из сетевого в хостовый порядок байт
-uint64_t ntohll(uint64_t value)
-{
-    // ntohl (network to host long): Преобразует 32-битное число из сетевого порядка байтов в хостовый.
-    return ((uint64_t)ntohl(value & 0xFFFFFFFF) << 32) | ntohl(value >> 32);
-}
-
-// Подключение к серверу IPv6
-void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd)
+// Подключение к серверу IPv6.
+// type: SOCK_STREAM (TCP) или SOCK_DGRAM (UDP). Для UDP connect только запоминает адрес сервера,
+// после чего датаграммы отправляются без указания адреса.
+void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd, int type)
 {
     struct sockaddr_in6 server_addr;
     char addr_str[INET6_ADDRSTRLEN];
@@ -434,7 +289,7 @@ void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd)
         }
     }
 
-    if ((*sockfd = socket(AF_INET6, SOCK_STREAM, 0)) < 0)
+    if ((*sockfd = socket(AF_INET6, type, 0)) < 0)
     {
         perror("Ошибка создания IPv6 сокета");
         exit(EXIT_FAILURE);
@@ -472,8 +327,9 @@ void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd)
         exit(EXIT_FAILURE);
     }
 
-    printf("Подключение к IPv6 серверу [%s%%%s]:%d...\n",
-           addr_str, zone_id ? zone_ptr : "<none>", PORT);
+    if (log_level >= LOG_EVENTS)
+        printf("Подключение к IPv6 серверу [%s%%%s]:%d...\n",
+               addr_str, zone_id ? zone_ptr : "<none>", PORT);
 
     // connect: Устанавливает соединение с сервером по указанному адресу.
     // (struct sockaddr*)&server_addr: Приведение типа к обобщенной структуре адреса, как требует функция connect.
@@ -484,69 +340,17 @@ void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd)
         exit(EXIT_FAILURE);
     }
 
-    printf("Успешное подключение по IPv6\n");
+    if (log_level >= LOG_EVENTS)
+        printf("Успешное подключение по IPv6\n");
 }
 
-// Отправка IPv6 пакета
-void send_ipv6_packet(int sockfd, const char *message)
+// Отправка IPv6 пакета.
+// Заголовок IPv6 и опции назначения заранее подготовлены отправителем (packet_sender.c):
+// адреса сторон получены один раз при подключении, а сообщение передается ядру через iovec без копирования.
+void send_ipv6_packet(struct ipv6_sender *sender, const char *message)
 {
-    struct ipv6_header ip6hdr;
-    struct dest_options dest_opt;
-    const char *payload = message;
     // strlen: Вычисляет длину строки сообщения.
-    size_t payload_size = strlen(payload);
-
-    memset(&ip6hdr, 0, sizeof(ip6hdr));
-    ip6hdr.fields.version = 6;
-    ip6hdr.fields.traffic_class = 0;
-    // htonl (host to network long): Преобразует 32-битное число из порядка байтов хоста в сетевой.
-    ip6hdr.fields.flow_label = htonl(12345) >> 12;
-    ip6hdr.fields.payload_len = htons(sizeof(dest_opt) + payload_size);
-    ip6hdr.fields.next_header = 60; // Destination Options
-    ip6hdr.fields.hop_limit = 64;
-
-    struct sockaddr_in6 my_addr, peer_addr;
-    socklen_t addr_len = sizeof(struct sockaddr_in6);
-
-    // getsockname: Получает локальный адрес, к которому привязан сокет.
-    // (struct sockaddr*)&my_addr: Приведение типа для передачи в функцию.
-    if (getsockname(sockfd, (struct sockaddr *)&my_addr, &addr_len) == 0)
-    {
-        ip6hdr.fields.src_addr = my_addr.sin6_addr;
-    }
-    else
-    {
-        perror("Ошибка getsockname");
-        inet_pton(AF_INET6, "::1", &ip6hdr.fields.src_addr);
-    }
-
-    // getpeername: Получает адрес удаленного узла, к которому подключен сокет.
-    // (struct sockaddr*)&peer_addr: Приведение типа для передачи в функцию.
-    if (getpeername(sockfd, (struct sockaddr *)&peer_addr, &addr_len) == 0)
-    {
-        ip6hdr.fields.dst_addr = peer_addr.sin6_addr;
-    }
-    else
-    {
-        perror("Ошибка getpeername");
-        inet_pton(AF_INET6, "::1", &ip6hdr.fields.dst_addr);
-    }
-
-    memset(&dest_opt, 0, sizeof(dest_opt));
-    dest_opt.next_header = 6;                          // TCP
-    dest_opt.hdr_ext_len = 1;                          // Размер заголовка (1 блок по 8 байт)
-    dest_opt.opt_type = 0xC2;                          // Тип опции
-    dest_opt.opt_len = 8;                              // Длина данных опции
-    dest_opt.ram_address = htonll(0x123456789ABCDEF0); // Пример адреса
-
-    // Формирование пакета
-    char packet[sizeof(ip6hdr) + sizeof(dest_opt) + payload_size];
-    // memcpy: Копирует данные из одной области памяти в другую.
-    memcpy(packet, &ip6hdr, sizeof(ip6hdr));
-    memcpy(packet + sizeof(ip6hdr), &dest_opt, sizeof(dest_opt));
-    memcpy(packet + sizeof(ip6hdr) + sizeof(dest_opt), payload, payload_size);
-
-    if (send(sockfd, packet, sizeof(packet), 0) < 0)
+    if (ipv6_sender_send(sender, message, strlen(message)) < 0)
     {
         perror("Ошибка отправки IPv6 пакета");
     }
@@ -559,23 +363,28 @@ void *receive_messages(void *sock_ptr)
     // Сначала он приводится к типу (int *), а затем оператор (*) получает значение (файловый дескриптор),
     // на которое этот указатель ссылается.
     int sockfd = *((int *)sock_ptr);
-    char buffer[BUFFER_SIZE];
+    struct frame_ring ring;
+    struct ipv6_frame frame;
+    struct uring uring;
 
-    while (1)
+    if (frame_ring_init(&ring) < 0)
     {
-        ssize_t recv_bytes = recv(sockfd, buffer, BUFFER_SIZE, 0);
+        perror("Ошибка создания буфера приема");
+        close(sockfd);
+        exit(EXIT_FAILURE);
+    }
 
-        if (recv_bytes > 0)
-        {
-            printf("\n[СЕРВЕР] Получен сырой пакет (%ld байт):\n---\n", recv_bytes);
-            for (int i = 0; i < recv_bytes; i++)
-            {
-                printf("%02x ", (unsigned char)buffer[i]);
-                if ((i + 1) % 16 == 0)
-                    printf("\n");
-            }
-            printf("\n---\n");
-        }
+    // Кольцо io_uring потока приема: один многократный recv вместо вызова recv на каждую порцию данных
+    if (client_backend == BACKEND_URING && uring_init(&uring, 64, 64) < 0)
+    {
+        perror("io_uring недоступен, используется recv");
+        client_backend = BACKEND_EPOLL;
+    }
+
+    while (1)
+    {
+        ssize_t recv_bytes = client_backend == BACKEND_URING ? uring_recv(&uring, &ring, sockfd)
+                                                             : frame_ring_recv(&ring, sockfd);
 
         if (recv_bytes <= 0)
         {
@@ -587,67 +396,80 @@ void *receive_messages(void *sock_ptr)
             exit(0);
         }
 
-        // Обработка IPv6 пакета
-        if (recv_bytes >= sizeof(struct ipv6_header))
+        // Обработка всех полностью полученных IPv6 пакетов
+        int status;
+        while ((status = frame_ring_next(&ring, &frame)) > 0)
         {
-            // (struct ipv6_header *)buffer: Приведение типа для интерпретации данных из буфера как заголовка IPv6.
-            struct ipv6_header *ip6hdr = (struct ipv6_header *)buffer;
+            capture_frame(frame.hdr, frame.frame_len);
 
-            if (ip6hdr->fields.version == 6)
+            if (log_level < LOG_PACKETS)
             {
-                char src_ip[INET6_ADDRSTRLEN], dst_ip[INET6_ADDRSTRLEN];
-
-                inet_ntop(AF_INET6, &ip6hdr->fields.src_addr, src_ip, sizeof(src_ip));
-                inet_ntop(AF_INET6, &ip6hdr->fields.dst_addr, dst_ip, sizeof(dst_ip));
-
-                printf("\n=== Получен IPv6 пакет ===\n");
-                printf("Source: %s\n", src_ip);
-                printf("Destination: %s\n", dst_ip);
-                printf("Payload length: %u\n", ntohs(ip6hdr->fields.payload_len));
+                frame_ring_consume(&ring, &frame);
+                continue;
+            }
 
-                // Обработка опций назначения
-                if (ip6hdr->fields.next_header == 60 &&
-                    recv_bytes >= sizeof(struct ipv6_header) + sizeof(struct dest_options))
-                {
+            const struct ipv6_header *ip6hdr = frame.hdr;
+            char src_ip[INET6_ADDRSTRLEN], dst_ip[INET6_ADDRSTRLEN];
 
-                    // (struct dest_options *): Приведение типа указателя, смещенного на размер заголовка IPv6,
-                    // для доступа к данным опций назначения.
-                    struct dest_options *dest_opt = (struct dest_options *)(buffer + sizeof(struct ipv6_header));
+            inet_ntop(AF_INET6, &ip6hdr->fields.src_addr, src_ip, sizeof(src_ip));
+            inet_ntop(AF_INET6, &ip6hdr->fields.dst_addr, dst_ip, sizeof(dst_ip));
 
-                    printf("Option type: 0x%02X\n", dest_opt->opt_type);
-                    printf("LOCN: 0x%016lX\n", ntohll(dest_opt->ram_address));
+            printf("\n=== Получен IPv6 пакет ===\n");
+            printf("Source: %s\n", src_ip);
+            printf("Destination: %s\n", dst_ip);
+            printf("Payload length: %u\n", ntohs(ip6hdr->fields.payload_len));
 
-                    // Вывод данных
-                    char *payload = buffer + sizeof(struct ipv6_header) + sizeof(struct dest_options);
-                    size_t payload_size = recv_bytes - sizeof(struct ipv6_header) - sizeof(struct dest_options);
+            // Обработка опций назначения
+            if (frame.opts)
+            {
+                print_dest_options(frame.opts, frame.opts_len);
 
-                    if (payload_size > 0)
-                    {
-                        printf("Payload: %.*s\n", (int)payload_size, payload);
-                    }
+                // Вывод данных
+                if (frame.payload_len > 0)
+                {
+                    printf("Payload: %.*s\n", (int)frame.payload_len, frame.payload);
                 }
-                printf("> ");
-                // fflush: Принудительно сбрасывает буфер вывода. stdout - стандартный поток вывода.
-                // Это гарантирует, что приглашение "> " будет немедленно отображено в консоли.
-                fflush(stdout);
-                continue;
             }
+
+            frame_ring_consume(&ring, &frame);
+        }
+
+        if (status < 0)
+        {
+            fprintf(stderr, "Поврежденный IPv6 поток от сервера\n");
+            close(sockfd);
+            exit(EXIT_FAILURE);
         }
 
-        buffer[recv_bytes] = '\0';
-        printf("\n[СЕРВЕР]: %s\n> ", buffer);
+        printf("> ");
+        // fflush: Принудительно сбрасывает буфер вывода. stdout - стандартный поток вывода.
+        // Это гарантирует, что приглашение "> " будет немедленно отображено в консоли.
         fflush(stdout);
     }
     return NULL;
 }
 
 // Запуск клиента
-void start_client(const char *ipv6_addr)
+void start_client(const char *ipv6_addr, int zerocopy, int backend)
 {
     int sockfd;
     pthread_t recv_thread;
+    struct uring uring;
+
+    // static: Отправитель содержит очередь заголовков и iovec, слишком большую для стека.
+    static struct ipv6_sender sender;
+    struct ipv6_sender *senders[1] = {&sender};
 
-    connect_to_ipv6_server(ipv6_addr, &sockfd);
+    connect_to_ipv6_server(ipv6_addr, &sockfd, SOCK_STREAM);
+    ipv6_sender_init(&sender, sockfd, zerocopy);
+
+    // Отдельное кольцо для отправки: кольцо используется только создавшим его потоком
+    if (backend == BACKEND_URING && uring_init(&uring, 64, 0) < 0)
+    {
+        perror("io_uring недоступен, используется sendmsg");
+        backend = BACKEND_EPOLL;
+    }
+    client_backend = backend;
 
     if (pthread_create(&recv_thread, NULL, receive_messages, &sockfd))
     {
@@ -656,7 +478,8 @@ void start_client(const char *ipv6_addr)
         exit(EXIT_FAILURE);
     }
 
-    char message[BUFFER_SIZE];
+    // static: Буфер размером в максимальное сообщение слишком велик для стека.
+    static char message[MAX_PAYLOAD_SIZE + 1];
     while (1)
     {
         printf("> ");
@@ -664,7 +487,7 @@ void start_client(const char *ipv6_addr)
 
         // fgets: Читает строку из указанного потока (stdin - стандартный ввод) и сохраняет ее в буфер.
         // Читает до символа новой строки или до заполнения буфера.
-        if (fgets(message, BUFFER_SIZE, stdin) == NULL)
+        if (fgets(message, sizeof(message), stdin) == NULL)
         {
             break;
         }
@@ -679,9 +502,23 @@ void start_client(const char *ipv6_addr)
             break;
         }
 
-        send_ipv6_packet(sockfd, message);
+        if (backend == BACKEND_URING)
+        {
+            if (ipv6_sender_queue(&sender, message, strlen(message)) < 0 ||
+                uring_send_batch(&uring, senders, 1) < 0)
+                perror("Ошибка отправки IPv6 пакета");
+        }
+        else
+        {
+            send_ipv6_packet(&sender, message);
+        }
+
+        // При MSG_ZEROCOPY буфер message нельзя перезаписывать, пока ядро не подтвердит отправку.
+        ipv6_sender_reap_zerocopy(&sender);
     }
 
+    if (backend == BACKEND_URING)
+        uring_free(&uring);
     close(sockfd);
     // pthread_cancel: Отправляет запрос на отмену указанному потоку.
     pthread_cancel(recv_thread);
@@ -727,43 +564,246 @@ void get_link_local_ipv6() {
     freeifaddrs(ifaddr);
 }
 
-int main()
+// Коды параметров, у которых есть только длинная форма
+enum
+{
+    OPT_ECHO = 256,
+    OPT_CONNECTIONS,
+    OPT_THREADS,
+    OPT_SIZE,
+    OPT_RATE,
+    OPT_DURATION,
+    OPT_LOCN_COUNT,
+};
+
+// Вывод справки по параметрам командной строки
+void print_usage(const char *prog)
+{
+    printf("Использование: %s [параметры]\n"
+           "Без параметров запускается интерактивное меню.\n"
+           "  -m, --mode MODE      server | server-threads | client | compare | loadgen\n"
+           "                       compare - сравнение epoll и io_uring на ::1 (системные вызовы, переключения)\n"
+           "                       loadgen - генератор нагрузки с измерением задержки (сервер с --echo)\n"
+           "  -w, --workers N      количество потоков цикла epoll (0 - по числу ядер)\n"
+           "  -r, --reuseport      свой сокет SO_REUSEPORT и свое ядро у каждого потока\n"
+           "  -a, --address ADDR   IPv6 адрес сервера для режима client\n"
+           "  -z, --zerocopy       отправка крупных сообщений клиента с MSG_ZEROCOPY\n"
+           "  -b, --backend NAME   epoll (по умолчанию) | uring - механизм ввода-вывода сервера и клиента\n"
+           "  -t, --transport NAME tcp (по умолчанию) | udp - датаграммы с recvmmsg/sendmmsg\n"
+           "  -g, --gso            UDP GSO при отправке и UDP GRO при приеме (для --transport udp)\n"
+           "  -v, --verbose LEVEL  0 - только ошибки, 1 - подключения (по умолчанию), 2 - разбор каждого пакета\n"
+           "  -c, --capture FILE   запись принятых кадров в файл pcapng (читается capture_dump)\n"
+           "      --echo           сервер отвечает на каждый пакет (для loadgen)\n"
+           "      --connections N  loadgen: число соединений (по умолчанию 16)\n"
+           "      --threads N      loadgen: число потоков (по умолчанию 1)\n"
+           "      --size BYTES     loadgen: размер полезной нагрузки (по умолчанию 64)\n"
+           "      --rate PPS       loadgen: пакетов в секунду, 0 - замкнутый цикл (по умолчанию)\n"
+           "      --duration SEC   loadgen: длительность теста (по умолчанию 5)\n"
+           "      --locn N         адресов LOCN в опциях назначения каждого пакета (по умолчанию 1)\n"
+           "  -h, --help           эта справка\n",
+           prog);
+}
+
+int main(int argc, char *argv[])
 {
     int mode;
-    printf("Выберите режим:\n1. Сервер IPv6\n2. Клиент IPv6\n> ");
-    // scanf: Читает форматированный ввод из стандартного потока ввода.
-    // "%d": Ожидает целое десятичное число.
-    // Возвращает количество успешно считанных элементов.
-    if (scanf("%d", &mode) != 1)
+    struct server_config config = {.workers = 0, .on_packet = process_ipv6_packet};
+    char ipv6_addr[INET6_ADDRSTRLEN] = "";
+    int zerocopy = 0;
+    const char *capture_path = NULL;
+    int transport = SOCK_STREAM;
+    struct loadgen_config load = {.connections = 16, .threads = 1, .payload_size = 64, .rate = 0, .duration = 5};
+
+    if (argc > 1)
     {
-        printf("Ошибка ввода\n");
-        return 1;
+        // getopt_long: Разбирает короткие (-m) и длинные (--mode) параметры командной строки.
+        static const struct option long_options[] = {
+            {"mode", required_argument, NULL, 'm'},
+            {"workers", required_argument, NULL, 'w'},
+            {"reuseport", no_argument, NULL, 'r'},
+            {"address", required_argument, NULL, 'a'},
+            {"zerocopy", no_argument, NULL, 'z'},
+            {"backend", required_argument, NULL, 'b'},
+            {"transport", required_argument, NULL, 't'},
+            {"gso", no_argument, NULL, 'g'},
+            {"echo", no_argument, NULL, OPT_ECHO},
+            {"connections", required_argument, NULL, OPT_CONNECTIONS},
+            {"threads", required_argument, NULL, OPT_THREADS},
+            {"size", required_argument, NULL, OPT_SIZE},
+            {"rate", required_argument, NULL, OPT_RATE},
+            {"duration", required_argument, NULL, OPT_DURATION},
+            {"locn", required_argument, NULL, OPT_LOCN_COUNT},
+            {"verbose", required_argument, NULL, 'v'},
+            {"capture", required_argument, NULL, 'c'},
+            {"help", no_argument, NULL, 'h'},
+            {NULL, 0, NULL, 0}};
+        int opt;
+
+        mode = 0;
+        while ((opt = getopt_long(argc, argv, "m:w:ra:zb:t:gv:c:h", long_options, NULL)) != -1)
+        {
+            switch (opt)
+            {
+            case 'm':
+                if (strcmp(optarg, "server") == 0)
+                    mode = 1;
+                else if (strcmp(optarg, "client") == 0)
+                    mode = 2;
+                else if (strcmp(optarg, "server-threads") == 0)
+                    mode = 3;
+                else if (strcmp(optarg, "compare") == 0)
+                    mode = 4;
+                else if (strcmp(optarg, "loadgen") == 0)
+                    mode = 5;
+                break;
+            case 'w':
+                config.workers = atoi(optarg);
+                break;
+            case 'r':
+                config.reuseport = 1;
+                break;
+            case 'a':
+                strncpy(ipv6_addr, optarg, sizeof(ipv6_addr) - 1);
+                break;
+            case 'z':
+                zerocopy = 1;
+                break;
+            case 't':
+                if (strcmp(optarg, "udp") == 0)
+                    transport = SOCK_DGRAM;
+                else if (strcmp(optarg, "tcp") == 0)
+                    transport = SOCK_STREAM;
+                else
+                {
+                    fprintf(stderr, "Неизвестный транспорт: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'g':
+                config.gso = 1;
+                break;
+            case OPT_ECHO:
+                config.on_packet = echo_ipv6_packet;
+                break;
+            case OPT_CONNECTIONS:
+                load.connections = atoi(optarg);
+                break;
+            case OPT_THREADS:
+                load.threads = atoi(optarg);
+                break;
+            case OPT_SIZE:
+                load.payload_size = atoi(optarg);
+                break;
+            case OPT_RATE:
+                load.rate = atol(optarg);
+                break;
+            case OPT_DURATION:
+                load.duration = atoi(optarg);
+                break;
+            case OPT_LOCN_COUNT:
+                sender_locn_count = atoi(optarg);
+                if (sender_locn_count < 0 || sender_locn_count > EXT_MAX_LOCN)
+                {
+                    fprintf(stderr, "Число адресов LOCN должно быть от 0 до %d\n", EXT_MAX_LOCN);
+                    return 1;
+                }
+                break;
+            case 'b':
+                if (strcmp(optarg, "uring") == 0)
+                    config.backend = BACKEND_URING;
+                else if (strcmp(optarg, "epoll") == 0)
+                    config.backend = BACKEND_EPOLL;
+                else
+                {
+                    fprintf(stderr, "Неизвестный механизм ввода-вывода: %s\n", optarg);
+                    return 1;
+                }
+                break;
+            case 'v':
+                log_level = atoi(optarg);
+                break;
+            case 'c':
+                capture_path = optarg;
+                break;
+            default:
+                print_usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+            }
+        }
+
+        if (mode == 2 && ipv6_addr[0] == '\0')
+        {
+            fprintf(stderr, "Для режима client требуется параметр --address\n");
+            return 1;
+        }
     }
-    // getchar: Считывает один символ из стандартного потока ввода.
-    // Используется здесь для "поглощения" символа новой строки, оставшегося в буфере после scanf.
-    getchar();
+    else
+    {
+        // Интерактивный режим сохраняет прежнее поведение: разбор каждого пакета на экране
+        log_level = LOG_PACKETS;
+
+        printf("Выберите режим:\n1. Сервер IPv6 (epoll)\n2. Клиент IPv6\n3. Сервер IPv6 (поток на клиента)\n> ");
+        // scanf: Читает форматированный ввод из стандартного потока ввода.
+        // "%d": Ожидает целое десятичное число.
+        // Возвращает количество успешно считанных элементов.
+        if (scanf("%d", &mode) != 1)
+        {
+            printf("Ошибка ввода\n");
+            return 1;
+        }
+        // getchar: Считывает один символ из стандартного потока ввода.
+        // Используется здесь для "поглощения" символа новой строки, оставшегося в буфере после scanf.
+        getchar();
+
+        if (mode == 2)
+        {
+            printf("Введите IPv6 адрес сервера: ");
+            if (fgets(ipv6_addr, sizeof(ipv6_addr), stdin) == NULL)
+            {
+                printf("Ошибка ввода\n");
+                return 1;
+            }
+            ipv6_addr[strcspn(ipv6_addr, "\n")] = '\0';
+        }
+    }
+
+    if (capture_path && capture_start(capture_path) < 0)
+        return 1;
 
     if (mode == 1)
     {
         get_link_local_ipv6();
-        start_server();
+        if (transport == SOCK_DGRAM)
+            start_dgram_server(&config);
+        else
+            start_event_server(&config);
     }
     else if (mode == 2)
     {
-        char ipv6_addr[INET6_ADDRSTRLEN];
-        printf("Введите IPv6 адрес сервера: ");
-        if (fgets(ipv6_addr, sizeof(ipv6_addr), stdin) == NULL)
-        {
-            printf("Ошибка ввода\n");
-            return 1;
-        }
-        ipv6_addr[strcspn(ipv6_addr, "\n")] = '\0';
-        start_client(ipv6_addr);
+        if (transport == SOCK_DGRAM)
+            start_dgram_client(ipv6_addr, config.gso);
+        else
+            start_client(ipv6_addr, zerocopy, config.backend);
+    }
+    else if (mode == 3)
+    {
+        get_link_local_ipv6();
+        start_server();
+    }
+    else if (mode == 4)
+    {
+        run_io_compare();
+    }
+    else if (mode == 5)
+    {
+        load.address = ipv6_addr[0] ? ipv6_addr : "::1";
+        run_loadgen(&load);
     }
     else
     {
         printf("Некорректный выбор\n");
     }
 
+    capture_stop();
     return 0;
 }
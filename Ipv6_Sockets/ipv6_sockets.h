@@ -0,0 +1,340 @@
+#ifndef IPV6_SOCKETS_H
+#define IPV6_SOCKETS_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <ifaddrs.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <pthread.h>
+#include <errno.h>
+#include <endian.h>
+#include <net/if.h>
+#include <sys/uio.h>
+
+#define PORT 8080
+
+// Структура IPv6 заголовка
+struct ipv6_header
+{
+    union
+    {
+        struct
+        {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+            uint32_t traffic_class : 8;
+            uint32_t flow_label : 20;
+            uint32_t version : 4;
+#else
+            uint32_t version : 4;
+            uint32_t traffic_class : 8;
+            uint32_t flow_label : 20;
+#endif
+            uint16_t payload_len;
+            uint8_t next_header;
+            uint8_t hop_limit;
+            struct in6_addr src_addr;
+            struct in6_addr dst_addr;
+        } fields;
+        uint8_t raw[40];
+    };
+};
+
+// Заголовок опций назначения (RFC 8200, раздел 4.6). За двумя байтами заголовка идут
+// опции в формате TLV (тип, длина, данные) до общей длины (hdr_ext_len + 1) * 8 байт.
+struct dest_options
+{
+    uint8_t next_header;
+    uint8_t hdr_ext_len;
+    uint8_t options[];
+};
+
+// Максимальная длина заголовка опций назначения: hdr_ext_len = 255
+#define DEST_OPTIONS_MAX_SIZE ((255 + 1) * 8)
+// Типы опций: выравнивание Pad1 и PadN, адрес LOCN (8 байт данных)
+#define OPT_PAD1 0x00
+#define OPT_PADN 0x01
+#define OPT_LOCN 0xC2
+#define OPT_LOCN_SIZE 10
+// Больше адресов LOCN в один заголовок не помещается
+#define EXT_MAX_LOCN ((DEST_OPTIONS_MAX_SIZE - 2) / OPT_LOCN_SIZE)
+
+// Опции назначения, собранные обходом TLV (ext_headers.c)
+struct ext_options
+{
+    uint64_t locn[EXT_MAX_LOCN]; // Адреса LOCN в хостовом порядке байт
+    int locn_count;
+    int pad_bytes;               // Байт выравнивания Pad1/PadN
+    int skipped;                 // Неизвестных опций, пропущенных по биту действия
+};
+
+// Максимальный размер кадра: заголовок IPv6 и до 65535 байт после него (поле payload_len)
+#define FRAME_MAX_SIZE (sizeof(struct ipv6_header) + 65535)
+// Максимальный размер сообщения в одном кадре (при самом коротком заголовке опций - 8 байт)
+#define MAX_PAYLOAD_SIZE (65535 - 8)
+
+// Кольцевой буфер для сборки кадров из TCP-потока (frame_buffer.c).
+// Позиции head/tail отсчитываются от начала буфера, данные [head, tail) всегда непрерывны в памяти.
+struct frame_ring
+{
+    char *data;
+    size_t capacity;
+    size_t head; // Начало необработанных данных
+    size_t tail; // Конец полученных данных
+};
+
+// Полный кадр, разобранный на месте внутри кольцевого буфера (без копирования)
+struct ipv6_frame
+{
+    const struct ipv6_header *hdr;
+    const struct dest_options *opts; // NULL, если в цепочке заголовков нет опций назначения
+    size_t opts_len;                 // Длина заголовка опций назначения
+    const char *payload;
+    size_t payload_len;
+    size_t frame_len; // Полная длина кадра вместе с заголовком
+};
+
+// Максимальное число сообщений в очереди отправителя (3 iovec на сообщение, не больше IOV_MAX)
+#define SENDER_MAX_QUEUE 256
+// Минимальный объем отправки, начиная с которого используется MSG_ZEROCOPY
+#define ZEROCOPY_THRESHOLD (16 * 1024)
+
+// Отправитель IPv6 пакетов для одного соединения (packet_sender.c).
+// Адреса и шаблоны заголовков готовятся один раз, сообщения копятся в очереди
+// и уходят одним вызовом sendmsg без копирования полезной нагрузки.
+struct ipv6_sender
+{
+    int sockfd;
+    struct ipv6_header header;    // Шаблон заголовка с адресами соединения
+    uint8_t options[DEST_OPTIONS_MAX_SIZE]; // Шаблон опций назначения, общий для всех сообщений
+    size_t options_len;
+    struct ipv6_header headers[SENDER_MAX_QUEUE]; // Заголовки сообщений в очереди
+    struct iovec iov[SENDER_MAX_QUEUE * 3];
+    int queued;          // Сообщений в очереди
+    int iov_first;       // Первый неотправленный iovec
+    int iov_count;       // Заполненных iovec
+    size_t queued_bytes; // Неотправленных байт
+    int zerocopy;        // Включен SO_ZEROCOPY
+    uint32_t zc_pending; // Отправок MSG_ZEROCOPY без подтверждения
+    uint64_t syscalls;   // Счетчик вызовов sendmsg
+};
+
+// Дескриптор соединения: (поколение << 32) | индекс записи в таблице соединений.
+// Значение 0 никогда не выдается и означает "нет соединения".
+typedef uint64_t conn_handle_t;
+
+// Информация о клиенте (запись таблицы соединений)
+typedef struct
+{
+    int sockfd;
+    struct sockaddr_in6 addr;
+    pthread_t thread_id;
+    struct frame_ring ring;  // Буфер сборки кадров, сохраняется при повторном использовании записи
+    int owner;               // Номер рабочего потока цикла событий, принявшего соединение
+    conn_handle_t handle;    // Дескриптор, выданный при занятии записи
+    uint32_t index;          // Номер записи в таблице
+    uint32_t generation;     // Поколение записи, увеличивается при каждом освобождении
+    uint32_t next_free;      // Следующая запись в списке свободных
+} client_t;
+
+// Записей в одном блоке таблицы соединений и максимальное число блоков
+#define CONN_CHUNK_SHIFT 10
+#define CONN_CHUNK_SIZE (1u << CONN_CHUNK_SHIFT)
+#define CONN_MAX_CHUNKS 4096
+
+// Таблица соединений без блокировок (conn_table.c)
+struct conn_table
+{
+    client_t *chunks[CONN_MAX_CHUNKS]; // Блоки записей, выделяются по мере роста
+    uint64_t free_head;                // Вершина списка свободных записей с меткой ABA
+    uint32_t next_unused;              // Первая ни разу не использованная запись
+    int active;                        // Число занятых записей
+};
+
+// Обработчик полученного кадра. Вызывается из цикла событий для каждого полного кадра.
+typedef void (*packet_handler_t)(client_t *client, const struct ipv6_frame *frame);
+
+// Механизм ввода-вывода сервера и клиента
+#define BACKEND_EPOLL 0 // Готовность через epoll, затем recv/sendmsg
+#define BACKEND_URING 1 // Запросы и результаты через кольца io_uring (uring_backend.c)
+
+// Параметры сервера
+struct server_config
+{
+    int workers;                 // Количество потоков с собственным циклом epoll (0 - по числу ядер)
+    int reuseport;               // Отдельный слушающий сокет SO_REUSEPORT и закрепление за ядром для каждого потока
+    int backend;                 // BACKEND_EPOLL или BACKEND_URING
+    int gso;                     // UDP GRO на приеме в датаграммном режиме
+    packet_handler_t on_packet;  // Обработчик полученных данных
+};
+
+// Рабочий поток сервера со своим экземпляром epoll или кольцом io_uring
+struct event_worker
+{
+    int id;
+    int epoll_fd;  // Только для BACKEND_EPOLL
+    int listen_fd; // Общий сокет или собственный сокет SO_REUSEPORT
+    int stop_fd;   // eventfd остановки сервера
+    int cpu;       // Ядро, за которым закреплен поток (-1 - без закрепления)
+    pthread_t thread;
+    const struct server_config *config;
+};
+
+// Метки служебных запросов: epoll_event.data.u64 и user_data запросов io_uring. Для соединений там
+// хранится дескриптор записи таблицы, у которого поколение никогда не равно 0, поэтому значения не пересекаются.
+#define LISTEN_TAG 1
+#define STOP_TAG 2
+
+// Кольца io_uring одного потока (uring_backend.c). Отображаются из ядра при создании:
+// в очередь отправки (SQ) программа кладет запросы, из очереди завершения (CQ) забирает результаты.
+struct io_uring_sqe;
+struct io_uring_cqe;
+struct io_uring_buf_ring;
+
+struct uring
+{
+    int fd;
+    unsigned sq_entries;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned sq_local_tail; // Хвост SQ с еще не опубликованными для ядра запросами
+    struct io_uring_sqe *sqes;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    void *ring_ptr;
+    size_t ring_size;
+    size_t sqes_size;
+    struct io_uring_buf_ring *buf_ring; // Кольцо буферов приема, из которого ядро само выбирает буфер
+    char *buffers;
+    unsigned buf_count;
+    unsigned short buf_tail;
+    int recv_armed;     // Для uring_recv: многократный recv активен
+    int pending_bid;    // Для uring_recv: буфер с еще не переданными данными
+    size_t pending_off;
+    size_t pending_len;
+};
+
+// Счетчик системных вызовов ввода-вывода (accept, recv, sendmsg, epoll_wait, io_uring_enter и т.п.),
+// по которому режим сравнения показывает разницу между механизмами.
+extern uint64_t io_syscalls;
+
+static inline void count_syscall()
+{
+    __atomic_fetch_add(&io_syscalls, 1, __ATOMIC_RELAXED);
+}
+
+// Уровни подробности вывода
+#define LOG_QUIET 0   // Ничего на каждое соединение и пакет (рабочий режим)
+#define LOG_EVENTS 1  // Подключения, отключения и ошибки
+#define LOG_PACKETS 2 // Полный разбор каждого пакета (демонстрационный режим)
+
+// Максимальная длина кадра, сохраняемая при захвате
+#define CAPTURE_SNAPLEN ((uint32_t)FRAME_MAX_SIZE)
+
+// Глобальные переменные сервера
+extern struct conn_table connections;
+extern volatile int server_active;
+extern volatile int log_level;
+
+// Прототипы функций
+void start_server();
+void start_client(const char *ipv6_addr, int zerocopy, int backend);
+void *handle_client(void *client_data);
+void process_ipv6_packet(client_t *client, const struct ipv6_frame *frame);
+void setup_server_socket(int *server_fd, int reuseport);
+void accept_connections(int server_fd);
+void cleanup_resources(int server_fd);
+void *receive_messages(void *sock_ptr);
+void connect_to_ipv6_server(const char *ipv6_addr, int *sockfd, int type);
+void send_ipv6_packet(struct ipv6_sender *sender, const char *message);
+
+// Вывод пакетов (packet_print.c)
+void print_ipv6_header(const struct ipv6_header *hdr);
+void print_dest_options(const struct dest_options *opts, size_t len);
+void print_frame(const struct ipv6_frame *frame);
+uint64_t htonll(uint64_t value);
+uint64_t ntohll(uint64_t value);
+
+// Захват пакетов в pcapng (capture.c)
+int capture_start(const char *path);
+void capture_stop();
+void capture_frame(const void *data, size_t len);
+
+// Таблица соединений (conn_table.c)
+void conn_table_init(struct conn_table *table);
+void conn_table_destroy(struct conn_table *table);
+client_t *conn_table_acquire(struct conn_table *table);
+void conn_table_release(struct conn_table *table, client_t *client);
+client_t *conn_table_get(struct conn_table *table, conn_handle_t handle);
+int conn_table_active(struct conn_table *table);
+void conn_table_foreach(struct conn_table *table, void (*fn)(client_t *client, void *arg), void *arg);
+
+// Сборка кадров (frame_buffer.c)
+int frame_ring_init(struct frame_ring *ring);
+void frame_ring_free(struct frame_ring *ring);
+ssize_t frame_ring_recv(struct frame_ring *ring, int sockfd);
+int ipv6_frame_parse(const char *data, size_t len, struct ipv6_frame *frame);
+int frame_ring_next(struct frame_ring *ring, struct ipv6_frame *frame);
+void frame_ring_consume(struct frame_ring *ring, const struct ipv6_frame *frame);
+size_t frame_ring_append(struct frame_ring *ring, const void *data, size_t len);
+
+// Заголовки расширения (ext_headers.c)
+int ext_chain_parse(struct ipv6_frame *frame, uint8_t next_header);
+int ext_options_walk(const struct dest_options *opts, size_t len, struct ext_options *out);
+size_t ext_options_build(uint8_t *buf, uint8_t next_header, const uint64_t *locn, int count);
+uint64_t ipv6_validate_batch(const struct iovec *frames, int count);
+
+// Отправка пакетов (packet_sender.c)
+extern int sender_locn_count;
+int ipv6_sender_init(struct ipv6_sender *sender, int sockfd, int zerocopy);
+int ipv6_sender_queue(struct ipv6_sender *sender, const void *payload, size_t payload_size);
+int ipv6_sender_flush(struct ipv6_sender *sender);
+void ipv6_sender_advance(struct ipv6_sender *sender, size_t sent);
+int ipv6_sender_send(struct ipv6_sender *sender, const void *payload, size_t payload_size);
+int ipv6_sender_reap_zerocopy(struct ipv6_sender *sender);
+
+// Событийный сервер (event_loop.c)
+void start_event_server(const struct server_config *config);
+void stop_event_server();
+client_t *open_conn(struct event_worker *worker, int fd, const struct sockaddr_in6 *addr);
+void close_conn(client_t *client);
+
+// Механизм io_uring (uring_backend.c)
+int uring_init(struct uring *ring, unsigned entries, unsigned buffers);
+void uring_free(struct uring *ring);
+int uring_supported();
+void *uring_worker_loop(void *arg);
+ssize_t uring_recv(struct uring *ring, struct frame_ring *frames, int sockfd);
+int uring_send_batch(struct uring *ring, struct ipv6_sender **senders, int count);
+
+// Датаграммный режим (dgram.c)
+void start_dgram_server(const struct server_config *config);
+void start_dgram_client(const char *ipv6_addr, int gso);
+int dgram_flush(struct ipv6_sender *sender, int gso);
+
+// Генератор нагрузки (loadgen.c)
+struct loadgen_config
+{
+    const char *address; // Адрес сервера
+    int connections;     // Всего соединений
+    int threads;         // Потоков генератора
+    int payload_size;    // Размер полезной нагрузки (не меньше отметки времени, 16 байт)
+    long rate;           // Пакетов в секунду на все соединения (0 - замкнутый цикл)
+    int duration;        // Длительность теста, секунды
+};
+
+void run_loadgen(const struct loadgen_config *config);
+void echo_ipv6_packet(client_t *client, const struct ipv6_frame *frame);
+
+// Сравнение механизмов ввода-вывода (io_compare.c)
+void run_io_compare();
+
+#endif // IPV6_SOCKETS_H
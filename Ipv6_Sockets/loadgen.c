@@ -0,0 +1,472 @@
+#include "ipv6_sockets.h"
+#include <poll.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <time.h>
+
+// Генератор нагрузки и измерение задержки. T потоков открывают M соединений и отправляют
+// пакеты с отметкой времени в начале полезной нагрузки; сервер в режиме --echo отвечает
+// коротким пакетом с той же отметкой. По ответам строится гистограмма задержки в стиле HDR:
+// логарифмические интервалы, каждый разбит на 64 равные части, поэтому относительная
+// погрешность любого перцентиля не больше 1/64 при фиксированном размере гистограммы.
+//
+// Замкнутый цикл (--rate 0): у каждого соединения один пакет в пути, следующий уходит после ответа.
+// Фиксированная скорость: пакеты уходят по расписанию независимо от ответов, а задержка
+// отсчитывается от запланированного времени отправки, чтобы задержка самого генератора
+// не скрывала задержку сервера (coordinated omission).
+
+#define LOADGEN_SUB_BITS 6
+#define LOADGEN_SUB_COUNT (1 << LOADGEN_SUB_BITS)
+#define LOADGEN_BUCKETS (2 * LOADGEN_SUB_COUNT + 57 * LOADGEN_SUB_COUNT)
+#define LOADGEN_MAX_EVENTS 256
+#define LOADGEN_DRAIN_NS 500000000ull // Ожидание последних ответов после окончания теста
+
+// Отметка в начале полезной нагрузки. Сервер --echo возвращает ее без изменений.
+struct loadgen_stamp
+{
+    uint64_t send_ns; // Время отправки (запланированное при фиксированной скорости), CLOCK_MONOTONIC
+    uint64_t seq;     // Номер пакета в соединении
+};
+
+// Гистограмма задержки, наносекунды
+struct latency_histogram
+{
+    uint64_t counts[LOADGEN_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+};
+
+struct loadgen_conn
+{
+    struct ipv6_sender sender;
+    struct frame_ring ring;
+    uint64_t seq;
+};
+
+struct loadgen_thread
+{
+    int id;
+    int first_conn; // Соединения потока: [first_conn, first_conn + conn_count)
+    int conn_count;
+    pthread_t thread;
+    const struct loadgen_config *config;
+    uint64_t sent;
+    uint64_t received;
+    uint64_t errors;
+    struct latency_histogram histogram;
+};
+
+static struct loadgen_conn *loadgen_conns;
+static pthread_barrier_t loadgen_barrier;
+static uint64_t loadgen_start_ns;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// Номер интервала гистограммы: значения до 128 хранятся точно, дальше - 64 части на каждую степень двойки
+static int histogram_bucket(uint64_t value)
+{
+    if (value < 2 * LOADGEN_SUB_COUNT)
+        return (int)value;
+
+    int msb = 63 - __builtin_clzll(value);
+    int shift = msb - LOADGEN_SUB_BITS;
+    int top = (int)(value >> shift); // [64, 128)
+    return 2 * LOADGEN_SUB_COUNT + (shift - 1) * LOADGEN_SUB_COUNT + (top - LOADGEN_SUB_COUNT);
+}
+
+// Верхняя граница значений интервала
+static uint64_t histogram_value(int bucket)
+{
+    if (bucket < 2 * LOADGEN_SUB_COUNT)
+        return bucket;
+
+    int shift = (bucket - 2 * LOADGEN_SUB_COUNT) / LOADGEN_SUB_COUNT + 1;
+    uint64_t top = (bucket - 2 * LOADGEN_SUB_COUNT) % LOADGEN_SUB_COUNT + LOADGEN_SUB_COUNT;
+    return ((top + 1) << shift) - 1;
+}
+
+static void histogram_record(struct latency_histogram *h, uint64_t value)
+{
+    h->counts[histogram_bucket(value)]++;
+    if (h->total == 0 || value < h->min)
+        h->min = value;
+    if (value > h->max)
+        h->max = value;
+    h->total++;
+}
+
+static void histogram_merge(struct latency_histogram *to, const struct latency_histogram *from)
+{
+    if (from->total == 0)
+        return;
+    for (int i = 0; i < LOADGEN_BUCKETS; i++)
+        to->counts[i] += from->counts[i];
+    if (to->total == 0 || from->min < to->min)
+        to->min = from->min;
+    if (from->max > to->max)
+        to->max = from->max;
+    to->total += from->total;
+}
+
+// Значение перцентиля p (0..100)
+static uint64_t histogram_percentile(const struct latency_histogram *h, double p)
+{
+    uint64_t rank = (uint64_t)(p / 100.0 * h->total + 0.5);
+    uint64_t seen = 0;
+
+    if (rank == 0)
+        rank = 1;
+    for (int i = 0; i < LOADGEN_BUCKETS; i++)
+    {
+        seen += h->counts[i];
+        if (seen >= rank)
+            return histogram_value(i) < h->max ? histogram_value(i) : h->max;
+    }
+    return h->max;
+}
+
+// Отправка пакета с отметкой времени
+static int loadgen_send(struct loadgen_thread *thread, struct loadgen_conn *conn, char *payload, uint64_t stamp_ns)
+{
+    struct loadgen_stamp stamp = {stamp_ns, conn->seq++};
+
+    memcpy(payload, &stamp, sizeof(stamp));
+    if (ipv6_sender_send(&conn->sender, payload, thread->config->payload_size) < 0)
+    {
+        thread->errors++;
+        return -1;
+    }
+    thread->sent++;
+    return 0;
+}
+
+// Чтение ответов соединения. Возвращает число полученных ответов или -1 при закрытии.
+static int loadgen_receive(struct loadgen_thread *thread, struct loadgen_conn *conn)
+{
+    struct ipv6_frame frame;
+    int acks = 0;
+
+    ssize_t recv_bytes = frame_ring_recv(&conn->ring, conn->sender.sockfd);
+    if (recv_bytes <= 0)
+        return -1;
+
+    uint64_t now = now_ns();
+    int status;
+    while ((status = frame_ring_next(&conn->ring, &frame)) > 0)
+    {
+        struct loadgen_stamp stamp;
+        if (frame.payload_len >= sizeof(stamp))
+        {
+            memcpy(&stamp, frame.payload, sizeof(stamp));
+            histogram_record(&thread->histogram, now > stamp.send_ns ? now - stamp.send_ns : 0);
+            thread->received++;
+            acks++;
+        }
+        frame_ring_consume(&conn->ring, &frame);
+    }
+    return status < 0 ? -1 : acks;
+}
+
+// Поток генератора: свои соединения, свой epoll для ответов
+static void *loadgen_thread_loop(void *arg)
+{
+    struct loadgen_thread *thread = (struct loadgen_thread *)arg;
+    const struct loadgen_config *config = thread->config;
+    struct loadgen_conn *conns = &loadgen_conns[thread->first_conn];
+    struct epoll_event events[LOADGEN_MAX_EVENTS];
+    char *payload = calloc(1, config->payload_size);
+    int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+
+    if (payload == NULL || epoll_fd < 0)
+    {
+        perror("Ошибка подготовки потока нагрузки");
+        exit(EXIT_FAILURE);
+    }
+
+    for (int i = 0; i < thread->conn_count; i++)
+    {
+        struct epoll_event ev = {.events = EPOLLIN, .data.u32 = i};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, conns[i].sender.sockfd, &ev);
+    }
+
+    // Все потоки начинают одновременно, когда все соединения открыты
+    pthread_barrier_wait(&loadgen_barrier);
+    uint64_t start = loadgen_start_ns;
+    uint64_t deadline = start + (uint64_t)config->duration * 1000000000ull;
+
+    // Фиксированная скорость: у потока своя доля общей скорости
+    uint64_t interval = config->rate > 0 ? (uint64_t)(1e9 * config->threads / config->rate) : 0;
+    uint64_t next_send = start;
+    int next_conn = 0;
+
+    if (interval == 0)
+    {
+        // Замкнутый цикл: первый пакет в каждом соединении
+        for (int i = 0; i < thread->conn_count; i++)
+            loadgen_send(thread, &conns[i], payload, now_ns());
+    }
+
+    for (;;)
+    {
+        uint64_t now = now_ns();
+        int sending = now < deadline;
+
+        if (!sending && (thread->received >= thread->sent || now >= deadline + LOADGEN_DRAIN_NS))
+            break;
+
+        // Отправка всех пакетов, время которых наступило (при отставании - пачкой)
+        if (interval && sending)
+        {
+            while (next_send <= now && next_send < deadline)
+            {
+                loadgen_send(thread, &conns[next_conn], payload, next_send);
+                next_conn = (next_conn + 1) % thread->conn_count;
+                next_send += interval;
+            }
+        }
+
+        // epoll_pwait2: Ожидание с наносекундной точностью - до следующей отправки по расписанию
+        uint64_t wake = sending ? (interval ? next_send : deadline) : deadline + LOADGEN_DRAIN_NS;
+        uint64_t wait = wake > now ? wake - now : 0;
+        struct timespec timeout = {(time_t)(wait / 1000000000ull), (long)(wait % 1000000000ull)};
+
+        int n = epoll_pwait2(epoll_fd, events, LOADGEN_MAX_EVENTS, &timeout, NULL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            perror("Ошибка epoll_pwait2");
+            break;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            struct loadgen_conn *conn = &conns[events[i].data.u32];
+            int acks = loadgen_receive(thread, conn);
+            if (acks < 0)
+            {
+                fprintf(stderr, "Сервер закрыл соединение\n");
+                epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->sender.sockfd, NULL);
+                thread->errors++;
+                continue;
+            }
+
+            // Замкнутый цикл: ответ получен - следующий пакет
+            if (interval == 0 && now_ns() < deadline)
+            {
+                for (int a = 0; a < acks; a++)
+                    loadgen_send(thread, conn, payload, now_ns());
+            }
+        }
+    }
+
+    close(epoll_fd);
+    free(payload);
+    return NULL;
+}
+
+// Вывод отчета по всем потокам
+static void loadgen_report(const struct loadgen_config *config, struct loadgen_thread *threads, double seconds)
+{
+    static struct latency_histogram total;
+    uint64_t sent = 0, received = 0, errors = 0;
+
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < config->threads; i++)
+    {
+        sent += threads[i].sent;
+        received += threads[i].received;
+        errors += threads[i].errors;
+        histogram_merge(&total, &threads[i].histogram);
+    }
+
+    size_t frame_size = sizeof(struct ipv6_header) + loadgen_conns[0].sender.options_len + config->payload_size;
+
+    printf("\nНагрузка: %d соединений, %d потоков, %d байт данных (%zu байт кадр), %s\n",
+           config->connections, config->threads, config->payload_size, frame_size,
+           config->rate > 0 ? "фиксированная скорость" : "замкнутый цикл");
+    if (config->rate > 0)
+        printf("Заданная скорость: %ld пакетов/с\n", config->rate);
+    printf("Время: %.2f с, отправлено: %lu, ответов: %lu, ошибок: %lu\n", seconds, sent, received, errors);
+    printf("Пропускная способность: %.0f пакетов/с, %.2f МБ/с\n",
+           received / seconds, received * frame_size / seconds / 1e6);
+
+    if (total.total == 0)
+        return;
+
+    printf("Задержка (мкс): min %.1f  p50 %.1f  p90 %.1f  p99 %.1f  p99.9 %.1f  max %.1f\n",
+           total.min / 1e3, histogram_percentile(&total, 50) / 1e3, histogram_percentile(&total, 90) / 1e3,
+           histogram_percentile(&total, 99) / 1e3, histogram_percentile(&total, 99.9) / 1e3, total.max / 1e3);
+
+    // Распределение по степеням двойки, как в выводе HdrHistogram
+    printf("\n     до, мкс      пакетов   накоплено\n");
+    uint64_t seen = 0;
+    for (int i = 0; i < LOADGEN_BUCKETS;)
+    {
+        int msb = 63 - __builtin_clzll(histogram_value(i) | 1);
+        uint64_t count = 0;
+
+        while (i < LOADGEN_BUCKETS && 63 - __builtin_clzll(histogram_value(i) | 1) == msb)
+            count += total.counts[i++];
+        if (count == 0)
+            continue;
+
+        seen += count;
+        printf("%12.1f %12lu %10.4f%%\n", ((2ull << msb) - 1) / 1e3, count, 100.0 * seen / total.total);
+    }
+}
+
+// Режим генератора нагрузки
+void run_loadgen(const struct loadgen_config *config)
+{
+    struct loadgen_config cfg = *config;
+
+    if (cfg.threads <= 0)
+        cfg.threads = 1;
+    if (cfg.connections < cfg.threads)
+        cfg.connections = cfg.threads;
+    if (cfg.payload_size < (int)sizeof(struct loadgen_stamp))
+        cfg.payload_size = sizeof(struct loadgen_stamp);
+    if (cfg.payload_size > (int)MAX_PAYLOAD_SIZE)
+        cfg.payload_size = MAX_PAYLOAD_SIZE;
+    if (cfg.duration <= 0)
+        cfg.duration = 5;
+
+    loadgen_conns = calloc(cfg.connections, sizeof(*loadgen_conns));
+    struct loadgen_thread *threads = calloc(cfg.threads, sizeof(*threads));
+    if (loadgen_conns == NULL || threads == NULL)
+    {
+        perror("Ошибка выделения памяти для соединений");
+        exit(EXIT_FAILURE);
+    }
+
+    // Подключения без вывода на каждое соединение
+    int saved_level = log_level;
+    log_level = LOG_QUIET;
+    for (int i = 0; i < cfg.connections; i++)
+    {
+        int sockfd;
+        connect_to_ipv6_server(cfg.address, &sockfd, SOCK_STREAM);
+
+        // TCP_NODELAY: Пакет уходит сразу, без ожидания подтверждения предыдущего (алгоритм Нейгла)
+        int one = 1;
+        setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        ipv6_sender_init(&loadgen_conns[i].sender, sockfd, 0);
+        if (frame_ring_init(&loadgen_conns[i].ring) < 0)
+        {
+            perror("Ошибка создания буфера приема");
+            exit(EXIT_FAILURE);
+        }
+    }
+    log_level = saved_level;
+
+    pthread_barrier_init(&loadgen_barrier, NULL, cfg.threads + 1);
+    for (int i = 0; i < cfg.threads; i++)
+    {
+        threads[i].id = i;
+        threads[i].config = &cfg;
+        threads[i].first_conn = cfg.connections * i / cfg.threads;
+        threads[i].conn_count = cfg.connections * (i + 1) / cfg.threads - threads[i].first_conn;
+        if (pthread_create(&threads[i].thread, NULL, loadgen_thread_loop, &threads[i]))
+        {
+            perror("Ошибка создания потока нагрузки");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    printf("Нагрузка на [%s]:%d в течение %d с...\n", cfg.address, PORT, cfg.duration);
+    loadgen_start_ns = now_ns();
+    pthread_barrier_wait(&loadgen_barrier);
+
+    for (int i = 0; i < cfg.threads; i++)
+        pthread_join(threads[i].thread, NULL);
+    double seconds = (now_ns() - loadgen_start_ns) / 1e9;
+
+    loadgen_report(&cfg, threads, seconds);
+
+    for (int i = 0; i < cfg.connections; i++)
+    {
+        close(loadgen_conns[i].sender.sockfd);
+        frame_ring_free(&loadgen_conns[i].ring);
+    }
+    pthread_barrier_destroy(&loadgen_barrier);
+    free(threads);
+    free(loadgen_conns);
+}
+
+// Обработчик сервера в режиме --echo: на каждый кадр отвечает коротким кадром с адресами
+// в обратном порядке и первыми байтами полезной нагрузки (отметкой генератора нагрузки).
+void echo_ipv6_packet(client_t *client, const struct ipv6_frame *frame)
+{
+    capture_frame(frame->hdr, frame->frame_len);
+
+    if (frame->opts == NULL)
+        return;
+
+    size_t echo_len = frame->payload_len < sizeof(struct loadgen_stamp) ? frame->payload_len : sizeof(struct loadgen_stamp);
+    struct ipv6_header hdr = *frame->hdr;
+    hdr.fields.src_addr = frame->hdr->fields.dst_addr;
+    hdr.fields.dst_addr = frame->hdr->fields.src_addr;
+    hdr.fields.next_header = 60; // Ответ несет только опции назначения, без других заголовков расширения
+    hdr.fields.payload_len = htons(frame->opts_len + echo_len);
+
+    struct iovec iov[3] = {
+        {&hdr, sizeof(hdr)},
+        {(void *)frame->opts, frame->opts_len},
+        {(void *)frame->payload, echo_len},
+    };
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 3;
+
+    // У датаграмм временная запись без дескриптора таблицы - ответ уходит по адресу отправителя
+    if (client->handle == 0)
+    {
+        msg.msg_name = &client->addr;
+        msg.msg_namelen = sizeof(client->addr);
+    }
+
+    // Сокет сервера неблокирующий: если буфер отправки полон, ответ дописывается после
+    // его освобождения, иначе поток TCP потерял бы границу кадра.
+    while (msg.msg_iovlen > 0)
+    {
+        count_syscall();
+        ssize_t sent = sendmsg(client->sockfd, &msg, MSG_NOSIGNAL);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                struct pollfd pfd = {client->sockfd, POLLOUT, 0};
+                if (poll(&pfd, 1, 1000) > 0)
+                    continue;
+            }
+            return;
+        }
+
+        while (sent > 0 && msg.msg_iovlen > 0)
+        {
+            if ((size_t)sent >= msg.msg_iov->iov_len)
+            {
+                sent -= msg.msg_iov->iov_len;
+                msg.msg_iov++;
+                msg.msg_iovlen--;
+            }
+            else
+            {
+                msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + sent;
+                msg.msg_iov->iov_len -= sent;
+                sent = 0;
+            }
+        }
+    }
+}
@@ -0,0 +1,89 @@
+#include "ipv6_sockets.h"
+
+// Функции вывода пакетов в человекочитаемом виде. Используются сервером и клиентом
+// при высоком уровне подробности (LOG_PACKETS) и утилитой разбора захвата capture_dump.
+
+// Вывод IPv6 заголовка
+void print_ipv6_header(const struct ipv6_header *hdr)
+{
+    char src_ip[INET6_ADDRSTRLEN], dst_ip[INET6_ADDRSTRLEN];
+
+    // inet_ntop (network to presentation): Преобразует числовой IPv6-адрес из бинарного формата в текстовую строку.
+    inet_ntop(AF_INET6, &hdr->fields.src_addr, src_ip, sizeof(src_ip));
+    inet_ntop(AF_INET6, &hdr->fields.dst_addr, dst_ip, sizeof(dst_ip));
+
+    printf("\n=== IPv6 Header ===\n");
+    printf("Version: %u\n", hdr->fields.version);
+    printf("Traffic class: %u\n", hdr->fields.traffic_class);
+    printf("Flow label: %u\n", hdr->fields.flow_label);
+    // ntohs (network to host short): Преобразует 16-битное число из сетевого порядка байтов в порядок байтов хоста.
+    printf("Payload length: %u\n", ntohs(hdr->fields.payload_len));
+    printf("Next header: %u\n", hdr->fields.next_header);
+    printf("Hop limit: %u\n", hdr->fields.hop_limit);
+    printf("Source ip: %s\n", src_ip);
+    printf("Destination ip: %s\n", dst_ip);
+}
+
+// Вывод опций назначения: обход опций TLV и все найденные адреса LOCN
+void print_dest_options(const struct dest_options *opts, size_t len)
+{
+    struct ext_options parsed;
+
+    printf("\n=== Destination options header ===\n");
+    printf("Next header: %u\n", opts->next_header);
+    printf("Extension length: %u (%zu bytes)\n", opts->hdr_ext_len, len);
+
+    int count = ext_options_walk(opts, len, &parsed);
+    if (count < 0)
+    {
+        printf("Options: malformed\n");
+        return;
+    }
+
+    printf("Options: %d (padding %d bytes, skipped %d)\n", count, parsed.pad_bytes, parsed.skipped);
+    for (int i = 0; i < parsed.locn_count; i++)
+        printf("LOCN: 0x%016lX\n", parsed.locn[i]);
+}
+
+// Вывод кадра: шестнадцатеричный дамп, заголовок IPv6, опции назначения и полезная нагрузка
+void print_frame(const struct ipv6_frame *frame)
+{
+    const unsigned char *raw = (const unsigned char *)frame->hdr;
+
+    printf("\n[СЕРВЕР] Получен сырой пакет (%zu байт):\n---\n", frame->frame_len);
+    for (size_t i = 0; i < frame->frame_len; i++)
+    {
+        printf("%02x ", raw[i]);
+        if ((i + 1) % 16 == 0)
+            printf("\n");
+    }
+    printf("\n---\n");
+
+    print_ipv6_header(frame->hdr);
+
+    // Проверка на опции назначения
+    if (frame->opts)
+    {
+        print_dest_options(frame->opts, frame->opts_len);
+
+        // Вывод данных
+        if (frame->payload_len > 0)
+        {
+            printf("Payload: %.*s\n", (int)frame->payload_len, frame->payload);
+        }
+    }
+}
+
+// Преобразование 64-битных значений из хостового в сетевой порядок байт
+uint64_t htonll(uint64_t value)
+{
+    // htonl (host to network long): Преобразует 32-битное число из порядка байтов хоста в сетевой.
+    return ((uint64_t)htonl(value & 0xFFFFFFFF) << 32) | htonl(value >> 32);
+}
+
+// Преобразование 64-битных значений из сетевого в хостовый порядок байт
+uint64_t ntohll(uint64_t value)
+{
+    // ntohl (network to host long): Преобразует 32-битное число из сетевого порядка байтов в хостовый.
+    return ((uint64_t)ntohl(value & 0xFFFFFFFF) << 32) | ntohl(value >> 32);
+}
@@ -0,0 +1,227 @@
+#include "ipv6_sockets.h"
+#include <poll.h>
+#include <linux/errqueue.h>
+
+// Число адресов LOCN в опциях назначения каждого пакета (параметр --locn)
+int sender_locn_count = 1;
+
+// Подготовка отправителя для подключенного сокета.
+// Адреса сторон запрашиваются один раз, и по ним заранее заполняются шаблоны
+// заголовка IPv6 и опций назначения. При отправке меняется только payload_len.
+int ipv6_sender_init(struct ipv6_sender *sender, int sockfd, int zerocopy)
+{
+    struct sockaddr_in6 my_addr, peer_addr;
+    socklen_t addr_len = sizeof(struct sockaddr_in6);
+
+    memset(sender, 0, sizeof(*sender));
+    sender->sockfd = sockfd;
+
+    sender->header.fields.version = 6;
+    sender->header.fields.traffic_class = 0;
+    // htonl (host to network long): Преобразует 32-битное число из порядка байтов хоста в сетевой.
+    sender->header.fields.flow_label = htonl(12345) >> 12;
+    sender->header.fields.next_header = 60; // Destination Options
+    sender->header.fields.hop_limit = 64;
+
+    // getsockname: Получает локальный адрес, к которому привязан сокет.
+    if (getsockname(sockfd, (struct sockaddr *)&my_addr, &addr_len) == 0)
+    {
+        sender->header.fields.src_addr = my_addr.sin6_addr;
+    }
+    else
+    {
+        perror("Ошибка getsockname");
+        inet_pton(AF_INET6, "::1", &sender->header.fields.src_addr);
+    }
+
+    // getpeername: Получает адрес удаленного узла, к которому подключен сокет.
+    addr_len = sizeof(struct sockaddr_in6);
+    if (getpeername(sockfd, (struct sockaddr *)&peer_addr, &addr_len) == 0)
+    {
+        sender->header.fields.dst_addr = peer_addr.sin6_addr;
+    }
+    else
+    {
+        perror("Ошибка getpeername");
+        inet_pton(AF_INET6, "::1", &sender->header.fields.dst_addr);
+    }
+
+    // Опции назначения: sender_locn_count адресов LOCN (пример адресов), за ними данные TCP
+    uint64_t locn[EXT_MAX_LOCN];
+    for (int i = 0; i < sender_locn_count; i++)
+        locn[i] = 0x123456789ABCDEF0 + i;
+    sender->options_len = ext_options_build(sender->options, 6, locn, sender_locn_count);
+
+    if (zerocopy)
+    {
+        // SO_ZEROCOPY: Разрешает флаг MSG_ZEROCOPY - ядро отправляет данные прямо из
+        // пользовательских страниц, а об их освобождении сообщает через очередь ошибок сокета.
+        int one = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) == 0)
+            sender->zerocopy = 1;
+        else
+            perror("Ошибка SO_ZEROCOPY");
+    }
+
+    return 0;
+}
+
+// Постановка сообщения в очередь без копирования полезной нагрузки.
+// Каждое сообщение описывается тремя iovec: свой заголовок, общий шаблон опций и данные вызывающего.
+// Данные должны оставаться неизменными до ipv6_sender_flush (а при MSG_ZEROCOPY - до
+// подтверждения в ipv6_sender_reap_zerocopy). При заполнении очереди она отправляется автоматически.
+int ipv6_sender_queue(struct ipv6_sender *sender, const void *payload, size_t payload_size)
+{
+    if (payload_size > 65535 - sender->options_len)
+    {
+        errno = EMSGSIZE;
+        return -1;
+    }
+
+    if (sender->queued == SENDER_MAX_QUEUE && ipv6_sender_flush(sender) < 0)
+        return -1;
+
+    struct ipv6_header *hdr = &sender->headers[sender->queued];
+    struct iovec *iov = &sender->iov[sender->iov_count];
+
+    *hdr = sender->header;
+    hdr->fields.payload_len = htons(sender->options_len + payload_size);
+
+    iov[0].iov_base = hdr;
+    iov[0].iov_len = sizeof(*hdr);
+    iov[1].iov_base = sender->options;
+    iov[1].iov_len = sender->options_len;
+    iov[2].iov_base = (void *)payload;
+    iov[2].iov_len = payload_size;
+
+    sender->iov_count += payload_size ? 3 : 2;
+    sender->queued_bytes += sizeof(*hdr) + sender->options_len + payload_size;
+    sender->queued++;
+    return 0;
+}
+
+// Отправка всей очереди одним вызовом sendmsg (или несколькими при частичной записи).
+// Возвращает 0, если очередь отправлена целиком. Для неблокирующего сокета при EAGAIN
+// возвращает -1, а неотправленный остаток сохраняется до следующего вызова.
+int ipv6_sender_flush(struct ipv6_sender *sender)
+{
+    while (sender->iov_first < sender->iov_count)
+    {
+        struct msghdr msg;
+        int flags = MSG_NOSIGNAL;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = &sender->iov[sender->iov_first];
+        msg.msg_iovlen = sender->iov_count - sender->iov_first;
+
+        // MSG_ZEROCOPY выгоден только для крупных отправок: для мелких затраты на
+        // закрепление страниц и уведомления больше, чем на копирование.
+        if (sender->zerocopy && sender->queued_bytes >= ZEROCOPY_THRESHOLD)
+            flags |= MSG_ZEROCOPY;
+
+        // sendmsg: Отправляет данные из нескольких несмежных буферов (scatter-gather) одним системным вызовом.
+        // MSG_NOSIGNAL: При разрыве соединения вернуть EPIPE вместо сигнала SIGPIPE.
+        count_syscall();
+        ssize_t sent = sendmsg(sender->sockfd, &msg, flags);
+        if (sent < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == ENOBUFS && (flags & MSG_ZEROCOPY))
+            {
+                // Исчерпан лимит закрепленной памяти - ждем уведомлений и повторяем с копированием
+                ipv6_sender_reap_zerocopy(sender);
+                sender->zerocopy = 0;
+                continue;
+            }
+            return -1;
+        }
+
+        sender->syscalls++;
+        if (flags & MSG_ZEROCOPY)
+            sender->zc_pending++;
+        ipv6_sender_advance(sender, sent);
+    }
+
+    return 0;
+}
+
+// Учет отправленных байт: пропуск полностью отправленных iovec и сдвиг начала частично отправленного.
+// Используется и sendmsg, и механизмом io_uring, который сообщает результат в записи завершения.
+void ipv6_sender_advance(struct ipv6_sender *sender, size_t sent)
+{
+    sender->queued_bytes -= sent;
+
+    while (sent > 0)
+    {
+        struct iovec *iov = &sender->iov[sender->iov_first];
+        if (sent >= iov->iov_len)
+        {
+            sent -= iov->iov_len;
+            sender->iov_first++;
+        }
+        else
+        {
+            iov->iov_base = (char *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+            sent = 0;
+        }
+    }
+
+    if (sender->iov_first == sender->iov_count)
+    {
+        sender->queued = 0;
+        sender->iov_first = 0;
+        sender->iov_count = 0;
+    }
+}
+
+// Отправка одного сообщения: постановка в очередь и немедленная отправка
+int ipv6_sender_send(struct ipv6_sender *sender, const void *payload, size_t payload_size)
+{
+    if (ipv6_sender_queue(sender, payload, payload_size) < 0)
+        return -1;
+    return ipv6_sender_flush(sender);
+}
+
+// Обработка уведомлений о завершении отправок MSG_ZEROCOPY.
+// После уведомления буферы полезной нагрузки снова можно изменять.
+// Возвращает число отправок, еще ожидающих подтверждения.
+int ipv6_sender_reap_zerocopy(struct ipv6_sender *sender)
+{
+    while (sender->zc_pending > 0)
+    {
+        char control[128];
+        struct msghdr msg;
+
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        // MSG_ERRQUEUE: Чтение очереди ошибок сокета, куда ядро кладет уведомления zerocopy.
+        if (recvmsg(sender->sockfd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                break;
+
+            // Уведомление еще не пришло - ждем его появления (POLLERR)
+            struct pollfd pfd = {sender->sockfd, 0, 0};
+            if (poll(&pfd, 1, 100) <= 0)
+                break;
+            continue;
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            struct sock_extended_err *serr = (struct sock_extended_err *)CMSG_DATA(cm);
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+
+            // ee_info..ee_data: диапазон номеров завершенных отправок
+            uint32_t done = serr->ee_data - serr->ee_info + 1;
+            sender->zc_pending = done >= sender->zc_pending ? 0 : sender->zc_pending - done;
+        }
+    }
+
+    return sender->zc_pending;
+}
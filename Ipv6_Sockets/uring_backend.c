@@ -0,0 +1,610 @@
+#include "ipv6_sockets.h"
+#include <stdint.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+// Механизм ввода-вывода на io_uring. Вместо пары "ожидание готовности (epoll_wait) + recv/accept"
+// программа один раз ставит многократные (multishot) запросы accept и recv, а ядро само
+// складывает результаты в очередь завершения. Данные принимаются в буферы из кольца буферов,
+// которое программа заранее передала ядру. Один вызов io_uring_enter одновременно отправляет
+// все накопленные запросы и забирает все готовые результаты.
+// liburing не используется: кольца отображаются и обслуживаются напрямую.
+
+#define URING_ENTRIES 256       // Размер очереди отправки (очередь завершения в 4 раза больше)
+#define URING_BUF_COUNT 256     // Буферов приема в кольце, степень двойки
+#define URING_BUF_SIZE 16384    // Размер одного буфера приема
+#define URING_BUF_GROUP 0       // Номер группы буферов
+#define URING_MAX_BATCH 256     // Максимум отправителей в uring_send_batch
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+// Возврат буфера приема в кольцо буферов: ядро снова может выбрать его для recv
+static void uring_buf_return(struct uring *ring, unsigned bid)
+{
+    struct io_uring_buf *buf = &ring->buf_ring->bufs[ring->buf_tail & (ring->buf_count - 1)];
+
+    buf->addr = (uint64_t)(uintptr_t)(ring->buffers + (size_t)bid * URING_BUF_SIZE);
+    buf->len = URING_BUF_SIZE;
+    buf->bid = bid;
+    ring->buf_tail++;
+
+    // RELEASE: ядро увидит новый хвост только вместе с заполненным описанием буфера
+    __atomic_store_n(&ring->buf_ring->tail, ring->buf_tail, __ATOMIC_RELEASE);
+}
+
+// Регистрация кольца буферов приема (IORING_REGISTER_PBUF_RING, ядро 5.19+)
+static int uring_setup_buffers(struct uring *ring, unsigned count)
+{
+    ring->buf_count = count;
+    ring->buf_ring = mmap(NULL, count * sizeof(struct io_uring_buf), PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    ring->buffers = mmap(NULL, (size_t)count * URING_BUF_SIZE, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->buf_ring == MAP_FAILED || ring->buffers == MAP_FAILED)
+        return -1;
+
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring->buf_ring;
+    reg.ring_entries = count;
+    reg.bgid = URING_BUF_GROUP;
+    if (sys_io_uring_register(ring->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+        return -1;
+
+    for (unsigned bid = 0; bid < count; bid++)
+        uring_buf_return(ring, bid);
+    return 0;
+}
+
+// Создание кольца io_uring. buffers - число буферов приема (0 - кольцо только для отправки).
+// Кольцо должно использоваться только создавшим его потоком.
+int uring_init(struct uring *ring, unsigned entries, unsigned buffers)
+{
+    struct io_uring_params params;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    ring->pending_bid = -1;
+    ring->buf_ring = MAP_FAILED;
+    ring->buffers = MAP_FAILED;
+
+    // IORING_SETUP_SINGLE_ISSUER: запросы отправляет только один поток.
+    // IORING_SETUP_DEFER_TASKRUN: ядро завершает запросы не прерыванием потока в произвольный момент,
+    // а при следующем io_uring_enter, пакетом - меньше переключений контекста.
+    // IORING_SETUP_CQSIZE: многократные запросы дают много результатов, очередь завершения больше.
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 4;
+    ring->fd = sys_io_uring_setup(entries, &params);
+    if (ring->fd < 0 && errno == EINVAL)
+    {
+        // Ядро старше 6.1: без DEFER_TASKRUN
+        memset(&params, 0, sizeof(params));
+        params.flags = IORING_SETUP_CQSIZE;
+        params.cq_entries = entries * 4;
+        ring->fd = sys_io_uring_setup(entries, &params);
+    }
+    if (ring->fd < 0)
+        return -1;
+
+    // IORING_FEAT_SINGLE_MMAP: очереди отправки и завершения лежат в одном отображении
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+    {
+        uring_free(ring);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    ring->ring_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+    // mmap(IORING_OFF_SQ_RING / IORING_OFF_SQES): Отображение колец, общих для программы и ядра
+    ring->ring_ptr = mmap(NULL, ring->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                          ring->fd, IORING_OFF_SQ_RING);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      ring->fd, IORING_OFF_SQES);
+    if (ring->ring_ptr == MAP_FAILED || ring->sqes == MAP_FAILED)
+    {
+        uring_free(ring);
+        return -1;
+    }
+
+    char *base = ring->ring_ptr;
+    ring->sq_entries = params.sq_entries;
+    ring->sq_head = (unsigned *)(base + params.sq_off.head);
+    ring->sq_tail = (unsigned *)(base + params.sq_off.tail);
+    ring->sq_mask = (unsigned *)(base + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned *)(base + params.sq_off.array);
+    ring->cq_head = (unsigned *)(base + params.cq_off.head);
+    ring->cq_tail = (unsigned *)(base + params.cq_off.tail);
+    ring->cq_mask = (unsigned *)(base + params.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe *)(base + params.cq_off.cqes);
+    ring->sq_local_tail = *ring->sq_tail;
+
+    // Элемент i очереди отправки всегда указывает на запрос i - массив косвенности заполняется один раз
+    for (unsigned i = 0; i < ring->sq_entries; i++)
+        ring->sq_array[i] = i;
+
+    if (buffers && uring_setup_buffers(ring, buffers) < 0)
+    {
+        uring_free(ring);
+        return -1;
+    }
+    return 0;
+}
+
+// Закрытие кольца. Ядро отменяет все незавершенные запросы.
+void uring_free(struct uring *ring)
+{
+    int saved_errno = errno;
+
+    if (ring->fd >= 0)
+        close(ring->fd);
+    if (ring->ring_ptr && ring->ring_ptr != MAP_FAILED)
+        munmap(ring->ring_ptr, ring->ring_size);
+    if (ring->sqes && ring->sqes != MAP_FAILED)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->buf_ring != MAP_FAILED && ring->buf_ring != NULL)
+        munmap(ring->buf_ring, ring->buf_count * sizeof(struct io_uring_buf));
+    if (ring->buffers != MAP_FAILED && ring->buffers != NULL)
+        munmap(ring->buffers, (size_t)ring->buf_count * URING_BUF_SIZE);
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+    errno = saved_errno;
+}
+
+// Проверка, что ядро позволяет создать кольцо io_uring
+int uring_supported()
+{
+    struct uring ring;
+
+    if (uring_init(&ring, 4, 0) < 0)
+        return 0;
+    uring_free(&ring);
+    return 1;
+}
+
+// Передача накопленных запросов ядру и ожидание не менее wait_nr результатов
+static int uring_enter(struct uring *ring, unsigned wait_nr)
+{
+    // Число запросов считается от головы SQ: если ядро не забрало часть запросов
+    // в прошлый раз, они отправятся снова.
+    unsigned to_submit = ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    // io_uring_enter: Один системный вызов и для отправки запросов, и для получения результатов.
+    // IORING_ENTER_GETEVENTS: дождаться wait_nr завершений (и выполнить отложенную работу ядра).
+    count_syscall();
+    return sys_io_uring_enter(ring->fd, to_submit, wait_nr, IORING_ENTER_GETEVENTS);
+}
+
+// Свободный элемент очереди отправки. Если очередь заполнена, накопленные запросы отправляются.
+static struct io_uring_sqe *uring_get_sqe(struct uring *ring)
+{
+    while (ring->sq_local_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+    {
+        if (uring_enter(ring, 0) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+            return NULL;
+    }
+
+    struct io_uring_sqe *sqe = &ring->sqes[ring->sq_local_tail & *ring->sq_mask];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_local_tail++;
+    return sqe;
+}
+
+// Следующий результат из очереди завершения без ожидания или NULL
+static struct io_uring_cqe *uring_peek_cqe(struct uring *ring)
+{
+    unsigned head = *ring->cq_head;
+
+    if (head == __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+        return NULL;
+    return &ring->cqes[head & *ring->cq_mask];
+}
+
+// Освобождение места результата в очереди завершения
+static void uring_cqe_seen(struct uring *ring)
+{
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+// Ожидание следующего результата
+static struct io_uring_cqe *uring_wait_cqe(struct uring *ring)
+{
+    struct io_uring_cqe *cqe;
+
+    while ((cqe = uring_peek_cqe(ring)) == NULL)
+    {
+        if (uring_enter(ring, 1) < 0 && errno != EINTR)
+            return NULL;
+    }
+    return cqe;
+}
+
+// Многократный accept: один запрос принимает все последующие подключения
+static int uring_arm_accept(struct uring *ring, int listen_fd)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL)
+        return -1;
+
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_CLOEXEC;
+    sqe->user_data = LISTEN_TAG;
+    return 0;
+}
+
+// Многократный recv с выбором буфера ядром: каждая порция данных приходит отдельным
+// результатом с номером буфера, повторная постановка запроса не нужна.
+static int uring_arm_recv(struct uring *ring, int sockfd, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL)
+        return -1;
+
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = sockfd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUF_GROUP;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+// Ожидание готовности eventfd остановки. Используется опрос, а не чтение:
+// счетчик не сбрасывается, и сигнал остановки получают кольца всех потоков.
+static int uring_arm_stop(struct uring *ring, int stop_fd)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL)
+        return -1;
+
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = stop_fd;
+    sqe->poll32_events = POLLIN;
+    sqe->user_data = STOP_TAG;
+    return 0;
+}
+
+// Передача обработчику всех кадров из принятой порции данных.
+// Если в буфере соединения нет незавершенного кадра, кадры разбираются прямо в буфере приема,
+// без копирования; в буфер соединения копируется только неполный кадр в конце порции.
+static int uring_deliver(struct event_worker *worker, client_t *client, const char *data, size_t len)
+{
+    struct ipv6_frame frame;
+    int status;
+
+    if (client->ring.head == client->ring.tail)
+    {
+        while ((status = ipv6_frame_parse(data, len, &frame)) > 0)
+        {
+            worker->config->on_packet(client, &frame);
+            data += frame.frame_len;
+            len -= frame.frame_len;
+        }
+        if (status < 0)
+            return -1;
+    }
+
+    while (len > 0)
+    {
+        size_t copied = frame_ring_append(&client->ring, data, len);
+        data += copied;
+        len -= copied;
+
+        while ((status = frame_ring_next(&client->ring, &frame)) > 0)
+        {
+            worker->config->on_packet(client, &frame);
+            frame_ring_consume(&client->ring, &frame);
+        }
+        if (status < 0)
+            return -1;
+    }
+    return 0;
+}
+
+// Новое подключение из многократного accept
+static void uring_accepted(struct event_worker *worker, struct uring *ring, int client_fd)
+{
+    struct sockaddr_in6 client_addr;
+
+    // Адрес клиента нужен только для сообщений о подключении; при многократном accept
+    // ядро его не возвращает, поэтому он запрашивается отдельным вызовом.
+    memset(&client_addr, 0, sizeof(client_addr));
+    if (log_level >= LOG_EVENTS)
+    {
+        socklen_t addr_len = sizeof(client_addr);
+        count_syscall();
+        getpeername(client_fd, (struct sockaddr *)&client_addr, &addr_len);
+    }
+
+    client_t *client = open_conn(worker, client_fd, &client_addr);
+    if (client == NULL)
+        return;
+
+    if (uring_arm_recv(ring, client_fd, client->handle) < 0)
+    {
+        perror("Ошибка постановки recv в io_uring");
+        close(client_fd);
+        conn_table_release(&connections, client);
+        return;
+    }
+
+    if (log_level >= LOG_EVENTS)
+    {
+        char client_ip[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &client_addr.sin6_addr, client_ip, sizeof(client_ip));
+        printf("IPv6 клиент подключен: %s (поток %d)\n", client_ip, worker->id);
+    }
+}
+
+// Результат многократного recv соединения
+static void uring_received(struct event_worker *worker, struct uring *ring, struct io_uring_cqe *cqe)
+{
+    client_t *client = conn_table_get(&connections, cqe->user_data);
+    int more = cqe->flags & IORING_CQE_F_MORE;
+
+    if (cqe->res > 0)
+    {
+        // IORING_CQE_F_BUFFER: данные лежат в буфере из кольца, номер буфера в старших битах flags
+        unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+
+        // owner == -1: соединение уже закрывается после ошибки разбора, данные отбрасываются
+        if (client && client->owner >= 0 &&
+            uring_deliver(worker, client, ring->buffers + (size_t)bid * URING_BUF_SIZE, cqe->res) < 0)
+        {
+            fprintf(stderr, "Поврежденный IPv6 поток, соединение закрыто\n");
+            // shutdown: recv завершится с результатом 0, и соединение закроется ниже
+            client->owner = -1;
+            shutdown(client->sockfd, SHUT_RDWR);
+        }
+        uring_buf_return(ring, bid);
+    }
+
+    if (more || client == NULL)
+        return;
+
+    // Многократный recv завершился. ENOBUFS означает, что все буферы были заняты, -
+    // они уже возвращены, и запрос ставится заново. Данные, 0 байт или ошибка - закрытие соединения.
+    if ((cqe->res > 0 && client->owner >= 0) || cqe->res == -ENOBUFS)
+    {
+        if (uring_arm_recv(ring, client->sockfd, client->handle) == 0)
+            return;
+    }
+    else if (cqe->res < 0 && cqe->res != -ECONNRESET)
+    {
+        errno = -cqe->res;
+        perror("Ошибка чтения IPv6");
+    }
+
+    close_conn(client);
+}
+
+// Цикл рабочего потока io_uring: одно кольцо на поток, многократные accept и recv
+void *uring_worker_loop(void *arg)
+{
+    struct event_worker *worker = (struct event_worker *)arg;
+    struct uring ring;
+
+    if (uring_init(&ring, URING_ENTRIES, URING_BUF_COUNT) < 0)
+    {
+        perror("Ошибка создания io_uring");
+        stop_event_server();
+        return NULL;
+    }
+
+    if (uring_arm_accept(&ring, worker->listen_fd) < 0 || uring_arm_stop(&ring, worker->stop_fd) < 0)
+    {
+        perror("Ошибка постановки запросов io_uring");
+        uring_free(&ring);
+        stop_event_server();
+        return NULL;
+    }
+
+    while (server_active)
+    {
+        if (uring_enter(&ring, 1) < 0 && errno != EINTR)
+        {
+            perror("Ошибка io_uring_enter");
+            break;
+        }
+
+        // Обработка всех готовых результатов. Новые запросы (повторный accept, recv новых
+        // соединений) отправятся ядру следующим io_uring_enter вместе с ожиданием.
+        struct io_uring_cqe *cqe;
+        while ((cqe = uring_peek_cqe(&ring)) != NULL)
+        {
+            if (cqe->user_data == LISTEN_TAG)
+            {
+                if (cqe->res >= 0)
+                    uring_accepted(worker, &ring, cqe->res);
+                else if (cqe->res != -EINTR && cqe->res != -ECONNABORTED)
+                {
+                    errno = -cqe->res;
+                    perror("Ошибка accept");
+                }
+                if (!(cqe->flags & IORING_CQE_F_MORE) && server_active)
+                    uring_arm_accept(&ring, worker->listen_fd);
+            }
+            else if (cqe->user_data != STOP_TAG)
+            {
+                uring_received(worker, &ring, cqe);
+            }
+            uring_cqe_seen(&ring);
+        }
+    }
+
+    // Закрытие кольца отменяет незавершенные recv; сокеты закрывает основной поток
+    uring_free(&ring);
+    return NULL;
+}
+
+// Замена frame_ring_recv для блокирующего чтения через io_uring (клиент).
+// При первом вызове ставится многократный recv; затем каждый вызов берет данные из
+// очередного результата. Если порция не поместилась в буфер кадров, остаток выдается
+// следующим вызовом. Возвращает число байт, 0 при закрытии соединения, -1 при ошибке.
+ssize_t uring_recv(struct uring *ring, struct frame_ring *frames, int sockfd)
+{
+    while (ring->pending_len == 0)
+    {
+        if (!ring->recv_armed)
+        {
+            if (uring_arm_recv(ring, sockfd, 0) < 0)
+                return -1;
+            ring->recv_armed = 1;
+        }
+
+        struct io_uring_cqe *cqe = uring_wait_cqe(ring);
+        if (cqe == NULL)
+            return -1;
+
+        int res = cqe->res;
+        unsigned flags = cqe->flags;
+        uring_cqe_seen(ring);
+
+        if (!(flags & IORING_CQE_F_MORE))
+            ring->recv_armed = 0;
+        if (res == -ENOBUFS)
+            continue;
+        if (res <= 0)
+        {
+            errno = -res;
+            return res < 0 ? -1 : 0;
+        }
+
+        ring->pending_bid = flags >> IORING_CQE_BUFFER_SHIFT;
+        ring->pending_off = 0;
+        ring->pending_len = res;
+    }
+
+    size_t copied = frame_ring_append(frames, ring->buffers + (size_t)ring->pending_bid * URING_BUF_SIZE + ring->pending_off,
+                                      ring->pending_len);
+    if (copied == 0)
+    {
+        errno = ENOBUFS;
+        return -1;
+    }
+
+    ring->pending_off += copied;
+    ring->pending_len -= copied;
+    if (ring->pending_len == 0)
+        uring_buf_return(ring, ring->pending_bid);
+    return copied;
+}
+
+// Запрос sendmsg для неотправленного остатка очереди отправителя.
+// Возвращает 1, если использован MSG_ZEROCOPY, 0 - если нет, -1 при ошибке.
+static int uring_queue_sendmsg(struct uring *ring, struct ipv6_sender *sender, struct msghdr *msg, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = uring_get_sqe(ring);
+    if (sqe == NULL)
+        return -1;
+
+    // Структура msghdr должна жить до завершения запроса
+    memset(msg, 0, sizeof(*msg));
+    msg->msg_iov = &sender->iov[sender->iov_first];
+    msg->msg_iovlen = sender->iov_count - sender->iov_first;
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = sender->sockfd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+    // MSG_WAITALL: для потокового сокета ядро само досылает остаток при частичной отправке
+    sqe->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    sqe->user_data = user_data;
+
+    if (sender->zerocopy && sender->queued_bytes >= ZEROCOPY_THRESHOLD)
+    {
+        sqe->msg_flags |= MSG_ZEROCOPY;
+        return 1;
+    }
+    return 0;
+}
+
+// Отправка очередей нескольких отправителей: по одному запросу sendmsg на отправителя,
+// все запросы уходят ядру одним io_uring_enter. При частичной отправке остаток
+// ставится заново. Возвращает 0 или -1 с errno первой ошибки.
+int uring_send_batch(struct uring *ring, struct ipv6_sender **senders, int count)
+{
+    struct msghdr msgs[URING_MAX_BATCH];
+    int zerocopy[URING_MAX_BATCH];
+    int inflight = 0;
+    int error = 0;
+
+    if (count > URING_MAX_BATCH)
+    {
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (senders[i]->iov_first == senders[i]->iov_count)
+            continue;
+        if ((zerocopy[i] = uring_queue_sendmsg(ring, senders[i], &msgs[i], i)) < 0)
+            return -1;
+        inflight++;
+    }
+
+    while (inflight > 0)
+    {
+        struct io_uring_cqe *cqe = uring_wait_cqe(ring);
+        if (cqe == NULL)
+            return -1;
+
+        int i = (int)cqe->user_data;
+        int res = cqe->res;
+        uring_cqe_seen(ring);
+        inflight--;
+
+        struct ipv6_sender *sender = senders[i];
+        if (res < 0 && res != -EINTR && res != -EAGAIN)
+        {
+            error = error ? error : -res;
+            continue;
+        }
+
+        if (res > 0)
+        {
+            sender->syscalls++;
+            sender->zc_pending += zerocopy[i];
+            ipv6_sender_advance(sender, res);
+        }
+
+        if (sender->iov_first < sender->iov_count)
+        {
+            if ((zerocopy[i] = uring_queue_sendmsg(ring, sender, &msgs[i], i)) < 0)
+                return -1;
+            inflight++;
+        }
+    }
+
+    if (error)
+    {
+        errno = error;
+        return -1;
+    }
+    return 0;
+}
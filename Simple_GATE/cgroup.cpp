@@ -0,0 +1,152 @@
+#include "cgroup.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+std::string Cgroup::findRoot()
+{
+    std::ifstream mountinfo("/proc/self/mountinfo");
+    std::string line;
+    std::string mount;
+    while (mount.empty() && std::getline(mountinfo, line)) {
+        size_t separator = line.find(" - ");
+        if (separator == std::string::npos || line.compare(separator + 3, 8, "cgroup2 ") != 0)
+            continue;
+        size_t root = line.find(' ', line.find(' ', line.find(' ') + 1) + 1) + 1;
+        size_t point = line.find(' ', root) + 1;
+        mount = line.substr(point, line.find(' ', point) - point);
+    }
+    if (mount.empty())
+        return {};
+
+    std::ifstream cgroup("/proc/self/cgroup");
+    while (std::getline(cgroup, line))
+        if (line.compare(0, 3, "0::") == 0)
+            return line.size() > 4 ? mount + line.substr(3) : mount;
+    return {};
+}
+
+Cgroup::Cgroup()
+    : m_directoryFd(-1), m_eventsFd(-1)
+{}
+
+Cgroup::~Cgroup()
+{
+    if (m_eventsFd >= 0)
+        close(m_eventsFd);
+    if (m_directoryFd >= 0)
+        close(m_directoryFd);
+}
+
+bool Cgroup::create(const std::string& path)
+{
+    if (m_directoryFd >= 0 || (mkdir(path.c_str(), 0755) < 0 && errno != EEXIST))
+        return false;
+
+    m_directoryFd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    m_eventsFd = m_directoryFd >= 0 ? openat(m_directoryFd, "cgroup.events", O_RDONLY | O_CLOEXEC) : -1;
+    if (m_eventsFd < 0) {
+        if (m_directoryFd >= 0)
+            close(m_directoryFd);
+        m_directoryFd = -1;
+        rmdir(path.c_str());
+        return false;
+    }
+    m_path = path;
+    return true;
+}
+
+bool Cgroup::destroy()
+{
+    if (m_directoryFd < 0)
+        return false;
+    close(m_eventsFd);
+    close(m_directoryFd);
+    m_eventsFd = -1;
+    m_directoryFd = -1;
+    return rmdir(m_path.c_str()) == 0;
+}
+
+bool Cgroup::isValid()
+{
+    return m_directoryFd >= 0;
+}
+
+std::string Cgroup::getPath()
+{
+    return m_path;
+}
+
+bool Cgroup::attach(pid_t pid)
+{
+    return writeFile("cgroup.procs", std::to_string(pid));
+}
+
+bool Cgroup::freeze(bool frozen, std::chrono::milliseconds timeout)
+{
+    if (!writeFile("cgroup.freeze", frozen ? "1" : "0"))
+        return false;
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool current;
+    while (eventsFrozen(current) && current != frozen) {
+        auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        if (left.count() <= 0) {
+            errno = ETIMEDOUT;
+            return false;
+        }
+        pollfd changed = {m_eventsFd, POLLPRI, 0};
+        if (poll(&changed, 1, static_cast<int>(left.count()) + 1) < 0 && errno != EINTR)
+            return false;
+    }
+    return current == frozen;
+}
+
+bool Cgroup::isFrozen()
+{
+    bool frozen = false;
+    return eventsFrozen(frozen) && frozen;
+}
+
+bool Cgroup::writeFile(const char* name, const std::string& value)
+{
+    if (m_directoryFd < 0) {
+        errno = EBADF;
+        return false;
+    }
+    int fd = openat(m_directoryFd, name, O_WRONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    bool written = write(fd, value.data(), value.size()) == static_cast<ssize_t>(value.size());
+    close(fd);
+    return written;
+}
+
+std::string Cgroup::readFile(const char* name)
+{
+    int fd = m_directoryFd >= 0 ? openat(m_directoryFd, name, O_RDONLY | O_CLOEXEC) : -1;
+    if (fd < 0)
+        return {};
+    char buffer[4096];
+    ssize_t size = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    return size > 0 ? std::string(buffer, size) : std::string();
+}
+
+bool Cgroup::eventsFrozen(bool& frozen)
+{
+    char buffer[256];
+    ssize_t size = pread(m_eventsFd, buffer, sizeof(buffer) - 1, 0);
+    if (size <= 0)
+        return false;
+    buffer[size] = '\0';
+    const char* field = strstr(buffer, "frozen ");
+    if (!field)
+        return false;
+    frozen = field[7] == '1';
+    return true;
+}
@@ -0,0 +1,31 @@
+#ifndef CGROUP_H
+#define CGROUP_H
+#include <chrono>
+#include <string>
+#include <sys/types.h>
+
+class Cgroup
+{
+public:
+    static std::string findRoot();
+    Cgroup();
+    ~Cgroup();
+    Cgroup(const Cgroup&) = delete;
+    Cgroup& operator=(const Cgroup&) = delete;
+    bool create(const std::string& path);
+    bool destroy();
+    bool isValid();
+    std::string getPath();
+    bool attach(pid_t pid);
+    bool freeze(bool frozen, std::chrono::milliseconds timeout);
+    bool isFrozen();
+    bool writeFile(const char* name, const std::string& value);
+    std::string readFile(const char* name);
+private:
+    bool eventsFrozen(bool& frozen);
+    std::string m_path;
+    int m_directoryFd;
+    int m_eventsFd;
+};
+
+#endif // CGROUP_H
@@ -1,3 +1,413 @@
 #include "communicationmanager.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
-CommunicationManager::CommunicationManager() {}
+namespace {
+
+constexpr size_t batchSize = 64;
+constexpr int spinRounds = 256;
+
+UNONKey makeKey(const std::array<uint8_t, 16>& unon)
+{
+    UNONKey key;
+    memcpy(key.bytes, unon.data(), sizeof(key.bytes));
+    return key;
+}
+
+inline void cpuRelax()
+{
+#ifdef __SSE2__
+    _mm_pause();
+#endif
+}
+
+}
+
+char* Message::data()
+{
+    return reinterpret_cast<char*>(this + 1);
+}
+
+const char* Message::data() const
+{
+    return reinterpret_cast<const char*>(this + 1);
+}
+
+uint32_t Message::capacity() const
+{
+    return m_capacity;
+}
+
+MessagePool::MessagePool(size_t count, size_t capacity)
+    : m_count(std::min<size_t>(count, UINT32_MAX - 1)),
+      m_stride((sizeof(Message) + capacity + 63) & ~size_t(63)),
+      m_memory(new char[m_count * m_stride + 64]),
+      m_messages(reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(m_memory.get()) + 63) & ~uintptr_t(63))),
+      m_free(m_count ? 1 : 0)
+{
+    for (size_t i = 0; i < m_count; ++i) {
+        Message* message = new (m_messages + i * m_stride) Message;
+        message->size = 0;
+        message->m_index = static_cast<uint32_t>(i);
+        message->m_capacity = static_cast<uint32_t>(capacity);
+        message->m_next.store(i + 1 < m_count ? static_cast<uint32_t>(i + 2) : 0, std::memory_order_relaxed);
+    }
+}
+
+Message* MessagePool::acquire()
+{
+    uint64_t head = m_free.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(head)) {
+        Message* message = at(static_cast<uint32_t>(head) - 1);
+        uint64_t next = ((head >> 32) + 1) << 32 | message->m_next.load(std::memory_order_relaxed);
+        if (m_free.compare_exchange_weak(head, next, std::memory_order_acquire, std::memory_order_acquire)) {
+            message->size = 0;
+            return message;
+        }
+    }
+    return nullptr;
+}
+
+void MessagePool::release(Message* message)
+{
+    uint64_t head = m_free.load(std::memory_order_relaxed);
+    uint64_t next;
+    do {
+        message->m_next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+        next = ((head >> 32) + 1) << 32 | (message->m_index + 1);
+    } while (!m_free.compare_exchange_weak(head, next, std::memory_order_release, std::memory_order_relaxed));
+}
+
+size_t MessagePool::size() const
+{
+    return m_count;
+}
+
+Message* MessagePool::at(uint32_t index) const
+{
+    return reinterpret_cast<Message*>(m_messages + index * m_stride);
+}
+
+MessageQueue::MessageQueue(size_t capacity)
+    : m_tail(0), m_head(0)
+{
+    size_t size = 2;
+    while (size < capacity)
+        size <<= 1;
+    m_mask = size - 1;
+    m_cells.reset(new Cell[size]);
+    for (size_t i = 0; i < size; ++i)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+bool MessageQueue::push(Message* message)
+{
+    size_t position = m_tail.load(std::memory_order_relaxed);
+    for (;;) {
+        Cell& cell = m_cells[position & m_mask];
+        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+        if (difference == 0) {
+            if (m_tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                cell.message = message;
+                cell.sequence.store(position + 1, std::memory_order_release);
+                return true;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            position = m_tail.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+size_t MessageQueue::pop(Message** messages, size_t count)
+{
+    size_t popped = 0;
+    while (popped < count) {
+        Cell& cell = m_cells[m_head & m_mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1)
+            break;
+        messages[popped++] = cell.message;
+        cell.sequence.store(m_head + m_mask + 1, std::memory_order_release);
+        ++m_head;
+    }
+    return popped;
+}
+
+bool MessageQueue::empty() const
+{
+    return m_cells[m_head & m_mask].sequence.load(std::memory_order_acquire) != m_head + 1;
+}
+
+CommunicationManager::Worker::Worker(size_t capacity)
+    : queue(capacity), wakeFd(eventfd(0, EFD_CLOEXEC)), sleeping(false), delivered(0), dropped(0), batches(0)
+{}
+
+CommunicationManager::CommunicationManager(size_t workers, size_t queueCapacity, size_t messages, size_t messageCapacity)
+    : m_pool(messages, messageCapacity), m_rejected(0), m_stopping(false)
+{
+    if (workers == 0)
+        workers = std::max<size_t>(CpuTopology::read().cpus.size(), 1);
+    for (size_t i = 0; i < workers; ++i)
+        m_workers.push_back(std::make_unique<Worker>(queueCapacity));
+}
+
+CommunicationManager::~CommunicationManager()
+{
+    stop();
+    for (auto& worker : m_workers)
+        if (worker->wakeFd >= 0)
+            close(worker->wakeFd);
+}
+
+bool CommunicationManager::start(bool pin)
+{
+    if (m_workers.front()->thread.joinable())
+        return false;
+
+    CpuTopology topology = CpuTopology::read();
+    m_stopping = false;
+    for (size_t i = 0; i < m_workers.size(); ++i) {
+        int cpu = pin && !topology.cpus.empty() ? topology.cpus[i % topology.cpus.size()] : -1;
+        m_workers[i]->thread = std::thread(&CommunicationManager::workerLoop, this, i, cpu);
+    }
+    return true;
+}
+
+void CommunicationManager::stop()
+{
+    m_stopping = true;
+    for (auto& worker : m_workers) {
+        if (!worker->thread.joinable())
+            continue;
+        eventfd_write(worker->wakeFd, 1);
+        worker->thread.join();
+    }
+
+    Message* messages[batchSize];
+    for (auto& worker : m_workers)
+        while (size_t count = worker->queue.pop(messages, batchSize))
+            for (size_t i = 0; i < count; ++i)
+                m_pool.release(messages[i]);
+}
+
+bool CommunicationManager::bind(const std::array<uint8_t, 16>& unon, Handler handler)
+{
+    Worker& worker = *m_workers[workerOf(unon)];
+    std::lock_guard<std::mutex> lock(worker.routeMutex);
+    UNONKey key = makeKey(unon);
+    uint32_t slot = worker.routes.find(key);
+    if (slot != SlotIndex<UNONKey>::npos) {
+        worker.handlers[slot] = std::move(handler);
+        return true;
+    }
+    worker.routes.insert(key, static_cast<uint32_t>(worker.handlers.size()));
+    worker.handlers.push_back(std::move(handler));
+    worker.keys.push_back(key);
+    return true;
+}
+
+bool CommunicationManager::unbind(const std::array<uint8_t, 16>& unon)
+{
+    Worker& worker = *m_workers[workerOf(unon)];
+    std::lock_guard<std::mutex> lock(worker.routeMutex);
+    UNONKey key = makeKey(unon);
+    uint32_t slot = worker.routes.find(key);
+    if (slot == SlotIndex<UNONKey>::npos)
+        return false;
+
+    worker.routes.erase(key);
+    uint32_t last = static_cast<uint32_t>(worker.handlers.size() - 1);
+    if (slot != last) {
+        worker.handlers[slot] = std::move(worker.handlers[last]);
+        worker.keys[slot] = worker.keys[last];
+        worker.routes.assign(worker.keys[slot], slot);
+    }
+    worker.handlers.pop_back();
+    worker.keys.pop_back();
+    return true;
+}
+
+Message* CommunicationManager::acquire()
+{
+    return m_pool.acquire();
+}
+
+Message* CommunicationManager::acquire(std::chrono::microseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int round = 0;; ++round) {
+        if (Message* message = m_pool.acquire())
+            return message;
+        if (std::chrono::steady_clock::now() >= deadline)
+            return nullptr;
+        if (round < spinRounds)
+            cpuRelax();
+        else
+            std::this_thread::yield();
+    }
+}
+
+void CommunicationManager::release(Message* message)
+{
+    m_pool.release(message);
+}
+
+bool CommunicationManager::trySend(Message* message)
+{
+    Worker& worker = *m_workers[workerOf(message->destination)];
+    if (!worker.queue.push(message)) {
+        m_rejected.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    wake(worker);
+    return true;
+}
+
+bool CommunicationManager::send(Message* message, std::chrono::microseconds timeout)
+{
+    Worker& worker = *m_workers[workerOf(message->destination)];
+    if (worker.queue.push(message)) {
+        wake(worker);
+        return true;
+    }
+
+    m_rejected.fetch_add(1, std::memory_order_relaxed);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (int round = 0; !worker.queue.push(message); ++round) {
+        if (std::chrono::steady_clock::now() >= deadline)
+            return false;
+        if (round < spinRounds)
+            cpuRelax();
+        else
+            std::this_thread::yield();
+    }
+    wake(worker);
+    return true;
+}
+
+bool CommunicationManager::post(const std::array<uint8_t, 16>& source, const std::array<uint8_t, 16>& destination,
+                                const void* data, __SIZE_TYPE__ size, std::chrono::microseconds timeout)
+{
+    Message* message = acquire(timeout);
+    if (!message)
+        return false;
+    if (size > message->capacity()) {
+        release(message);
+        return false;
+    }
+
+    message->source = source;
+    message->destination = destination;
+    message->size = static_cast<uint32_t>(size);
+    memcpy(message->data(), data, size);
+    if (send(message, timeout))
+        return true;
+    release(message);
+    return false;
+}
+
+size_t CommunicationManager::workerOf(const std::array<uint8_t, 16>& unon) const
+{
+    uint64_t low;
+    uint64_t high;
+    memcpy(&low, unon.data(), sizeof(low));
+    memcpy(&high, unon.data() + sizeof(low), sizeof(high));
+    uint64_t hash = (low ^ (high * 0x9E3779B97F4A7C15ULL)) * 0xff51afd7ed558ccdULL;
+    return static_cast<size_t>((hash >> 32) * m_workers.size() >> 32);
+}
+
+size_t CommunicationManager::getWorkerCount() const
+{
+    return m_workers.size();
+}
+
+BusStats CommunicationManager::getStats()
+{
+    BusStats stats;
+    for (auto& worker : m_workers) {
+        stats.delivered += worker->delivered.load(std::memory_order_relaxed);
+        stats.dropped += worker->dropped.load(std::memory_order_relaxed);
+        stats.batches += worker->batches.load(std::memory_order_relaxed);
+    }
+    stats.rejected = m_rejected.load(std::memory_order_relaxed);
+    return stats;
+}
+
+void CommunicationManager::wake(Worker& worker)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (worker.sleeping.load(std::memory_order_relaxed) && worker.sleeping.exchange(false))
+        eventfd_write(worker.wakeFd, 1);
+}
+
+void CommunicationManager::workerLoop(size_t index, int cpu)
+{
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    Worker& worker = *m_workers[index];
+    Message* messages[batchSize];
+    bool spin = std::thread::hardware_concurrency() > 1;
+    int idle = 0;
+
+    while (!m_stopping.load(std::memory_order_relaxed)) {
+        size_t count = worker.queue.pop(messages, batchSize);
+        if (count) {
+            dispatch(worker, messages, count);
+            idle = 0;
+            continue;
+        }
+        if (spin && idle++ < spinRounds) {
+            cpuRelax();
+            continue;
+        }
+
+        worker.sleeping.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (worker.queue.empty() && !m_stopping.load(std::memory_order_relaxed)) {
+            eventfd_t value;
+            eventfd_read(worker.wakeFd, &value);
+        }
+        worker.sleeping.store(false, std::memory_order_relaxed);
+        idle = 0;
+    }
+}
+
+void CommunicationManager::dispatch(Worker& worker, Message** messages, size_t count)
+{
+    uint64_t dropped = 0;
+    std::lock_guard<std::mutex> lock(worker.routeMutex);
+    for (size_t first = 0; first < count;) {
+        size_t last = first + 1;
+        while (last < count && messages[last]->destination == messages[first]->destination)
+            ++last;
+
+        uint32_t slot = worker.routes.find(makeKey(messages[first]->destination));
+        if (slot != SlotIndex<UNONKey>::npos) {
+            worker.handlers[slot](messages + first, last - first);
+        } else {
+            for (size_t i = first; i < last; ++i)
+                m_pool.release(messages[i]);
+            dropped += last - first;
+        }
+        first = last;
+    }
+
+    worker.delivered.fetch_add(count - dropped, std::memory_order_relaxed);
+    worker.dropped.fetch_add(dropped, std::memory_order_relaxed);
+    worker.batches.fetch_add(1, std::memory_order_relaxed);
+}
@@ -1,10 +1,123 @@
 #ifndef COMMUNICATIONMANAGER_H
 #define COMMUNICATIONMANAGER_H
+#include "instanceregistry.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class Message
+{
+public:
+    std::array<uint8_t, 16> source;
+    std::array<uint8_t, 16> destination;
+    uint32_t size;
+    char* data();
+    const char* data() const;
+    uint32_t capacity() const;
+private:
+    friend class MessagePool;
+    std::atomic<uint32_t> m_next;
+    uint32_t m_index;
+    uint32_t m_capacity;
+};
+
+class MessagePool
+{
+public:
+    MessagePool(size_t count, size_t capacity);
+    MessagePool(const MessagePool&) = delete;
+    MessagePool& operator=(const MessagePool&) = delete;
+    Message* acquire();
+    void release(Message* message);
+    size_t size() const;
+private:
+    Message* at(uint32_t index) const;
+    size_t m_count;
+    size_t m_stride;
+    std::unique_ptr<char[]> m_memory;
+    char* m_messages;
+    alignas(64) std::atomic<uint64_t> m_free;
+};
+
+class MessageQueue
+{
+public:
+    explicit MessageQueue(size_t capacity);
+    MessageQueue(const MessageQueue&) = delete;
+    MessageQueue& operator=(const MessageQueue&) = delete;
+    bool push(Message* message);
+    size_t pop(Message** messages, size_t count);
+    bool empty() const;
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence;
+        Message* message;
+    };
+    size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) size_t m_head;
+};
+
+struct BusStats
+{
+    uint64_t delivered = 0;
+    uint64_t dropped = 0;
+    uint64_t rejected = 0;
+    uint64_t batches = 0;
+};
 
 class CommunicationManager
 {
 public:
-    CommunicationManager();
+    using Handler = std::function<void(Message** messages, __SIZE_TYPE__ count)>;
+    explicit CommunicationManager(size_t workers = 0, size_t queueCapacity = 4096, size_t messages = 65536,
+                                  size_t messageCapacity = 4096);
+    ~CommunicationManager();
+    bool start(bool pin = true);
+    void stop();
+    bool bind(const std::array<uint8_t, 16>& unon, Handler handler);
+    bool unbind(const std::array<uint8_t, 16>& unon);
+    Message* acquire();
+    Message* acquire(std::chrono::microseconds timeout);
+    void release(Message* message);
+    bool trySend(Message* message);
+    bool send(Message* message, std::chrono::microseconds timeout);
+    bool post(const std::array<uint8_t, 16>& source, const std::array<uint8_t, 16>& destination, const void* data,
+              __SIZE_TYPE__ size, std::chrono::microseconds timeout = std::chrono::milliseconds(100));
+    size_t workerOf(const std::array<uint8_t, 16>& unon) const;
+    size_t getWorkerCount() const;
+    BusStats getStats();
+private:
+    struct Worker
+    {
+        explicit Worker(size_t capacity);
+        MessageQueue queue;
+        SlotIndex<UNONKey> routes;
+        std::vector<Handler> handlers;
+        std::vector<UNONKey> keys;
+        std::mutex routeMutex;
+        int wakeFd;
+        alignas(64) std::atomic<bool> sleeping;
+        std::atomic<uint64_t> delivered;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> batches;
+        std::thread thread;
+    };
+    void wake(Worker& worker);
+    void workerLoop(size_t index, int cpu);
+    void dispatch(Worker& worker, Message** messages, size_t count);
+    MessagePool m_pool;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<uint64_t> m_rejected;
+    std::atomic<bool> m_stopping;
 };
 
 #endif // COMMUNICATIONMANAGER_H
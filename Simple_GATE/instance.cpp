@@ -1,3 +1,444 @@
 #include "instance.h"
+#include "scheduler.h"
+#include "spawner.h"
+#include "zygote.h"
+#include "v_component.h"
+#include <algorithm>
+#include <cerrno>
+#include <mutex>
+#include <cstring>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
 
-Instance::Instance() {}
+static const std::string sharedComponentEnv = "QE_VCOMPONENT_FD";
+static const int terminateGraceMs = 2000;
+
+Instance::Instance()
+    : m_pid(-1), m_pidfd(-1), m_spawnMethod(SpawnMethod::PosixSpawn), m_UNON{}, m_status(ProcessStatus::NotStarted),
+      m_exitCode(0), m_terminating(false), m_clientSocket(-1),
+      m_priority(ProcessPriority::Medium), m_sharedAddress(0), m_sharedSize(0), m_sharedMapping(nullptr)
+{}
+
+Instance::~Instance()
+{
+    if (m_status == ProcessStatus::Running || m_status == ProcessStatus::Suspended)
+        terminate();
+    unmapSharedComponent();
+    detachSocket();
+    if (m_pidfd >= 0)
+        close(m_pidfd);
+}
+
+bool Instance::start(SpawnMethod method, Zygote* zygote)
+{
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_status == ProcessStatus::Running || m_status == ProcessStatus::Suspended)
+        return false;
+    if (method == SpawnMethod::Zygote && (!zygote || zygote->getExecutablePath() != m_executablePath)) {
+        errno = EINVAL;
+        return false;
+    }
+
+    int sharedFd = -1;
+    if (m_sharedSize && !mapSharedComponent(sharedFd)) {
+        m_status = ProcessStatus::Error;
+        return false;
+    }
+
+    pid_t pid = -1;
+    int pidfd = -1;
+    std::vector<int> inheritFds;
+    if (sharedFd >= 0)
+        inheritFds.push_back(sharedFd);
+    std::vector<std::string> env{sharedFd >= 0 ? sharedComponentEnv + "=" + std::to_string(sharedFd) : sharedComponentEnv};
+
+    switch (method) {
+    case SpawnMethod::ForkExec:
+        pid = forkExecProcess(m_executablePath, m_args, inheritFds, env);
+        break;
+    case SpawnMethod::PosixSpawn:
+        pid = spawnProcess(m_executablePath, m_args, inheritFds, env);
+        break;
+    case SpawnMethod::Zygote: {
+        std::vector<std::string> argv{m_executablePath};
+        argv.insert(argv.end(), m_args.begin(), m_args.end());
+        pid = zygote->spawn(argv, sharedFd, pidfd);
+        break;
+    }
+    }
+
+    if (sharedFd >= 0)
+        close(sharedFd);
+
+    if (pid > 0 && method == SpawnMethod::Zygote && pidfd < 0) {
+        kill(pid, SIGKILL);
+        pid = -1;
+    }
+    if (pid < 0) {
+        if (pidfd >= 0)
+            close(pidfd);
+        unmapSharedComponent();
+        m_status = ProcessStatus::Error;
+        return false;
+    }
+
+    if (m_pidfd >= 0)
+        close(m_pidfd);
+    m_pid = pid;
+    m_pidfd = method == SpawnMethod::Zygote ? pidfd : openPidfd(pid);
+    m_spawnMethod = method;
+    m_exitCode = 0;
+    m_terminating = false;
+    if (m_priority != ProcessPriority::Medium)
+        applyNice(m_pid, priorityNice(m_priority));
+    m_startTime = std::chrono::system_clock::now();
+    m_status = ProcessStatus::Running;
+    return true;
+}
+
+bool Instance::terminate()
+{
+    {
+        std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+        if (m_pid <= 0)
+            return false;
+
+        m_terminating = true;
+        if (m_status == ProcessStatus::Suspended)
+            sendSignal(SIGCONT);
+        sendSignal(SIGTERM);
+
+        pollfd exited = {m_pidfd, POLLIN, 0};
+        if (m_pidfd >= 0 && poll(&exited, 1, terminateGraceMs) == 0)
+            sendSignal(SIGKILL);
+    }
+    return reap(true);
+}
+
+bool Instance::suspend()
+{
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_status != ProcessStatus::Running || !sendSignal(SIGSTOP))
+        return false;
+    m_status = ProcessStatus::Suspended;
+    return true;
+}
+
+bool Instance::resume()
+{
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_status != ProcessStatus::Suspended || !sendSignal(SIGCONT))
+        return false;
+    m_status = ProcessStatus::Running;
+    return true;
+}
+
+void Instance::setPriority(ProcessPriority priority)
+{
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    m_priority = priority;
+    if (m_pid > 0)
+        applyNice(m_pid, priorityNice(priority));
+}
+
+bool Instance::sendSignal(int signal)
+{
+    if (m_pid <= 0)
+        return false;
+    if (m_pidfd >= 0)
+        return syscall(SYS_pidfd_send_signal, m_pidfd, signal, nullptr, 0) == 0;
+    return kill(m_pid, signal) == 0;
+}
+
+void Instance::setFrozen(bool frozen)
+{
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_pid > 0 && (m_status == ProcessStatus::Running || m_status == ProcessStatus::Suspended))
+        m_status = frozen ? ProcessStatus::Suspended : ProcessStatus::Running;
+}
+
+bool Instance::reap(bool wait)
+{
+    std::lock_guard<std::mutex> lifecycle(m_lifecycleMutex);
+    if (m_pid <= 0)
+        return true;
+
+    siginfo_t info = {};
+    if (m_spawnMethod == SpawnMethod::Zygote) {
+        pollfd exited = {m_pidfd, POLLIN, 0};
+        int ready;
+        while ((ready = poll(&exited, 1, wait ? -1 : 0)) < 0 && errno == EINTR)
+            ;
+        if (ready <= 0)
+            return false;
+    } else {
+        int options = WEXITED | (wait ? 0 : WNOHANG);
+        int result;
+        while ((result = m_pidfd >= 0 ? waitid(P_PIDFD, m_pidfd, &info, options) : waitid(P_PID, m_pid, &info, options)) < 0
+               && errno == EINTR)
+            ;
+        if (result < 0 ? errno != ECHILD : info.si_pid == 0)
+            return false;
+    }
+
+    bool killed = info.si_code == CLD_KILLED || info.si_code == CLD_DUMPED;
+    m_exitCode = killed ? -info.si_status : info.si_status;
+    bool failed = (info.si_code == CLD_EXITED && info.si_status != 0) || (killed && !m_terminating);
+
+    {
+        std::unique_lock<std::shared_mutex> lock(m_memoryMutex);
+        m_pid = -1;
+        unmapSharedComponent();
+    }
+    m_status = failed ? ProcessStatus::Error : ProcessStatus::Terminated;
+    return true;
+}
+
+bool Instance::attachSocket(int fd)
+{
+    if (fd < 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) < 0)
+        return false;
+    detachSocket();
+    m_clientSocket = fd;
+    return true;
+}
+
+void Instance::detachSocket()
+{
+    if (m_clientSocket >= 0)
+        close(m_clientSocket);
+    m_clientSocket = -1;
+}
+
+bool Instance::handleMessages(const std::function<void(const char*, __SIZE_TYPE__)>& handler)
+{
+    char buffer[65536];
+
+    for (;;) {
+        ssize_t received = recv(m_clientSocket, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received > 0) {
+            handler(buffer, received);
+            continue;
+        }
+        if (received < 0 && errno == EINTR)
+            continue;
+        return received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+    }
+}
+
+pid_t Instance::getPid()
+{
+    return m_pid;
+}
+
+int Instance::getPidfd()
+{
+    return m_pidfd;
+}
+
+Instance::SpawnMethod Instance::getSpawnMethod()
+{
+    return m_spawnMethod;
+}
+
+std::array<uint8_t, 16> Instance::getUNON()
+{
+    return m_UNON;
+}
+
+Instance::ProcessStatus Instance::getStatus()
+{
+    return m_status;
+}
+
+int Instance::getExitCode()
+{
+    return m_exitCode;
+}
+
+int Instance::getClientSocket()
+{
+    return m_clientSocket;
+}
+
+std::string Instance::getExecutablePath()
+{
+    return m_executablePath;
+}
+
+std::chrono::seconds Instance::getUptime()
+{
+    if (m_status != ProcessStatus::Running && m_status != ProcessStatus::Suspended)
+        return std::chrono::seconds(0);
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now() - m_startTime);
+}
+
+std::chrono::system_clock::time_point Instance::getStartTime()
+{
+    return m_startTime;
+}
+
+Instance::ProcessPriority Instance::getPriority()
+{
+    return m_priority;
+}
+
+bool Instance::mapSharedComponent(int& fd)
+{
+    fd = memfd_create("v_component", MFD_CLOEXEC);
+    if (fd < 0)
+        return false;
+
+    void* mapping = MAP_FAILED;
+    if (ftruncate(fd, m_sharedSize) == 0)
+        mapping = mmap(nullptr, m_sharedSize, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    m_sharedMapping = mapping;
+    return true;
+}
+
+void Instance::unmapSharedComponent()
+{
+    if (m_sharedMapping)
+        munmap(m_sharedMapping, m_sharedSize);
+    m_sharedMapping = nullptr;
+}
+
+const void* Instance::sharedAddress(__UINTPTR_TYPE__ adress, __SIZE_TYPE__ size) const
+{
+    if (!m_sharedMapping || adress < m_sharedAddress || size > m_sharedSize || adress - m_sharedAddress > m_sharedSize - size)
+        return nullptr;
+    return static_cast<const char*>(m_sharedMapping) + (adress - m_sharedAddress);
+}
+
+bool Instance::readMemory(__UINTPTR_TYPE__ adress, void* buffer, __SIZE_TYPE__ size)
+{
+    std::vector<MemoryRegion> regions{{adress, buffer, size}};
+    return readMemory(regions);
+}
+
+bool Instance::writeMemory(__UINTPTR_TYPE__ adress, const void* data, __SIZE_TYPE__ size)
+{
+    std::vector<MemoryRegion> regions{{adress, const_cast<void*>(data), size}};
+    return writeMemory(regions);
+}
+
+bool Instance::readMemory(std::vector<MemoryRegion>& regions)
+{
+    std::shared_lock<std::shared_mutex> lock(m_memoryMutex);
+
+    bool shared = m_sharedMapping != nullptr;
+    for (size_t i = 0; shared && i < regions.size(); ++i)
+        shared = sharedAddress(regions[i].address, regions[i].size) != nullptr;
+    if (!shared)
+        return transferMemory(regions, false);
+
+    for (auto& region : regions) {
+        memcpy(region.buffer, sharedAddress(region.address, region.size), region.size);
+        region.transferred = region.size;
+    }
+    return true;
+}
+
+bool Instance::readSnapshot(__UINTPTR_TYPE__ adress, void* buffer, __SIZE_TYPE__ size, unsigned int* generation, int tries)
+{
+    auto seq = static_cast<const unsigned int*>(sharedAddress(adress + V_SEQ_OFFSET, sizeof(unsigned int)));
+    auto value = sharedAddress(adress + V_VALUE_OFFSET, size);
+    if (seq && value) {
+        while (tries-- > 0) {
+            unsigned int start = v_read_begin(seq);
+            memcpy(buffer, value, size);
+            if (!v_read_retry(seq, start)) {
+                if (generation)
+                    *generation = start;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    unsigned int before = 0;
+    unsigned int after = 0;
+    std::vector<MemoryRegion> regions{
+        {adress + V_SEQ_OFFSET, &before, sizeof(before)},
+        {adress + V_VALUE_OFFSET, buffer, size},
+        {adress + V_SEQ_OFFSET, &after, sizeof(after)}};
+    while (tries-- > 0) {
+        if (!readMemory(regions))
+            return false;
+        if (!(before & 1) && before == after) {
+            if (generation)
+                *generation = before;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Instance::writeMemory(std::vector<MemoryRegion>& regions)
+{
+    std::unique_lock<std::shared_mutex> lock(m_memoryMutex);
+    return transferMemory(regions, true);
+}
+
+bool Instance::transferMemory(std::vector<MemoryRegion>& regions, bool write)
+{
+    constexpr size_t maxBatch = 64;
+
+    if (m_pid <= 0) {
+        errno = ESRCH;
+        return false;
+    }
+
+    for (auto& region : regions)
+        region.transferred = 0;
+
+    bool complete = true;
+    size_t next = 0;
+    while (next < regions.size()) {
+        if (regions[next].transferred == regions[next].size) {
+            ++next;
+            continue;
+        }
+
+        iovec local[maxBatch];
+        iovec remote[maxBatch];
+        size_t count = 0;
+        for (size_t i = next; i < regions.size() && count < maxBatch; ++i, ++count) {
+            MemoryRegion& region = regions[i];
+            local[count] = {static_cast<char*>(region.buffer) + region.transferred, region.size - region.transferred};
+            remote[count] = {reinterpret_cast<void*>(region.address + region.transferred), region.size - region.transferred};
+        }
+
+        ssize_t done = write
+            ? process_vm_writev(m_pid, local, count, remote, count, 0)
+            : process_vm_readv(m_pid, local, count, remote, count, 0);
+
+        if (done < 0 && errno != EFAULT)
+            return false;
+        if (done <= 0) {
+            complete = false;
+            ++next;
+            continue;
+        }
+
+        for (size_t i = next; done > 0; ++i) {
+            size_t step = std::min<size_t>(done, regions[i].size - regions[i].transferred);
+            regions[i].transferred += step;
+            done -= step;
+        }
+    }
+    return complete;
+}
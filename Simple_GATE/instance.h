@@ -1,47 +1,99 @@
 #ifndef INSTANCE_H
 #define INSTANCE_H
 #include <iostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class Zygote;
+
+struct MemoryRegion
+{
+    __UINTPTR_TYPE__ address;
+    void* buffer;
+    __SIZE_TYPE__ size;
+    __SIZE_TYPE__ transferred = 0;
+};
 
 class Instance
 {
 public:
+    enum class ProcessStatus{
+        NotStarted,
+        Running,
+        Suspended,
+        Terminated,
+        Error
+    };
+    enum class ProcessPriority {
+        Low,
+        Medium,
+        High
+    };
+    enum class SpawnMethod {
+        ForkExec,
+        PosixSpawn,
+        Zygote
+    };
     Instance();
-    bool start();
+    ~Instance();
+    bool start(SpawnMethod method = SpawnMethod::PosixSpawn, Zygote* zygote = nullptr);
     bool terminate();
+    bool reap(bool wait = false);
     bool suspend();
     bool resume();
     bool readMemory(__UINTPTR_TYPE__ adress, void* buffer, __SIZE_TYPE__ size);
     bool writeMemory (__UINTPTR_TYPE__ adress, const void* data, __SIZE_TYPE__ size);
-    void handleMessages();
+    bool readMemory(std::vector<MemoryRegion>& regions);
+    bool writeMemory(std::vector<MemoryRegion>& regions);
+    const void* sharedAddress(__UINTPTR_TYPE__ adress, __SIZE_TYPE__ size) const;
+    bool readSnapshot(__UINTPTR_TYPE__ adress, void* buffer, __SIZE_TYPE__ size, unsigned int* generation = nullptr, int tries = 8);
+    bool attachSocket(int fd);
+    void detachSocket();
+    bool handleMessages(const std::function<void(const char*, __SIZE_TYPE__)>& handler);
     pid_t getPid();
+    int getPidfd();
+    SpawnMethod getSpawnMethod();
     std::array<uint8_t, 16> getUNON();
     ProcessStatus getStatus();
+    int getExitCode();
+    int getClientSocket();
     std::string getExecutablePath();
     std::chrono::seconds getUptime();
+    std::chrono::system_clock::time_point getStartTime();
+    ProcessPriority getPriority();
     void setPriority(ProcessPriority priority);
 private:
-    enum class ProcessStatus{
-        NotStarted,
-        Running,
-        Suspended,
-        Terminated,
-        Error
-    };
-    enum class ProcessPriority {
-        Low,
-        Medium,
-        High
-    };
+    friend class InstanceBuilder;
+    friend class InstanceManager;
+    bool sendSignal(int signal);
+    void setFrozen(bool frozen);
+    bool mapSharedComponent(int& fd);
+    void unmapSharedComponent();
+    bool transferMemory(std::vector<MemoryRegion>& regions, bool write);
     pid_t m_pid;
+    int m_pidfd;
+    SpawnMethod m_spawnMethod;
     std::array<uint8_t, 16> m_UNON;
-    ProcessStatus m_status;
+    std::atomic<ProcessStatus> m_status;
+    int m_exitCode;
+    bool m_terminating;
     std::string m_executablePath;
     std::vector<std::string> m_args;
     int m_clientSocket;
-    std::thread m_communicationThread;
-    std::mutex m_memoryMutex;
+    std::mutex m_lifecycleMutex;
+    std::shared_mutex m_memoryMutex;
     std::chrono::system_clock::time_point m_startTime;
     ProcessPriority m_priority;
+    __UINTPTR_TYPE__ m_sharedAddress;
+    __SIZE_TYPE__ m_sharedSize;
+    void* m_sharedMapping;
 };
 
 #endif // INSTANCE_H
@@ -1,3 +1,43 @@
 #include "instancebuilder.h"
 
-InstanceBuilder::InstanceBuilder() {}
+InstanceBuilder::InstanceBuilder()
+    : m_instance(std::make_unique<Instance>())
+{}
+
+InstanceBuilder& InstanceBuilder::executable(const std::string& path)
+{
+    m_instance->m_executablePath = path;
+    return *this;
+}
+
+InstanceBuilder& InstanceBuilder::args(const std::vector<std::string>& args)
+{
+    m_instance->m_args = args;
+    return *this;
+}
+
+InstanceBuilder& InstanceBuilder::UNON(const std::array<uint8_t, 16>& unon)
+{
+    m_instance->m_UNON = unon;
+    return *this;
+}
+
+InstanceBuilder& InstanceBuilder::priority(Instance::ProcessPriority priority)
+{
+    m_instance->m_priority = priority;
+    return *this;
+}
+
+InstanceBuilder& InstanceBuilder::sharedComponent(__UINTPTR_TYPE__ address, __SIZE_TYPE__ size)
+{
+    m_instance->m_sharedAddress = address;
+    m_instance->m_sharedSize = size;
+    return *this;
+}
+
+std::unique_ptr<Instance> InstanceBuilder::build()
+{
+    auto instance = std::move(m_instance);
+    m_instance = std::make_unique<Instance>();
+    return instance;
+}
@@ -1,10 +1,20 @@
 #ifndef INSTANCEBUILDER_H
 #define INSTANCEBUILDER_H
+#include "instance.h"
+#include <memory>
 
 class InstanceBuilder
 {
 public:
     InstanceBuilder();
+    InstanceBuilder& executable(const std::string& path);
+    InstanceBuilder& args(const std::vector<std::string>& args);
+    InstanceBuilder& UNON(const std::array<uint8_t, 16>& unon);
+    InstanceBuilder& priority(Instance::ProcessPriority priority);
+    InstanceBuilder& sharedComponent(__UINTPTR_TYPE__ address, __SIZE_TYPE__ size = 4096);
+    std::unique_ptr<Instance> build();
+private:
+    std::unique_ptr<Instance> m_instance;
 };
 
 #endif // INSTANCEBUILDER_H
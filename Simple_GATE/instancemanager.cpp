@@ -1,3 +1,716 @@
 #include "instancemanager.h"
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
-InstanceManager::InstanceManager() {}
+std::chrono::nanoseconds SpawnStats::average() const
+{
+    return count ? total / static_cast<int64_t>(count) : std::chrono::nanoseconds(0);
+}
+
+namespace {
+
+constexpr uint64_t socketTag = 1;
+constexpr uint64_t timerTag = 2;
+constexpr Instance::ProcessPriority priorities[] = {Instance::ProcessPriority::Low, Instance::ProcessPriority::Medium,
+                                                    Instance::ProcessPriority::High};
+const char* const priorityNames[] = {"low", "medium", "high"};
+
+size_t histogramBucket(std::chrono::nanoseconds latency, size_t buckets)
+{
+    uint64_t units = static_cast<uint64_t>(latency.count()) >> 8;
+    if (units < 4)
+        return units;
+    int msb = 63 - __builtin_clzll(units);
+    size_t bucket = (msb - 1) * 4 + ((units >> (msb - 2)) & 3);
+    return std::min(bucket, buckets - 1);
+}
+
+std::chrono::nanoseconds histogramBound(size_t bucket)
+{
+    if (bucket < 4)
+        return std::chrono::nanoseconds((bucket + 1) << 8);
+    int msb = bucket / 4 + 1;
+    return std::chrono::nanoseconds(((4 + bucket % 4 + 1) << (msb - 2)) << 8);
+}
+
+bool processStopped(pid_t pid)
+{
+    std::ifstream stat("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    std::getline(stat, line);
+    size_t name = line.rfind(')');
+    return name == std::string::npos || name + 2 >= line.size() || line[name + 2] == 'T' || line[name + 2] == 't';
+}
+
+}
+
+std::chrono::nanoseconds SpawnStats::percentile(double fraction) const
+{
+    uint64_t rank = static_cast<uint64_t>(fraction * count);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < histogram.size(); ++bucket) {
+        seen += histogram[bucket];
+        if (seen > rank)
+            return std::min(max, histogramBound(bucket));
+    }
+    return max;
+}
+
+InstanceManager::InstanceManager()
+    : m_spawnMethod(Instance::SpawnMethod::PosixSpawn), m_epollFd(-1), m_wakeFd(-1), m_monitorStopping(false),
+      m_scheduling(false), m_schedulerStopping(false), m_watchdogTimeout(0)
+{}
+
+InstanceManager::~InstanceManager()
+{
+    stopTelemetry();
+    stopScheduler();
+    stopMonitor();
+    terminateAll();
+    m_zygote.stop();
+    for (auto& group : m_groups)
+        destroyGroupCgroups(*group.second);
+    m_releaseCgroup.destroy();
+    m_cgroupBase.destroy();
+}
+
+bool InstanceManager::enableZygote(const std::string& executablePath)
+{
+    if (m_zygote.isRunning())
+        m_zygote.stop();
+    if (!m_zygote.start(executablePath))
+        return false;
+    setSpawnMethod(Instance::SpawnMethod::Zygote);
+    return true;
+}
+
+void InstanceManager::disableZygote()
+{
+    m_zygote.stop();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_spawnMethod == Instance::SpawnMethod::Zygote)
+        m_spawnMethod = Instance::SpawnMethod::PosixSpawn;
+}
+
+bool InstanceManager::isZygoteEnabled()
+{
+    return m_zygote.isRunning();
+}
+
+void InstanceManager::setSpawnMethod(Instance::SpawnMethod method)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spawnMethod = method;
+}
+
+Instance::SpawnMethod InstanceManager::getSpawnMethod()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spawnMethod;
+}
+
+Instance* InstanceManager::add(std::unique_ptr<Instance> instance)
+{
+    std::unique_lock<std::shared_mutex> lock(m_registryMutex);
+    uint32_t slot = m_registry.insert(std::move(instance));
+    return slot == InstanceRegistry::npos ? nullptr : m_registry.instance(slot);
+}
+
+bool InstanceManager::remove(Instance* instance)
+{
+    std::lock_guard<std::mutex> groups(m_groupMutex);
+    std::unique_lock<std::shared_mutex> lock(m_registryMutex);
+    uint32_t slot = m_registry.findInstance(instance);
+    if (slot == InstanceRegistry::npos || m_registry.status(slot) == Instance::ProcessStatus::Running
+        || m_registry.status(slot) == Instance::ProcessStatus::Suspended)
+        return false;
+
+    if (m_epollFd >= 0 && instance->getClientSocket() >= 0)
+        epoll_ctl(m_epollFd, EPOLL_CTL_DEL, instance->getClientSocket(), nullptr);
+    leaveGroup(instance);
+    stopWatchdog(instance);
+    m_telemetry.untrack(reinterpret_cast<uintptr_t>(instance));
+    m_registry.erase(slot);
+    return true;
+}
+
+bool InstanceManager::start(Instance* instance)
+{
+    Instance::SpawnMethod method = getSpawnMethod();
+    if (method == Instance::SpawnMethod::Zygote
+        && (!m_zygote.isRunning() || m_zygote.getExecutablePath() != instance->getExecutablePath()))
+        method = Instance::SpawnMethod::PosixSpawn;
+
+    auto begin = std::chrono::steady_clock::now();
+    bool started = instance->start(method, &m_zygote);
+    auto latency = std::chrono::steady_clock::now() - begin;
+
+    recordSpawn(method, latency, started);
+    if (started) {
+        std::lock_guard<std::mutex> lock(m_groupMutex);
+        auto group = m_instanceGroups.find(instance);
+        if (group != m_instanceGroups.end() && groupCgroup(*group->second, instance->getPriority()).attach(instance->getPid()))
+            instance->setFrozen(group->second->frozen);
+    }
+    if (started && m_scheduling)
+        m_scheduler.place(instance->getPid(), instance->getPriority());
+    if (started && m_telemetry.isRunning())
+        m_telemetry.track(reinterpret_cast<uintptr_t>(instance), instance->getPid(), instance->getUNON());
+    sync(instance);
+    if (started && m_epollFd >= 0)
+        watchExit(instance, EPOLL_CTL_ADD);
+    return started;
+}
+
+size_t InstanceManager::startAll()
+{
+    size_t started = 0;
+    for (auto status : {Instance::ProcessStatus::NotStarted, Instance::ProcessStatus::Terminated, Instance::ProcessStatus::Error})
+        for (Instance* instance : getInstances(status))
+            started += start(instance);
+    return started;
+}
+
+bool InstanceManager::terminate(Instance* instance)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_groupMutex);
+        auto group = m_instanceGroups.find(instance);
+        if (group != m_instanceGroups.end() && group->second->frozen && group->second->cgroup.isValid())
+            m_releaseCgroup.attach(instance->getPid());
+    }
+    m_scheduler.forget(instance->getPid());
+    bool terminated = instance->terminate();
+    sync(instance);
+    return terminated;
+}
+
+void InstanceManager::terminateAll()
+{
+    for (auto status : {Instance::ProcessStatus::Running, Instance::ProcessStatus::Suspended})
+        for (Instance* instance : getInstances(status))
+            terminate(instance);
+}
+
+bool InstanceManager::suspend(Instance* instance)
+{
+    bool suspended = instance->suspend();
+    sync(instance);
+    return suspended;
+}
+
+bool InstanceManager::resume(Instance* instance)
+{
+    bool resumed = instance->resume();
+    sync(instance);
+    return resumed;
+}
+
+bool InstanceManager::createGroup(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_groupMutex);
+    if (name.empty() || name.find('/') != std::string::npos || name == "release" || m_groups.count(name))
+        return false;
+
+    auto group = std::make_unique<InstanceGroup>();
+    std::string path = openCgroupBase() ? m_cgroupBase.getPath() + "/" + name : std::string();
+    if (!path.empty() && group->cgroup.create(path) && group->cgroup.writeFile("cgroup.subtree_control", "+cpu")) {
+        group->weighted = true;
+        for (size_t i = 0; i < 3; ++i)
+            group->weighted = group->weighted && group->priorities[i].create(path + "/" + priorityNames[i])
+                && group->priorities[i].writeFile("cpu.weight", std::to_string(priorityWeight(priorities[i])));
+        if (!group->weighted) {
+            for (auto& leaf : group->priorities)
+                leaf.destroy();
+            group->cgroup.writeFile("cgroup.subtree_control", "-cpu");
+        }
+    }
+    m_groups.emplace(name, std::move(group));
+    return true;
+}
+
+bool InstanceManager::destroyGroup(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_groupMutex);
+    auto group = m_groups.find(name);
+    if (group == m_groups.end() || !group->second->members.empty())
+        return false;
+
+    destroyGroupCgroups(*group->second);
+    m_groups.erase(group);
+    return true;
+}
+
+bool InstanceManager::addToGroup(Instance* instance, const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_groupMutex);
+    auto found = m_groups.find(name);
+    if (found == m_groups.end())
+        return false;
+
+    InstanceGroup& group = *found->second;
+    leaveGroup(instance);
+    group.members.push_back(instance);
+    m_instanceGroups[instance] = &group;
+
+    if (instance->getPid() > 0) {
+        if (group.cgroup.isValid() && groupCgroup(group, instance->getPriority()).attach(instance->getPid()))
+            instance->setFrozen(group.frozen);
+        else if (!group.cgroup.isValid() && group.frozen)
+            instance->suspend();
+        sync(instance);
+    }
+    return true;
+}
+
+bool InstanceManager::suspendGroup(const std::string& name, std::chrono::milliseconds timeout)
+{
+    std::lock_guard<std::mutex> lock(m_groupMutex);
+    auto group = m_groups.find(name);
+    if (group == m_groups.end())
+        return false;
+    return group->second->cgroup.isValid() ? freezeGroup(*group->second, true, timeout) : signalGroup(*group->second, true, timeout);
+}
+
+bool InstanceManager::resumeGroup(const std::string& name, std::chrono::milliseconds timeout)
+{
+    std::lock_guard<std::mutex> lock(m_groupMutex);
+    auto group = m_groups.find(name);
+    if (group == m_groups.end())
+        return false;
+    return group->second->cgroup.isValid() ? freezeGroup(*group->second, false, timeout) : signalGroup(*group->second, false, timeout);
+}
+
+bool InstanceManager::hasCgroupFreezer()
+{
+    std::lock_guard<std::mutex> lock(m_groupMutex);
+    return openCgroupBase();
+}
+
+bool InstanceManager::openCgroupBase()
+{
+    if (!m_cgroupBase.isValid()) {
+        std::string root = Cgroup::findRoot();
+        if (!root.empty() && m_cgroupBase.create(root + "/gate." + std::to_string(getpid()))) {
+            m_cgroupBase.writeFile("cgroup.subtree_control", "+cpu");
+            m_releaseCgroup.create(m_cgroupBase.getPath() + "/release");
+        }
+    }
+    return m_cgroupBase.isValid();
+}
+
+Cgroup& InstanceManager::groupCgroup(InstanceGroup& group, Instance::ProcessPriority priority)
+{
+    return group.weighted ? group.priorities[static_cast<size_t>(priority)] : group.cgroup;
+}
+
+void InstanceManager::destroyGroupCgroups(InstanceGroup& group)
+{
+    for (auto& leaf : group.priorities)
+        leaf.destroy();
+    group.cgroup.destroy();
+}
+
+void InstanceManager::setPriority(Instance* instance, Instance::ProcessPriority priority)
+{
+    instance->setPriority(priority);
+    pid_t pid = instance->getPid();
+    if (pid > 0) {
+        m_scheduler.setPriority(pid, priority);
+        std::lock_guard<std::mutex> lock(m_groupMutex);
+        auto group = m_instanceGroups.find(instance);
+        if (group != m_instanceGroups.end() && group->second->weighted)
+            group->second->priorities[static_cast<size_t>(priority)].attach(pid);
+    }
+    sync(instance);
+}
+
+bool InstanceManager::startScheduler(std::chrono::milliseconds interval)
+{
+    if (m_schedulerThread.joinable())
+        return false;
+
+    m_scheduling = true;
+    for (Instance* instance : getInstances(Instance::ProcessStatus::Running))
+        m_scheduler.place(instance->getPid(), instance->getPriority());
+    m_schedulerStopping = false;
+    m_schedulerThread = std::thread(&InstanceManager::schedulerLoop, this, interval);
+    return true;
+}
+
+void InstanceManager::stopScheduler()
+{
+    if (!m_schedulerThread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_schedulerMutex);
+        m_schedulerStopping = true;
+    }
+    m_schedulerWake.notify_all();
+    m_schedulerThread.join();
+    m_scheduling = false;
+    m_scheduler.reset();
+}
+
+Scheduler& InstanceManager::getScheduler()
+{
+    return m_scheduler;
+}
+
+bool InstanceManager::startTelemetry(std::chrono::milliseconds interval)
+{
+    if (m_telemetry.isRunning())
+        return false;
+    for (auto status : {Instance::ProcessStatus::Running, Instance::ProcessStatus::Suspended})
+        for (Instance* instance : getInstances(status))
+            m_telemetry.track(reinterpret_cast<uintptr_t>(instance), instance->getPid(), instance->getUNON());
+    return m_telemetry.start(interval);
+}
+
+void InstanceManager::stopTelemetry()
+{
+    m_telemetry.stop();
+}
+
+TelemetryCollector& InstanceManager::getTelemetry()
+{
+    return m_telemetry;
+}
+
+bool InstanceManager::getTelemetry(Instance* instance, TelemetrySeries& series)
+{
+    return m_telemetry.getSeries(reinterpret_cast<uintptr_t>(instance), series);
+}
+
+void InstanceManager::schedulerLoop(std::chrono::milliseconds interval)
+{
+    std::unique_lock<std::mutex> lock(m_schedulerMutex);
+    while (!m_schedulerWake.wait_for(lock, interval, [this] { return m_schedulerStopping; }))
+        m_scheduler.rebalance();
+}
+
+bool InstanceManager::freezeGroup(InstanceGroup& group, bool frozen, std::chrono::milliseconds timeout)
+{
+    if (!group.cgroup.freeze(frozen, timeout))
+        return false;
+
+    group.frozen = frozen;
+    for (Instance* instance : group.members) {
+        instance->setFrozen(frozen);
+        sync(instance);
+    }
+    return true;
+}
+
+bool InstanceManager::signalGroup(InstanceGroup& group, bool suspend, std::chrono::milliseconds timeout)
+{
+    std::vector<Instance*> changed;
+    for (Instance* instance : group.members)
+        if (suspend ? instance->suspend() : instance->resume())
+            changed.push_back(instance);
+    group.frozen = suspend;
+
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool complete = true;
+    for (Instance* instance : changed) {
+        while (suspend && !processStopped(instance->getPid()) && std::chrono::steady_clock::now() < deadline)
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        complete = complete && (!suspend || processStopped(instance->getPid()));
+        sync(instance);
+    }
+    return complete;
+}
+
+void InstanceManager::leaveGroup(Instance* instance)
+{
+    auto current = m_instanceGroups.find(instance);
+    if (current == m_instanceGroups.end())
+        return;
+
+    auto& members = current->second->members;
+    members.erase(std::remove(members.begin(), members.end(), instance), members.end());
+    m_instanceGroups.erase(current);
+}
+
+Instance* InstanceManager::findByUNON(const std::array<uint8_t, 16>& unon)
+{
+    std::shared_lock<std::shared_mutex> lock(m_registryMutex);
+    uint32_t slot = m_registry.findUNON(unon);
+    return slot == InstanceRegistry::npos ? nullptr : m_registry.instance(slot);
+}
+
+Instance* InstanceManager::findByPid(pid_t pid)
+{
+    std::shared_lock<std::shared_mutex> lock(m_registryMutex);
+    uint32_t slot = m_registry.findPid(pid);
+    return slot == InstanceRegistry::npos ? nullptr : m_registry.instance(slot);
+}
+
+size_t InstanceManager::countByStatus(Instance::ProcessStatus status)
+{
+    std::shared_lock<std::shared_mutex> lock(m_registryMutex);
+    return m_registry.countStatus(status);
+}
+
+std::vector<Instance*> InstanceManager::getInstances(Instance::ProcessStatus status)
+{
+    std::shared_lock<std::shared_mutex> lock(m_registryMutex);
+    std::vector<Instance*> instances;
+    for (uint32_t slot : m_registry.findStatus(status))
+        instances.push_back(m_registry.instance(slot));
+    return instances;
+}
+
+const std::vector<std::unique_ptr<Instance>>& InstanceManager::getInstances()
+{
+    return m_registry.instances();
+}
+
+void InstanceManager::sync(Instance* instance)
+{
+    std::unique_lock<std::shared_mutex> lock(m_registryMutex);
+    uint32_t slot = m_registry.findInstance(instance);
+    if (slot != InstanceRegistry::npos)
+        m_registry.update(slot);
+}
+
+SpawnStats InstanceManager::getSpawnStats(Instance::SpawnMethod method)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_spawnStats[static_cast<size_t>(method)];
+}
+
+void InstanceManager::resetSpawnStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_spawnStats = {};
+}
+
+void InstanceManager::recordSpawn(Instance::SpawnMethod method, std::chrono::nanoseconds latency, bool started)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    SpawnStats& stats = m_spawnStats[static_cast<size_t>(method)];
+    if (!started) {
+        ++stats.failures;
+        return;
+    }
+
+    ++stats.count;
+    stats.total += latency;
+    stats.min = std::min(stats.min, latency);
+    stats.max = std::max(stats.max, latency);
+
+    ++stats.histogram[histogramBucket(latency, stats.histogram.size())];
+}
+
+void InstanceManager::setStatusHandler(StatusHandler handler)
+{
+    m_statusHandler = std::move(handler);
+}
+
+void InstanceManager::setMessageHandler(MessageHandler handler)
+{
+    m_messageHandler = std::move(handler);
+}
+
+bool InstanceManager::startMonitor(size_t threads)
+{
+    if (m_epollFd >= 0)
+        return false;
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    epoll_event wake = {EPOLLIN, {}};
+    epoll_event timer = {EPOLLIN | EPOLLONESHOT, {}};
+    timer.data.u64 = timerTag;
+    if (m_epollFd < 0 || m_wakeFd < 0 || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &wake) < 0
+        || epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_timers.getFd(), &timer) < 0) {
+        stopMonitor();
+        return false;
+    }
+
+    for (auto& instance : getInstances()) {
+        if (instance->getPid() > 0)
+            watchExit(instance.get(), EPOLL_CTL_ADD);
+        if (instance->getClientSocket() >= 0)
+            watchSocket(instance.get(), EPOLL_CTL_ADD);
+    }
+
+    m_monitorStopping = false;
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+        m_monitorThreads.emplace_back(&InstanceManager::monitorLoop, this);
+    return true;
+}
+
+void InstanceManager::stopMonitor()
+{
+    m_monitorStopping = true;
+    if (m_wakeFd >= 0)
+        eventfd_write(m_wakeFd, 1);
+    for (auto& thread : m_monitorThreads)
+        thread.join();
+    m_monitorThreads.clear();
+
+    if (m_epollFd >= 0)
+        close(m_epollFd);
+    if (m_wakeFd >= 0)
+        close(m_wakeFd);
+    m_epollFd = -1;
+    m_wakeFd = -1;
+}
+
+bool InstanceManager::attachSocket(Instance* instance, int fd)
+{
+    if (!instance->attachSocket(fd))
+        return false;
+    feedWatchdog(instance);
+    return m_epollFd < 0 || watchSocket(instance, EPOLL_CTL_ADD);
+}
+
+void InstanceManager::setWatchdog(std::chrono::milliseconds timeout, WatchdogHandler handler)
+{
+    std::vector<Instance*> watched;
+    {
+        std::lock_guard<std::mutex> lock(m_watchdogMutex);
+        m_watchdogTimeout = timeout;
+        m_watchdogHandler = std::move(handler);
+        for (auto& timer : m_watchdogTimers)
+            m_timers.cancel(timer.second);
+        m_watchdogTimers.clear();
+        m_responsive.clear();
+    }
+    for (auto& instance : getInstances())
+        if (instance->getClientSocket() >= 0)
+            feedWatchdog(instance.get());
+}
+
+bool InstanceManager::isResponsive(Instance* instance)
+{
+    std::lock_guard<std::mutex> lock(m_watchdogMutex);
+    auto responsive = m_responsive.find(instance);
+    return responsive == m_responsive.end() || responsive->second;
+}
+
+TimerWheel& InstanceManager::getTimers()
+{
+    return m_timers;
+}
+
+bool InstanceManager::watchExit(Instance* instance, int operation)
+{
+    epoll_event event = {EPOLLIN | EPOLLONESHOT, {}};
+    event.data.u64 = reinterpret_cast<uintptr_t>(instance);
+    return instance->getPidfd() >= 0 && epoll_ctl(m_epollFd, operation, instance->getPidfd(), &event) == 0;
+}
+
+bool InstanceManager::watchSocket(Instance* instance, int operation)
+{
+    epoll_event event = {EPOLLIN | EPOLLRDHUP | EPOLLONESHOT, {}};
+    event.data.u64 = reinterpret_cast<uintptr_t>(instance) | socketTag;
+    return epoll_ctl(m_epollFd, operation, instance->getClientSocket(), &event) == 0;
+}
+
+void InstanceManager::monitorLoop()
+{
+    epoll_event events[64];
+
+    while (!m_monitorStopping) {
+        int count = epoll_wait(m_epollFd, events, 64, -1);
+        for (int i = 0; i < count; ++i) {
+            uint64_t data = events[i].data.u64;
+            if (data == 0)
+                continue;
+            if (data == timerTag) {
+                m_timers.advance();
+                epoll_event timer = {EPOLLIN | EPOLLONESHOT, {}};
+                timer.data.u64 = timerTag;
+                epoll_ctl(m_epollFd, EPOLL_CTL_MOD, m_timers.getFd(), &timer);
+                continue;
+            }
+
+            Instance* instance = reinterpret_cast<Instance*>(data & ~socketTag);
+            if (data & socketTag)
+                handleSocket(instance);
+            else
+                handleExit(instance);
+        }
+    }
+}
+
+void InstanceManager::handleExit(Instance* instance)
+{
+    pid_t pid = instance->getPid();
+    if (!instance->reap()) {
+        watchExit(instance, EPOLL_CTL_MOD);
+        return;
+    }
+
+    m_scheduler.forget(pid);
+    stopWatchdog(instance);
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, instance->getPidfd(), nullptr);
+    if (m_statusHandler)
+        m_statusHandler(instance, instance->getStatus());
+    sync(instance);
+}
+
+void InstanceManager::handleSocket(Instance* instance)
+{
+    bool open = instance->handleMessages([&](const char* data, __SIZE_TYPE__ size) {
+        if (m_messageHandler)
+            m_messageHandler(instance, data, size);
+    });
+
+    if (open) {
+        feedWatchdog(instance);
+        watchSocket(instance, EPOLL_CTL_MOD);
+        return;
+    }
+
+    stopWatchdog(instance);
+    epoll_ctl(m_epollFd, EPOLL_CTL_DEL, instance->getClientSocket(), nullptr);
+    instance->detachSocket();
+}
+
+void InstanceManager::feedWatchdog(Instance* instance)
+{
+    std::lock_guard<std::mutex> lock(m_watchdogMutex);
+    if (m_watchdogTimeout.count() <= 0)
+        return;
+
+    m_responsive[instance] = true;
+    auto& timer = m_watchdogTimers[instance];
+    if (!m_timers.reschedule(timer, m_watchdogTimeout))
+        timer = m_timers.schedule(m_watchdogTimeout, [this, instance] { expireWatchdog(instance); });
+}
+
+void InstanceManager::stopWatchdog(Instance* instance)
+{
+    std::lock_guard<std::mutex> lock(m_watchdogMutex);
+    auto timer = m_watchdogTimers.find(instance);
+    if (timer == m_watchdogTimers.end())
+        return;
+    m_timers.cancel(timer->second);
+    m_watchdogTimers.erase(timer);
+    m_responsive.erase(instance);
+}
+
+void InstanceManager::expireWatchdog(Instance* instance)
+{
+    WatchdogHandler handler;
+    {
+        std::lock_guard<std::mutex> lock(m_watchdogMutex);
+        auto timer = m_watchdogTimers.find(instance);
+        if (timer == m_watchdogTimers.end() || m_timers.isArmed(timer->second))
+            return;
+        timer->second = TimerWheel::invalid;
+        m_responsive[instance] = false;
+        handler = m_watchdogHandler;
+    }
+    if (handler)
+        handler(instance);
+}
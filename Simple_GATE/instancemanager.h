@@ -1,10 +1,145 @@
 #ifndef INSTANCEMANAGER_H
 #define INSTANCEMANAGER_H
+#include "cgroup.h"
+#include "instance.h"
+#include "instanceregistry.h"
+#include "scheduler.h"
+#include "telemetry.h"
+#include "timerwheel.h"
+#include "zygote.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+struct SpawnStats
+{
+    uint64_t count = 0;
+    uint64_t failures = 0;
+    std::chrono::nanoseconds total{0};
+    std::chrono::nanoseconds min = std::chrono::nanoseconds::max();
+    std::chrono::nanoseconds max{0};
+    std::array<uint64_t, 72> histogram{};
+
+    std::chrono::nanoseconds average() const;
+    std::chrono::nanoseconds percentile(double fraction) const;
+};
 
 class InstanceManager
 {
 public:
+    using StatusHandler = std::function<void(Instance*, Instance::ProcessStatus)>;
+    using MessageHandler = std::function<void(Instance*, const char*, __SIZE_TYPE__)>;
+    using WatchdogHandler = std::function<void(Instance*)>;
     InstanceManager();
+    ~InstanceManager();
+    bool enableZygote(const std::string& executablePath);
+    void disableZygote();
+    bool isZygoteEnabled();
+    void setSpawnMethod(Instance::SpawnMethod method);
+    Instance::SpawnMethod getSpawnMethod();
+    Instance* add(std::unique_ptr<Instance> instance);
+    bool remove(Instance* instance);
+    bool start(Instance* instance);
+    size_t startAll();
+    bool terminate(Instance* instance);
+    void terminateAll();
+    bool suspend(Instance* instance);
+    bool resume(Instance* instance);
+    bool createGroup(const std::string& name);
+    bool destroyGroup(const std::string& name);
+    bool addToGroup(Instance* instance, const std::string& name);
+    bool suspendGroup(const std::string& name, std::chrono::milliseconds timeout = std::chrono::seconds(1));
+    bool resumeGroup(const std::string& name, std::chrono::milliseconds timeout = std::chrono::seconds(1));
+    bool hasCgroupFreezer();
+    void setPriority(Instance* instance, Instance::ProcessPriority priority);
+    bool startScheduler(std::chrono::milliseconds interval = std::chrono::milliseconds(500));
+    void stopScheduler();
+    Scheduler& getScheduler();
+    bool startTelemetry(std::chrono::milliseconds interval = std::chrono::seconds(1));
+    void stopTelemetry();
+    TelemetryCollector& getTelemetry();
+    bool getTelemetry(Instance* instance, TelemetrySeries& series);
+    Instance* findByUNON(const std::array<uint8_t, 16>& unon);
+    Instance* findByPid(pid_t pid);
+    size_t countByStatus(Instance::ProcessStatus status);
+    std::vector<Instance*> getInstances(Instance::ProcessStatus status);
+    const std::vector<std::unique_ptr<Instance>>& getInstances();
+    SpawnStats getSpawnStats(Instance::SpawnMethod method);
+    void resetSpawnStats();
+    void setStatusHandler(StatusHandler handler);
+    void setMessageHandler(MessageHandler handler);
+    bool startMonitor(size_t threads = 1);
+    void stopMonitor();
+    bool attachSocket(Instance* instance, int fd);
+    void setWatchdog(std::chrono::milliseconds timeout, WatchdogHandler handler);
+    bool isResponsive(Instance* instance);
+    TimerWheel& getTimers();
+private:
+    struct InstanceGroup
+    {
+        Cgroup cgroup;
+        std::array<Cgroup, 3> priorities;
+        std::vector<Instance*> members;
+        bool frozen = false;
+        bool weighted = false;
+    };
+    bool openCgroupBase();
+    Cgroup& groupCgroup(InstanceGroup& group, Instance::ProcessPriority priority);
+    void destroyGroupCgroups(InstanceGroup& group);
+    void schedulerLoop(std::chrono::milliseconds interval);
+    bool freezeGroup(InstanceGroup& group, bool frozen, std::chrono::milliseconds timeout);
+    bool signalGroup(InstanceGroup& group, bool suspend, std::chrono::milliseconds timeout);
+    void leaveGroup(Instance* instance);
+    void recordSpawn(Instance::SpawnMethod method, std::chrono::nanoseconds latency, bool started);
+    void sync(Instance* instance);
+    bool watchExit(Instance* instance, int operation);
+    bool watchSocket(Instance* instance, int operation);
+    void monitorLoop();
+    void handleExit(Instance* instance);
+    void handleSocket(Instance* instance);
+    void feedWatchdog(Instance* instance);
+    void stopWatchdog(Instance* instance);
+    void expireWatchdog(Instance* instance);
+    InstanceRegistry m_registry;
+    std::shared_mutex m_registryMutex;
+    Instance::SpawnMethod m_spawnMethod;
+    Zygote m_zygote;
+    std::array<SpawnStats, 3> m_spawnStats;
+    std::mutex m_mutex;
+    StatusHandler m_statusHandler;
+    MessageHandler m_messageHandler;
+    int m_epollFd;
+    int m_wakeFd;
+    std::atomic<bool> m_monitorStopping;
+    std::vector<std::thread> m_monitorThreads;
+    Scheduler m_scheduler;
+    std::atomic<bool> m_scheduling;
+    bool m_schedulerStopping;
+    std::thread m_schedulerThread;
+    std::mutex m_schedulerMutex;
+    std::condition_variable m_schedulerWake;
+    TelemetryCollector m_telemetry;
+    TimerWheel m_timers;
+    std::chrono::milliseconds m_watchdogTimeout;
+    WatchdogHandler m_watchdogHandler;
+    std::unordered_map<const Instance*, TimerWheel::TimerId> m_watchdogTimers;
+    std::unordered_map<const Instance*, bool> m_responsive;
+    std::mutex m_watchdogMutex;
+    Cgroup m_cgroupBase;
+    Cgroup m_releaseCgroup;
+    std::map<std::string, std::unique_ptr<InstanceGroup>> m_groups;
+    std::unordered_map<const Instance*, InstanceGroup*> m_instanceGroups;
+    std::mutex m_groupMutex;
 };
 
 #endif // INSTANCEMANAGER_H
@@ -0,0 +1,319 @@
+#include "instanceregistry.h"
+#include <algorithm>
+#include <cstring>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+inline uint64_t mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    return value;
+}
+
+inline uint64_t keyHash(const UNONKey& key)
+{
+    uint64_t low;
+    uint64_t high;
+    memcpy(&low, key.bytes, sizeof(low));
+    memcpy(&high, key.bytes + sizeof(low), sizeof(high));
+    return mix(low ^ mix(high));
+}
+
+inline uint64_t keyHash(pid_t key)
+{
+    return mix(static_cast<uint32_t>(key));
+}
+
+inline uint64_t keyHash(__UINTPTR_TYPE__ key)
+{
+    return mix(key);
+}
+
+inline bool keyEqual(const UNONKey& a, const UNONKey& b)
+{
+#ifdef __SSE2__
+    __m128i equal = _mm_cmpeq_epi8(_mm_load_si128(reinterpret_cast<const __m128i*>(a.bytes)),
+                                   _mm_load_si128(reinterpret_cast<const __m128i*>(b.bytes)));
+    return _mm_movemask_epi8(equal) == 0xFFFF;
+#else
+    return memcmp(a.bytes, b.bytes, sizeof(a.bytes)) == 0;
+#endif
+}
+
+template <typename Key>
+inline bool keyEqual(const Key& a, const Key& b)
+{
+    return a == b;
+}
+
+UNONKey makeKey(const std::array<uint8_t, 16>& unon)
+{
+    UNONKey key;
+    memcpy(key.bytes, unon.data(), sizeof(key.bytes));
+    return key;
+}
+
+bool isAssigned(const UNONKey& key)
+{
+    return !keyEqual(key, UNONKey{});
+}
+
+}
+
+template <typename Key>
+bool SlotIndex<Key>::insert(const Key& key, uint32_t slot)
+{
+    if ((m_count + 1) * 2 > m_entries.size())
+        grow();
+
+    size_t mask = m_entries.size() - 1;
+    for (size_t i = keyHash(key) & mask;; i = (i + 1) & mask) {
+        Entry& entry = m_entries[i];
+        if (entry.slot == npos) {
+            entry.key = key;
+            entry.slot = slot;
+            ++m_count;
+            return true;
+        }
+        if (keyEqual(entry.key, key))
+            return false;
+    }
+}
+
+template <typename Key>
+bool SlotIndex<Key>::erase(const Key& key)
+{
+    if (m_entries.empty())
+        return false;
+
+    size_t mask = m_entries.size() - 1;
+    size_t hole = keyHash(key) & mask;
+    for (;; hole = (hole + 1) & mask) {
+        if (m_entries[hole].slot == npos)
+            return false;
+        if (keyEqual(m_entries[hole].key, key))
+            break;
+    }
+
+    for (size_t i = (hole + 1) & mask; m_entries[i].slot != npos; i = (i + 1) & mask) {
+        size_t home = keyHash(m_entries[i].key) & mask;
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            m_entries[hole] = m_entries[i];
+            hole = i;
+        }
+    }
+    m_entries[hole].slot = npos;
+    --m_count;
+    return true;
+}
+
+template <typename Key>
+uint32_t SlotIndex<Key>::find(const Key& key) const
+{
+    if (m_entries.empty())
+        return npos;
+
+    size_t mask = m_entries.size() - 1;
+    for (size_t i = keyHash(key) & mask;; i = (i + 1) & mask) {
+        const Entry& entry = m_entries[i];
+        if (entry.slot == npos)
+            return npos;
+        if (keyEqual(entry.key, key))
+            return entry.slot;
+    }
+}
+
+template <typename Key>
+void SlotIndex<Key>::assign(const Key& key, uint32_t slot)
+{
+    if (!insert(key, slot)) {
+        size_t mask = m_entries.size() - 1;
+        size_t i = keyHash(key) & mask;
+        while (!keyEqual(m_entries[i].key, key))
+            i = (i + 1) & mask;
+        m_entries[i].slot = slot;
+    }
+}
+
+template <typename Key>
+void SlotIndex<Key>::grow()
+{
+    std::vector<Entry> entries(std::max<size_t>(16, m_entries.size() * 2));
+    entries.swap(m_entries);
+    m_count = 0;
+    for (auto& entry : entries)
+        if (entry.slot != npos)
+            insert(entry.key, entry.slot);
+}
+
+template class SlotIndex<UNONKey>;
+template class SlotIndex<pid_t>;
+template class SlotIndex<__UINTPTR_TYPE__>;
+
+uint32_t InstanceRegistry::insert(std::unique_ptr<Instance> instance)
+{
+    uint32_t slot = static_cast<uint32_t>(m_instances.size());
+    UNONKey key = makeKey(instance->getUNON());
+    if (isAssigned(key) && !m_UNONIndex.insert(key, slot))
+        return npos;
+
+    m_instanceIndex.insert(reinterpret_cast<__UINTPTR_TYPE__>(instance.get()), slot);
+    m_pids.push_back(-1);
+    m_statuses.push_back(0);
+    m_priorities.push_back(0);
+    m_startTimes.push_back(0);
+    m_UNONs.push_back(key);
+    m_instances.push_back(std::move(instance));
+    update(slot);
+    return slot;
+}
+
+std::unique_ptr<Instance> InstanceRegistry::erase(uint32_t slot)
+{
+    std::unique_ptr<Instance> instance = std::move(m_instances[slot]);
+    if (isAssigned(m_UNONs[slot]))
+        m_UNONIndex.erase(m_UNONs[slot]);
+    if (m_pids[slot] > 0 && m_pidIndex.find(m_pids[slot]) == slot)
+        m_pidIndex.erase(m_pids[slot]);
+    m_instanceIndex.erase(reinterpret_cast<__UINTPTR_TYPE__>(instance.get()));
+
+    uint32_t last = static_cast<uint32_t>(m_instances.size() - 1);
+    if (slot != last) {
+        m_pids[slot] = m_pids[last];
+        m_statuses[slot] = m_statuses[last];
+        m_priorities[slot] = m_priorities[last];
+        m_startTimes[slot] = m_startTimes[last];
+        m_UNONs[slot] = m_UNONs[last];
+        m_instances[slot] = std::move(m_instances[last]);
+
+        if (isAssigned(m_UNONs[slot]))
+            m_UNONIndex.assign(m_UNONs[slot], slot);
+        if (m_pids[slot] > 0 && m_pidIndex.find(m_pids[slot]) == last)
+            m_pidIndex.assign(m_pids[slot], slot);
+        m_instanceIndex.assign(reinterpret_cast<__UINTPTR_TYPE__>(m_instances[slot].get()), slot);
+    }
+
+    m_pids.pop_back();
+    m_statuses.pop_back();
+    m_priorities.pop_back();
+    m_startTimes.pop_back();
+    m_UNONs.pop_back();
+    m_instances.pop_back();
+    return instance;
+}
+
+void InstanceRegistry::update(uint32_t slot)
+{
+    Instance* instance = m_instances[slot].get();
+    pid_t pid = instance->getPid();
+    if (pid != m_pids[slot]) {
+        if (m_pids[slot] > 0 && m_pidIndex.find(m_pids[slot]) == slot)
+            m_pidIndex.erase(m_pids[slot]);
+        if (pid > 0)
+            m_pidIndex.assign(pid, slot);
+        m_pids[slot] = pid;
+    }
+    m_statuses[slot] = static_cast<uint8_t>(instance->getStatus());
+    m_priorities[slot] = static_cast<uint8_t>(instance->getPriority());
+    m_startTimes[slot] = std::chrono::duration_cast<std::chrono::nanoseconds>(instance->getStartTime().time_since_epoch()).count();
+}
+
+uint32_t InstanceRegistry::findUNON(const std::array<uint8_t, 16>& unon) const
+{
+    return m_UNONIndex.find(makeKey(unon));
+}
+
+uint32_t InstanceRegistry::findPid(pid_t pid) const
+{
+    return m_pidIndex.find(pid);
+}
+
+uint32_t InstanceRegistry::findInstance(const Instance* instance) const
+{
+    return m_instanceIndex.find(reinterpret_cast<__UINTPTR_TYPE__>(instance));
+}
+
+size_t InstanceRegistry::size() const
+{
+    return m_instances.size();
+}
+
+Instance* InstanceRegistry::instance(uint32_t slot) const
+{
+    return m_instances[slot].get();
+}
+
+pid_t InstanceRegistry::pid(uint32_t slot) const
+{
+    return m_pids[slot];
+}
+
+Instance::ProcessStatus InstanceRegistry::status(uint32_t slot) const
+{
+    return static_cast<Instance::ProcessStatus>(m_statuses[slot]);
+}
+
+Instance::ProcessPriority InstanceRegistry::priority(uint32_t slot) const
+{
+    return static_cast<Instance::ProcessPriority>(m_priorities[slot]);
+}
+
+int64_t InstanceRegistry::startTime(uint32_t slot) const
+{
+    return m_startTimes[slot];
+}
+
+size_t InstanceRegistry::countStatus(Instance::ProcessStatus status) const
+{
+    const uint8_t* statuses = m_statuses.data();
+    uint8_t value = static_cast<uint8_t>(status);
+    size_t count = 0;
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+    __m128i total = _mm_setzero_si128();
+    size_t blocks = m_statuses.size() & ~size_t(15);
+    while (i < blocks) {
+        __m128i lanes = _mm_setzero_si128();
+        for (size_t end = std::min(blocks, i + 255 * 16); i < end; i += 16) {
+            __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(statuses + i));
+            lanes = _mm_sub_epi8(lanes, _mm_cmpeq_epi8(block, needle));
+        }
+        total = _mm_add_epi64(total, _mm_sad_epu8(lanes, _mm_setzero_si128()));
+    }
+    count = _mm_cvtsi128_si64(total) + _mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total));
+#endif
+    for (; i < m_statuses.size(); ++i)
+        count += statuses[i] == value;
+    return count;
+}
+
+std::vector<uint32_t> InstanceRegistry::findStatus(Instance::ProcessStatus status) const
+{
+    const uint8_t* statuses = m_statuses.data();
+    uint8_t value = static_cast<uint8_t>(status);
+    std::vector<uint32_t> slots;
+    size_t i = 0;
+#ifdef __SSE2__
+    __m128i needle = _mm_set1_epi8(static_cast<char>(value));
+    for (; i + 16 <= m_statuses.size(); i += 16) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(statuses + i));
+        for (unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)); mask; mask &= mask - 1)
+            slots.push_back(static_cast<uint32_t>(i + __builtin_ctz(mask)));
+    }
+#endif
+    for (; i < m_statuses.size(); ++i)
+        if (statuses[i] == value)
+            slots.push_back(static_cast<uint32_t>(i));
+    return slots;
+}
+
+const std::vector<std::unique_ptr<Instance>>& InstanceRegistry::instances() const
+{
+    return m_instances;
+}
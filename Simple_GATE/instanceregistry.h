@@ -0,0 +1,65 @@
+#ifndef INSTANCEREGISTRY_H
+#define INSTANCEREGISTRY_H
+#include "instance.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct alignas(16) UNONKey
+{
+    uint8_t bytes[16];
+};
+
+template <typename Key>
+class SlotIndex
+{
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+    bool insert(const Key& key, uint32_t slot);
+    bool erase(const Key& key);
+    uint32_t find(const Key& key) const;
+    void assign(const Key& key, uint32_t slot);
+private:
+    struct Entry
+    {
+        Key key;
+        uint32_t slot = npos;
+    };
+    void grow();
+    std::vector<Entry> m_entries;
+    size_t m_count = 0;
+};
+
+class InstanceRegistry
+{
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+    uint32_t insert(std::unique_ptr<Instance> instance);
+    std::unique_ptr<Instance> erase(uint32_t slot);
+    void update(uint32_t slot);
+    uint32_t findUNON(const std::array<uint8_t, 16>& unon) const;
+    uint32_t findPid(pid_t pid) const;
+    uint32_t findInstance(const Instance* instance) const;
+    size_t size() const;
+    Instance* instance(uint32_t slot) const;
+    pid_t pid(uint32_t slot) const;
+    Instance::ProcessStatus status(uint32_t slot) const;
+    Instance::ProcessPriority priority(uint32_t slot) const;
+    int64_t startTime(uint32_t slot) const;
+    size_t countStatus(Instance::ProcessStatus status) const;
+    std::vector<uint32_t> findStatus(Instance::ProcessStatus status) const;
+    const std::vector<std::unique_ptr<Instance>>& instances() const;
+private:
+    std::vector<pid_t> m_pids;
+    std::vector<uint8_t> m_statuses;
+    std::vector<uint8_t> m_priorities;
+    std::vector<int64_t> m_startTimes;
+    std::vector<UNONKey> m_UNONs;
+    std::vector<std::unique_ptr<Instance>> m_instances;
+    SlotIndex<UNONKey> m_UNONIndex;
+    SlotIndex<pid_t> m_pidIndex;
+    SlotIndex<__UINTPTR_TYPE__> m_instanceIndex;
+};
+
+#endif // INSTANCEREGISTRY_H
@@ -1,9 +1,635 @@
+#include "communicationmanager.h"
+#include "instancebuilder.h"
+#include "instancemanager.h"
+#include "systemconfig.h"
+#include "timerwheel.h"
+#include "qe_nddi.h"
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
 #include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
 
 using namespace std;
 
-int main()
+static void waitExited(InstanceManager& manager)
 {
+    vector<pollfd> pending;
+    for (auto& instance : manager.getInstances())
+        if (instance->getPidfd() >= 0)
+            pending.push_back({instance->getPidfd(), POLLIN, 0});
+
+    while (!pending.empty()) {
+        if (poll(pending.data(), pending.size(), -1) < 0)
+            continue;
+        pending.erase(remove_if(pending.begin(), pending.end(), [](const pollfd& p) { return p.revents != 0; }), pending.end());
+    }
+}
+
+static int benchSpawn(const string& executable, size_t count, size_t parentMegabytes)
+{
+    static const pair<Instance::SpawnMethod, const char*> methods[] = {
+        {Instance::SpawnMethod::ForkExec, "fork/exec"},
+        {Instance::SpawnMethod::PosixSpawn, "posix_spawn"},
+        {Instance::SpawnMethod::Zygote, "zygote"}};
+
+    vector<char> parentMemory(parentMegabytes << 20, 1);
+    int devNull = open("/dev/null", O_RDONLY);
+    dup2(devNull, STDIN_FILENO);
+    close(devNull);
+
+    cout << count << " instances, GATE resident set +" << parentMegabytes << " MB" << endl;
+    cout << left << setw(12) << "method" << right << setw(10) << "spawn/s" << setw(10) << "avg us"
+         << setw(10) << "p50 us" << setw(10) << "p99 us" << setw(10) << "max us" << setw(12) << "ready ms" << endl;
+
+    for (auto& [method, name] : methods) {
+        InstanceManager manager;
+        if (method == Instance::SpawnMethod::Zygote) {
+            if (!manager.enableZygote(executable)) {
+                cerr << "zygote: " << strerror(errno) << endl;
+                return 1;
+            }
+        } else {
+            manager.setSpawnMethod(method);
+        }
+
+        for (size_t i = 0; i < count; ++i)
+            manager.add(InstanceBuilder().executable(executable).args({"-s"}).sharedComponent(0x20000).build());
+
+        auto begin = chrono::steady_clock::now();
+        size_t started = manager.startAll();
+        auto spawned = chrono::steady_clock::now();
+        waitExited(manager);
+        auto ready = chrono::steady_clock::now();
+        manager.terminateAll();
+
+        SpawnStats stats = manager.getSpawnStats(method);
+        auto us = [](chrono::nanoseconds t) { return chrono::duration<double, micro>(t).count(); };
+        cout << left << setw(12) << name << right << fixed << setprecision(0)
+             << setw(10) << started / chrono::duration<double>(spawned - begin).count() << setprecision(1)
+             << setw(10) << us(stats.average()) << setw(10) << us(stats.percentile(0.5))
+             << setw(10) << us(stats.percentile(0.99)) << setw(10) << us(stats.max)
+             << setw(12) << chrono::duration<double, milli>(ready - begin).count() << endl;
+        if (stats.failures)
+            cerr << name << ": " << stats.failures << " spawns failed" << endl;
+    }
+    return 0;
+}
+
+static size_t threadCount()
+{
+    ifstream status("/proc/self/status");
+    string line;
+    while (getline(status, line))
+        if (line.compare(0, 8, "Threads:") == 0)
+            return stoul(line.substr(8));
+    return 0;
+}
+
+static int benchMonitor(const string& executable, size_t count, size_t messages)
+{
+    rlimit files;
+    getrlimit(RLIMIT_NOFILE, &files);
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+
+    InstanceManager manager;
+    if (!manager.enableZygote(executable)) {
+        cerr << "zygote: " << strerror(errno) << endl;
+        return 1;
+    }
+
+    int input[2];
+    if (pipe2(input, O_CLOEXEC) < 0)
+        return 1;
+    dup2(input[0], STDIN_FILENO);
+    close(input[0]);
+
+    mutex lock;
+    condition_variable changed;
+    size_t exited = 0;
+    size_t errors = 0;
+    size_t received = 0;
+    manager.setStatusHandler([&](Instance*, Instance::ProcessStatus status) {
+        lock_guard<mutex> guard(lock);
+        ++exited;
+        errors += status == Instance::ProcessStatus::Error;
+        changed.notify_all();
+    });
+    manager.setMessageHandler([&](Instance*, const char*, size_t) {
+        lock_guard<mutex> guard(lock);
+        ++received;
+        changed.notify_all();
+    });
+    manager.startMonitor();
+
+    for (size_t i = 0; i < count; ++i)
+        manager.add(InstanceBuilder().executable(executable).args({"-s", "-o", "/dev/null"}).build());
+    size_t started = manager.startAll();
+
+    vector<int> peers;
+    for (auto& instance : manager.getInstances()) {
+        int pair[2];
+        if (!messages || socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, pair) < 0)
+            break;
+        manager.attachSocket(instance.get(), pair[0]);
+        peers.push_back(pair[1]);
+    }
+
+    auto begin = chrono::steady_clock::now();
+    for (int peer : peers)
+        for (size_t i = 0; i < messages; ++i)
+            send(peer, &i, sizeof(i), 0);
+    {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&] { return received == peers.size() * messages; });
+    }
+    auto delivered = chrono::steady_clock::now();
+
+    close(STDIN_FILENO);
+    close(input[1]);
+    {
+        unique_lock<mutex> guard(lock);
+        changed.wait(guard, [&] { return exited == started; });
+    }
+    auto done = chrono::steady_clock::now();
+
+    cout << started << " instances, " << peers.size() << " sockets, GATE threads: " << threadCount() << endl;
+    if (messages)
+        cout << received << " messages delivered in " << chrono::duration<double, milli>(delivered - begin).count() << " ms" << endl;
+    cout << exited << " exits detected in " << chrono::duration<double, milli>(done - delivered).count()
+         << " ms, " << errors << " with errors" << endl;
+
+    for (int peer : peers)
+        close(peer);
+    return 0;
+}
+
+static int connectServer(const string& path, chrono::milliseconds timeout)
+{
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+
+    auto deadline = chrono::steady_clock::now() + timeout;
+    while (chrono::steady_clock::now() < deadline) {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0)
+            return fd;
+        close(fd);
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+    return -1;
+}
+
+static bool solveRemote(int fd, const vector<qe_args>& args, vector<qe_result>& results)
+{
+    uint32_t count = static_cast<uint32_t>(args.size());
+    if (send(fd, &count, sizeof(count), MSG_NOSIGNAL) != sizeof(count)
+        || send(fd, args.data(), args.size() * sizeof(qe_args), MSG_NOSIGNAL) != static_cast<ssize_t>(args.size() * sizeof(qe_args)))
+        return false;
+
+    char* reply = reinterpret_cast<char*>(results.data());
+    size_t left = results.size() * sizeof(qe_result);
+    while (left > 0) {
+        ssize_t size = recv(fd, reply, left, 0);
+        if (size <= 0)
+            return false;
+        reply += size;
+        left -= size;
+    }
+    return true;
+}
+
+static int benchSched(const string& executable, size_t hogs, size_t servers, size_t seconds)
+{
+    int zero = open("/dev/zero", O_RDONLY);
+    dup2(zero, STDIN_FILENO);
+    close(zero);
+
+    vector<qe_args> args(256);
+    for (size_t i = 0; i < args.size(); ++i)
+        args[i] = {1.0f, static_cast<float>(i % 17) - 8.0f, static_cast<float>(i % 5) - 2.0f};
+    vector<qe_result> results(args.size());
+
+    cout << hogs << " stream instances, " << servers << " High priority servers, " << seconds << " s per mode" << endl;
+    cout << left << setw(12) << "placement" << right << setw(10) << "requests" << setw(10) << "p50 us"
+         << setw(10) << "p99 us" << setw(10) << "p99.9 us" << setw(10) << "max us" << endl;
+
+    for (bool scheduled : {false, true}) {
+        InstanceManager manager;
+        auto low = scheduled ? Instance::ProcessPriority::Low : Instance::ProcessPriority::Medium;
+        auto high = scheduled ? Instance::ProcessPriority::High : Instance::ProcessPriority::Medium;
+        vector<string> paths;
+        for (size_t i = 0; i < hogs; ++i)
+            manager.add(InstanceBuilder().executable(executable).args({"-s", "-o", "/dev/null"}).priority(low).build());
+        for (size_t i = 0; i < servers; ++i) {
+            paths.push_back("/tmp/gate-bench-" + to_string(getpid()) + "-" + to_string(i) + ".sock");
+            unlink(paths.back().c_str());
+            manager.add(InstanceBuilder().executable(executable).args({"-u", paths.back(), "-w", "1"}).priority(high).build());
+        }
+        manager.startAll();
+        if (scheduled)
+            manager.startScheduler(chrono::milliseconds(200));
+
+        vector<int> connections;
+        for (auto& path : paths) {
+            int fd = connectServer(path, chrono::seconds(5));
+            if (fd < 0) {
+                cerr << path << ": " << strerror(errno) << endl;
+                return 1;
+            }
+            connections.push_back(fd);
+        }
+
+        vector<double> latencies;
+        auto end = chrono::steady_clock::now() + chrono::seconds(seconds);
+        while (chrono::steady_clock::now() < end) {
+            for (int fd : connections) {
+                auto begin = chrono::steady_clock::now();
+                if (!solveRemote(fd, args, results)) {
+                    cerr << "request failed" << endl;
+                    return 1;
+                }
+                latencies.push_back(chrono::duration<double, micro>(chrono::steady_clock::now() - begin).count());
+            }
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+
+        for (int fd : connections)
+            close(fd);
+        manager.stopScheduler();
+        manager.terminateAll();
+        for (auto& path : paths)
+            unlink(path.c_str());
+
+        sort(latencies.begin(), latencies.end());
+        auto rank = [&](double fraction) { return latencies[min(latencies.size() - 1, static_cast<size_t>(fraction * latencies.size()))]; };
+        cout << left << setw(12) << (scheduled ? "scheduler" : "kernel") << right << fixed << setprecision(0)
+             << setw(10) << latencies.size() << setw(10) << rank(0.5) << setw(10) << rank(0.99)
+             << setw(10) << rank(0.999) << setw(10) << latencies.back() << endl;
+    }
+    return 0;
+}
+
+static int benchTelemetry(size_t count, size_t seconds, size_t intervalMs)
+{
+    rlimit files;
+    getrlimit(RLIMIT_NOFILE, &files);
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+
+    vector<pid_t> children;
+    for (size_t i = 0; i < count; ++i) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            pause();
+            _exit(0);
+        }
+        if (pid < 0)
+            break;
+        children.push_back(pid);
+    }
+
+    cout << children.size() << " processes, " << intervalMs << " ms interval, " << seconds << " s per mode" << endl;
+    cout << left << setw(12) << "reads" << right << setw(10) << "passes" << setw(12) << "pass ms"
+         << setw(12) << "full reads" << setw(10) << "cpu %" << setw(12) << "B/sample" << endl;
+
+    for (unsigned refresh : {1u, 60u}) {
+        TelemetryCollector collector(300, TelemetryCollector::Stat | TelemetryCollector::Io | TelemetryCollector::Schedstat, refresh);
+        for (size_t i = 0; i < children.size(); ++i)
+            if (!collector.track(i, children[i])) {
+                cerr << "track " << children[i] << ": " << strerror(errno) << endl;
+                break;
+            }
+
+        collector.start(chrono::milliseconds(intervalMs));
+        this_thread::sleep_for(chrono::seconds(seconds));
+        collector.stop();
+        CollectorStats stats = collector.getStats();
+
+        char path[] = "/tmp/gate-telemetry-XXXXXX";
+        int fd = mkstemp(path);
+        unlink(path);
+        collector.exportBinary(fd);
+        string exported(lseek(fd, 0, SEEK_END), '\0');
+        pread(fd, &exported[0], exported.size(), 0);
+        close(fd);
+
+        vector<TelemetrySeries> imported;
+        size_t importedSamples = 0;
+        if (TelemetryCollector::importBinary(exported, imported))
+            for (auto& series : imported)
+                importedSamples += series.samples.size();
+        ostringstream text;
+        collector.dumpText(text);
+
+        cout << left << setw(12) << (refresh == 1 ? "full" : "adaptive") << right << setw(10) << stats.passes << fixed
+             << setprecision(2) << setw(12) << chrono::duration<double, milli>(stats.lastPass).count()
+             << setw(12) << stats.fullReads << setw(10) << stats.cpuLoad() * 100 << setprecision(1)
+             << setw(12) << static_cast<double>(exported.size()) / stats.samples << endl;
+        if (importedSamples != stats.samples)
+            cerr << "binary export round trip: " << importedSamples << " of " << stats.samples << " samples" << endl;
+        cout << "  text dump " << text.str().size() << " bytes, binary " << exported.size() << " bytes" << endl;
+    }
+
+    for (pid_t pid : children)
+        kill(pid, SIGKILL);
+    for (pid_t pid : children)
+        waitpid(pid, nullptr, 0);
+    return 0;
+}
+
+static int benchBus(size_t messages)
+{
+    size_t cpus = CpuTopology::read().cpus.size();
+    vector<size_t> workerCounts = {1, 4, cpus};
+    sort(workerCounts.begin(), workerCounts.end());
+    workerCounts.erase(unique(workerCounts.begin(), workerCounts.end()), workerCounts.end());
+
+    cout << messages << " messages of 64 bytes, 64 destinations, " << cpus << " cpus" << endl;
+    cout << left << setw(10) << "workers" << right << setw(12) << "msg/s" << setw(10) << "p50 us"
+         << setw(10) << "p99 us" << setw(10) << "p99.9 us" << setw(10) << "batch" << setw(10) << "rejected" << endl;
+
+    for (size_t workers : workerCounts) {
+        CommunicationManager bus(workers, 1024, 16384, 64);
+        vector<array<uint8_t, 16>> destinations(64);
+        vector<vector<uint32_t>> latencies(destinations.size());
+        for (size_t i = 0; i < destinations.size(); ++i) {
+            destinations[i].fill(0);
+            destinations[i][0] = static_cast<uint8_t>(i + 1);
+            destinations[i][15] = static_cast<uint8_t>(i * 37);
+            latencies[i].reserve(messages / destinations.size() + 1);
+            bus.bind(destinations[i], [&bus, &latency = latencies[i]](Message** batch, size_t count) {
+                int64_t now = chrono::steady_clock::now().time_since_epoch().count();
+                for (size_t j = 0; j < count; ++j) {
+                    int64_t sent;
+                    memcpy(&sent, batch[j]->data(), sizeof(sent));
+                    latency.push_back(static_cast<uint32_t>(min<int64_t>(now - sent, UINT32_MAX)));
+                    bus.release(batch[j]);
+                }
+            });
+        }
+        bus.start();
+
+        size_t producers = workers;
+        vector<thread> threads;
+        auto begin = chrono::steady_clock::now();
+        for (size_t p = 0; p < producers; ++p)
+            threads.emplace_back([&, p] {
+                for (size_t i = p; i < messages; i += producers) {
+                    Message* message = bus.acquire(chrono::seconds(1));
+                    if (!message)
+                        continue;
+                    message->destination = destinations[i % destinations.size()];
+                    message->size = 64;
+                    int64_t now = chrono::steady_clock::now().time_since_epoch().count();
+                    memcpy(message->data(), &now, sizeof(now));
+                    if (!bus.send(message, chrono::seconds(1)))
+                        bus.release(message);
+                }
+            });
+        for (auto& t : threads)
+            t.join();
+        while (bus.getStats().delivered + bus.getStats().dropped < messages)
+            this_thread::sleep_for(chrono::microseconds(100));
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - begin).count();
+        BusStats stats = bus.getStats();
+        bus.stop();
+
+        vector<uint32_t> all;
+        for (auto& latency : latencies)
+            all.insert(all.end(), latency.begin(), latency.end());
+        sort(all.begin(), all.end());
+        auto rank = [&](double fraction) { return all[min(all.size() - 1, static_cast<size_t>(fraction * all.size()))] / 1000.0; };
+        cout << left << setw(10) << workers << right << fixed << setprecision(0) << setw(12) << stats.delivered / elapsed
+             << setprecision(1) << setw(10) << rank(0.5) << setw(10) << rank(0.99) << setw(10) << rank(0.999)
+             << setw(10) << static_cast<double>(stats.delivered) / stats.batches << setw(10) << stats.rejected << endl;
+    }
+    return 0;
+}
+
+static int64_t threadCpuNanoseconds()
+{
+    timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+static int benchTimers(size_t seconds)
+{
+    cout << "1 ms tick, " << seconds << " s idle window" << endl;
+    cout << right << setw(8) << "timers" << setw(12) << "schedule ns" << setw(14) << "reschedule ns" << setw(11) << "cancel ns"
+         << setw(14) << "idle cpu us/s" << setw(10) << "wakeups/s" << setw(11) << "expire ns" << setw(12) << "max late ms" << endl;
+
+    for (size_t count : {100, 1000, 10000, 100000}) {
+        TimerWheel wheel(chrono::milliseconds(1));
+        uint64_t seed = 88172645463325252ULL;
+        auto random = [&seed](uint64_t range) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            return seed % range;
+        };
+        auto perTimer = [count](chrono::steady_clock::duration elapsed) {
+            return static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count()) / count;
+        };
+
+        vector<TimerWheel::TimerId> timers(count);
+        auto begin = chrono::steady_clock::now();
+        for (auto& timer : timers)
+            timer = wheel.schedule(chrono::milliseconds(10000 + random(60000)), [] {});
+        double scheduleCost = perTimer(chrono::steady_clock::now() - begin);
+
+        begin = chrono::steady_clock::now();
+        for (auto timer : timers)
+            wheel.reschedule(timer, chrono::milliseconds(10000 + random(60000)));
+        double rescheduleCost = perTimer(chrono::steady_clock::now() - begin);
+
+        size_t wakeups = 0;
+        int64_t cpu = threadCpuNanoseconds();
+        auto end = chrono::steady_clock::now() + chrono::seconds(seconds);
+        for (auto now = chrono::steady_clock::now(); now < end; now = chrono::steady_clock::now()) {
+            pollfd timer = {wheel.getFd(), POLLIN, 0};
+            if (poll(&timer, 1, static_cast<int>(chrono::duration_cast<chrono::milliseconds>(end - now).count()) + 1) > 0) {
+                wheel.advance();
+                ++wakeups;
+            }
+        }
+        double idleCost = (threadCpuNanoseconds() - cpu) / 1000.0 / seconds;
+
+        begin = chrono::steady_clock::now();
+        for (auto timer : timers)
+            wheel.cancel(timer);
+        double cancelCost = perTimer(chrono::steady_clock::now() - begin);
+
+        size_t fired = 0;
+        int64_t lateness = 0;
+        for (size_t i = 0; i < count; ++i) {
+            auto delay = chrono::milliseconds(100 + random(1000));
+            auto due = chrono::steady_clock::now() + delay;
+            wheel.schedule(delay, [&fired, &lateness, due] {
+                ++fired;
+                lateness = max<int64_t>(lateness, chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - due).count());
+            });
+        }
+        cpu = threadCpuNanoseconds();
+        while (fired < count) {
+            pollfd timer = {wheel.getFd(), POLLIN, 0};
+            if (poll(&timer, 1, 2000) > 0)
+                wheel.advance();
+        }
+        double expireCost = static_cast<double>(threadCpuNanoseconds() - cpu) / count;
+
+        cout << setw(8) << count << fixed << setprecision(1) << setw(12) << scheduleCost << setw(14) << rescheduleCost
+             << setw(11) << cancelCost << setw(14) << idleCost << setw(10) << wakeups / static_cast<double>(seconds)
+             << setw(11) << expireCost << setw(12) << lateness / 1000.0 << endl;
+    }
+    return 0;
+}
+
+static int benchConfig(size_t count)
+{
+    char directory[] = "/tmp/gate-config-XXXXXX";
+    if (!mkdtemp(directory)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    string source = string(directory) + "/system.conf";
+    string output = string(directory) + "/system.bin";
+    uint64_t seed = 88172645463325252ULL;
+    auto random = [&seed]() {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        return seed;
+    };
+
+    vector<array<uint8_t, 16>> unons(count);
+    auto writeSource = [&](uint64_t generation) {
+        ofstream out(source);
+        out << "generation = " << generation << "\n";
+        for (size_t i = 0; i < count; ++i) {
+            out << "\n[instance]\nunon = " << hex << setfill('0');
+            for (uint8_t byte : unons[i])
+                out << setw(2) << static_cast<int>(byte);
+            out << dec << setfill(' ') << "\nexecutable = /opt/gate/solver" << i % 16 << "\nargs = --port " << 9000 + i
+                << " \"--name solver " << i << "\"\npriority = " << (i % 3 == 0 ? "high" : "medium") << "\n";
+            if (i % 4 == 0)
+                out << "shared = 0x20000 4096\n";
+        }
+    };
+    for (auto& unon : unons)
+        for (size_t byte = 0; byte < unon.size(); byte += 8) {
+            uint64_t value = random();
+            memcpy(unon.data() + byte, &value, sizeof(value));
+        }
+    writeSource(1);
+
+    string error;
+    auto begin = chrono::steady_clock::now();
+    if (!SystemConfig::compile(source, output, error)) {
+        cerr << error << endl;
+        return 1;
+    }
+    double compileMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+
+    begin = chrono::steady_clock::now();
+    SystemConfig config;
+    if (!config.load(output)) {
+        cerr << config.getError() << endl;
+        return 1;
+    }
+    double loadMs = chrono::duration<double, milli>(chrono::steady_clock::now() - begin).count();
+    auto snapshot = config.get();
+
+    size_t lookups = 0;
+    size_t found = 0;
+    begin = chrono::steady_clock::now();
+    for (size_t round = 0; round < 1000000 / max<size_t>(count, 1) + 1; ++round)
+        for (const auto& unon : unons) {
+            found += snapshot->findUNON(unon) != ConfigSnapshot::npos;
+            ++lookups;
+        }
+    double lookupNs = chrono::duration<double, nano>(chrono::steady_clock::now() - begin).count() / lookups;
+
+    mutex lock;
+    condition_variable reloaded;
+    uint64_t generation = 1;
+    chrono::steady_clock::time_point swapped;
+    config.watch([&](const shared_ptr<const ConfigSnapshot>& next) {
+        lock_guard<mutex> guard(lock);
+        generation = next->getGeneration();
+        swapped = chrono::steady_clock::now();
+        reloaded.notify_all();
+    });
+
+    vector<double> latencies;
+    for (uint64_t next = 2; next < 12; ++next) {
+        writeSource(next);
+        if (!SystemConfig::compile(source, output, error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        auto replaced = chrono::steady_clock::now();
+        unique_lock<mutex> guard(lock);
+        if (!reloaded.wait_for(guard, chrono::seconds(2), [&] { return generation == next; })) {
+            cerr << "reload of generation " << next << " not observed: " << config.getError() << endl;
+            return 1;
+        }
+        latencies.push_back(chrono::duration<double, micro>(swapped - replaced).count());
+    }
+    config.unwatch();
+    sort(latencies.begin(), latencies.end());
+
+    struct stat status;
+    stat(output.c_str(), &status);
+    cout << count << " instances, " << status.st_size << " byte image, " << found / (lookups / max<size_t>(count, 1)) << " found" << endl;
+    cout << fixed << setprecision(2) << "compile " << compileMs << " ms, map+validate " << loadMs << " ms, findUNON "
+         << lookupNs << " ns, reload latency median " << latencies[latencies.size() / 2] << " us max " << latencies.back()
+         << " us, old snapshot generation " << snapshot->getGeneration() << " still readable: " << snapshot->getExecutable(0) << endl;
+
+    unlink(source.c_str());
+    unlink(output.c_str());
+    rmdir(directory);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 4 && strcmp(argv[1], "--compile-config") == 0) {
+        string error;
+        if (!SystemConfig::compile(argv[2], argv[3], error)) {
+            cerr << error << endl;
+            return 1;
+        }
+        return 0;
+    }
+    if (argc >= 3 && strcmp(argv[1], "--bench-spawn") == 0)
+        return benchSpawn(argv[2], argc > 3 ? stoul(argv[3]) : 200, argc > 4 ? stoul(argv[4]) : 0);
+    if (argc >= 3 && strcmp(argv[1], "--bench-monitor") == 0)
+        return benchMonitor(argv[2], argc > 3 ? stoul(argv[3]) : 1000, argc > 4 ? stoul(argv[4]) : 0);
+    if (argc >= 3 && strcmp(argv[1], "--bench-sched") == 0)
+        return benchSched(argv[2], argc > 3 ? stoul(argv[3]) : 8, argc > 4 ? stoul(argv[4]) : 2, argc > 5 ? stoul(argv[5]) : 5);
+    if (argc >= 2 && strcmp(argv[1], "--bench-timers") == 0)
+        return benchTimers(argc > 2 ? stoul(argv[2]) : 5);
+    if (argc >= 2 && strcmp(argv[1], "--bench-bus") == 0)
+        return benchBus(argc > 2 ? stoul(argv[2]) : 2000000);
+    if (argc >= 2 && strcmp(argv[1], "--bench-telemetry") == 0)
+        return benchTelemetry(argc > 2 ? stoul(argv[2]) : 5000, argc > 3 ? stoul(argv[3]) : 10, argc > 4 ? stoul(argv[4]) : 1000);
+    if (argc >= 2 && strcmp(argv[1], "--bench-config") == 0)
+        return benchConfig(argc > 2 ? stoul(argv[2]) : 10000);
 
     return 0;
 }
@@ -0,0 +1,318 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+namespace {
+
+constexpr double hotUsage = 0.5;
+
+std::string readLine(const std::string& path)
+{
+    std::ifstream file(path);
+    std::string line;
+    std::getline(file, line);
+    return line;
+}
+
+template <typename Function>
+bool forEachTask(pid_t pid, Function function)
+{
+    std::string path = "/proc/" + std::to_string(pid) + "/task";
+    DIR* tasks = opendir(path.c_str());
+    if (!tasks)
+        return function(pid);
+
+    bool success = true;
+    while (dirent* task = readdir(tasks))
+        if (task->d_name[0] != '.')
+            success = function(static_cast<pid_t>(atoi(task->d_name))) && success;
+    closedir(tasks);
+    return success;
+}
+
+bool readTicks(pid_t pid, uint64_t& ticks)
+{
+    char path[32];
+    char buffer[1024];
+    snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    ssize_t size = read(fd, buffer, sizeof(buffer) - 1);
+    close(fd);
+    if (size <= 0)
+        return false;
+    buffer[size] = '\0';
+
+    const char* field = strrchr(buffer, ')');
+    for (int i = 0; field && i < 12; ++i)
+        field = strchr(field + 1, ' ');
+    if (!field)
+        return false;
+    char* end;
+    uint64_t user = strtoull(field + 1, &end, 10);
+    uint64_t system = strtoull(end, nullptr, 10);
+    ticks = user + system;
+    return true;
+}
+
+}
+
+std::vector<int> CpuTopology::parseList(const std::string& list)
+{
+    std::vector<int> values;
+    const char* p = list.c_str();
+    while (*p) {
+        char* end;
+        long first = strtol(p, &end, 10);
+        if (end == p)
+            break;
+        long last = first;
+        if (*end == '-')
+            last = strtol(end + 1, &end, 10);
+        for (long value = first; value <= last; ++value)
+            values.push_back(static_cast<int>(value));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return values;
+}
+
+CpuTopology CpuTopology::read()
+{
+    CpuTopology topology;
+    topology.cpus = parseList(readLine("/sys/devices/system/cpu/online"));
+    if (topology.cpus.empty())
+        for (long cpu = 0; cpu < sysconf(_SC_NPROCESSORS_ONLN); ++cpu)
+            topology.cpus.push_back(static_cast<int>(cpu));
+
+    std::map<int, int> cpuNode;
+    if (DIR* nodes = opendir("/sys/devices/system/node")) {
+        while (dirent* node = readdir(nodes)) {
+            if (strncmp(node->d_name, "node", 4) != 0 || !isdigit(static_cast<unsigned char>(node->d_name[4])))
+                continue;
+            std::string path = std::string("/sys/devices/system/node/") + node->d_name + "/cpulist";
+            for (int cpu : parseList(readLine(path)))
+                cpuNode[cpu] = atoi(node->d_name + 4);
+        }
+        closedir(nodes);
+    }
+
+    std::map<long, int> coreIndex;
+    std::map<int, int> nodeIndex;
+    for (int cpu : topology.cpus) {
+        std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+        long key = atol(readLine(base + "physical_package_id").c_str()) << 20 | atol(readLine(base + "core_id").c_str());
+        auto core = coreIndex.emplace(key, static_cast<int>(coreIndex.size())).first;
+        auto node = nodeIndex.emplace(cpuNode.count(cpu) ? cpuNode[cpu] : 0, static_cast<int>(nodeIndex.size())).first;
+        topology.cores.push_back(core->second);
+        topology.nodes.push_back(node->second);
+        if (topology.coreNodes.size() <= static_cast<size_t>(core->second))
+            topology.coreNodes.push_back(node->second);
+    }
+    topology.coreCount = coreIndex.size();
+    topology.nodeCount = nodeIndex.size();
+    return topology;
+}
+
+cpu_set_t CpuTopology::coreSet(int core) const
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (size_t i = 0; i < cpus.size(); ++i)
+        if (cores[i] == core)
+            CPU_SET(cpus[i], &set);
+    return set;
+}
+
+cpu_set_t CpuTopology::allSet() const
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus)
+        CPU_SET(cpu, &set);
+    return set;
+}
+
+int priorityNice(Instance::ProcessPriority priority)
+{
+    switch (priority) {
+    case Instance::ProcessPriority::Low:
+        return 10;
+    case Instance::ProcessPriority::High:
+        return -5;
+    default:
+        return 0;
+    }
+}
+
+int priorityWeight(Instance::ProcessPriority priority)
+{
+    switch (priority) {
+    case Instance::ProcessPriority::Low:
+        return 25;
+    case Instance::ProcessPriority::High:
+        return 400;
+    default:
+        return 100;
+    }
+}
+
+bool applyNice(pid_t pid, int nice)
+{
+    return forEachTask(pid, [nice](pid_t task) { return setpriority(PRIO_PROCESS, task, nice) == 0; });
+}
+
+Scheduler::Scheduler(CpuTopology topology)
+    : m_topology(std::move(topology)), m_packCore(static_cast<int>(m_topology.coreCount) - 1),
+      m_lastRebalance(std::chrono::steady_clock::now())
+{}
+
+const CpuTopology& Scheduler::getTopology()
+{
+    return m_topology;
+}
+
+void Scheduler::place(pid_t pid, Instance::ProcessPriority priority)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry& entry = m_entries[pid];
+    entry = Entry{};
+    entry.priority = priority;
+    readTicks(pid, entry.ticks);
+
+    if (!isHot(entry)) {
+        assign(pid, entry, m_packCore);
+        return;
+    }
+
+    std::vector<double> coreLoad(m_topology.coreCount);
+    std::vector<double> nodeLoad(m_topology.nodeCount);
+    for (auto& [other, placed] : m_entries)
+        if (other != pid && placed.core >= 0 && isHot(placed)) {
+            double load = placed.measured ? placed.usage : 1.0;
+            coreLoad[placed.core] += load;
+            nodeLoad[m_topology.coreNodes[placed.core]] += load;
+        }
+    assign(pid, entry, leastLoadedCore(coreLoad, nodeLoad));
+}
+
+void Scheduler::setPriority(pid_t pid, Instance::ProcessPriority priority)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entries.find(pid);
+    if (entry != m_entries.end())
+        entry->second.priority = priority;
+}
+
+void Scheduler::forget(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.erase(pid);
+}
+
+void Scheduler::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    cpu_set_t set = m_topology.allSet();
+    if (m_topology.coreCount > 1)
+        for (auto& entry : m_entries)
+            forEachTask(entry.first, [&set](pid_t task) { return sched_setaffinity(task, sizeof(set), &set) == 0; });
+    m_entries.clear();
+}
+
+void Scheduler::rebalance()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_lastRebalance).count();
+    m_lastRebalance = now;
+    static const double ticksPerSecond = static_cast<double>(sysconf(_SC_CLK_TCK));
+
+    std::vector<std::pair<pid_t, Entry*>> hot;
+    for (auto entry = m_entries.begin(); entry != m_entries.end();) {
+        uint64_t ticks;
+        if (!readTicks(entry->first, ticks)) {
+            entry = m_entries.erase(entry);
+            continue;
+        }
+        if (elapsed > 0) {
+            entry->second.usage = (ticks - entry->second.ticks) / ticksPerSecond / elapsed;
+            entry->second.measured = true;
+        }
+        entry->second.ticks = ticks;
+        if (isHot(entry->second))
+            hot.emplace_back(entry->first, &entry->second);
+        else
+            assign(entry->first, entry->second, m_packCore);
+        ++entry;
+    }
+
+    std::sort(hot.begin(), hot.end(), [](const auto& a, const auto& b) {
+        if (a.second->priority != b.second->priority)
+            return a.second->priority > b.second->priority;
+        return a.second->usage > b.second->usage;
+    });
+
+    std::vector<double> coreLoad(m_topology.coreCount);
+    std::vector<double> nodeLoad(m_topology.nodeCount);
+    for (auto& [pid, entry] : hot) {
+        int core = leastLoadedCore(coreLoad, nodeLoad);
+        double load = std::max(entry->usage, entry->priority == Instance::ProcessPriority::High ? 1.0 : hotUsage);
+        coreLoad[core] += load;
+        nodeLoad[m_topology.coreNodes[core]] += load;
+        assign(pid, *entry, core);
+    }
+}
+
+double Scheduler::getUsage(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entries.find(pid);
+    return entry == m_entries.end() ? 0 : entry->second.usage;
+}
+
+int Scheduler::getCore(pid_t pid)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_entries.find(pid);
+    return entry == m_entries.end() ? -1 : entry->second.core;
+}
+
+bool Scheduler::isHot(const Entry& entry) const
+{
+    if (entry.priority == Instance::ProcessPriority::High)
+        return true;
+    return entry.measured ? entry.usage >= hotUsage : entry.priority == Instance::ProcessPriority::Medium;
+}
+
+int Scheduler::leastLoadedCore(const std::vector<double>& coreLoad, const std::vector<double>& nodeLoad) const
+{
+    int best = -1;
+    for (int core = 0; core < static_cast<int>(m_topology.coreCount); ++core) {
+        if (core == m_packCore && m_topology.coreCount > 1)
+            continue;
+        if (best < 0 || coreLoad[core] < coreLoad[best]
+            || (coreLoad[core] == coreLoad[best] && nodeLoad[m_topology.coreNodes[core]] < nodeLoad[m_topology.coreNodes[best]]))
+            best = core;
+    }
+    return std::max(best, 0);
+}
+
+void Scheduler::assign(pid_t pid, Entry& entry, int core)
+{
+    if (entry.core == core)
+        return;
+    entry.core = core;
+    if (m_topology.coreCount < 2)
+        return;
+
+    cpu_set_t set = m_topology.coreSet(core);
+    forEachTask(pid, [&set](pid_t task) { return sched_setaffinity(task, sizeof(set), &set) == 0; });
+}
@@ -0,0 +1,61 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+#include "instance.h"
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <sched.h>
+
+struct CpuTopology
+{
+    std::vector<int> cpus;
+    std::vector<int> cores;
+    std::vector<int> nodes;
+    std::vector<int> coreNodes;
+    size_t coreCount = 0;
+    size_t nodeCount = 0;
+
+    static CpuTopology read();
+    static std::vector<int> parseList(const std::string& list);
+    cpu_set_t coreSet(int core) const;
+    cpu_set_t allSet() const;
+};
+
+int priorityNice(Instance::ProcessPriority priority);
+int priorityWeight(Instance::ProcessPriority priority);
+bool applyNice(pid_t pid, int nice);
+
+class Scheduler
+{
+public:
+    explicit Scheduler(CpuTopology topology = CpuTopology::read());
+    const CpuTopology& getTopology();
+    void place(pid_t pid, Instance::ProcessPriority priority);
+    void setPriority(pid_t pid, Instance::ProcessPriority priority);
+    void forget(pid_t pid);
+    void reset();
+    void rebalance();
+    double getUsage(pid_t pid);
+    int getCore(pid_t pid);
+private:
+    struct Entry
+    {
+        Instance::ProcessPriority priority;
+        uint64_t ticks = 0;
+        double usage = 0;
+        int core = -1;
+        bool measured = false;
+    };
+    bool isHot(const Entry& entry) const;
+    int leastLoadedCore(const std::vector<double>& coreLoad, const std::vector<double>& nodeLoad) const;
+    void assign(pid_t pid, Entry& entry, int core);
+    CpuTopology m_topology;
+    int m_packCore;
+    std::unordered_map<pid_t, Entry> m_entries;
+    std::chrono::steady_clock::time_point m_lastRebalance;
+    std::mutex m_mutex;
+};
+
+#endif // SCHEDULER_H
@@ -3,19 +3,35 @@ CONFIG += console c++17
 CONFIG -= app_bundle
 CONFIG -= qt
 
+INCLUDEPATH += ../Simple_NDDI
+
 SOURCES += \
+        cgroup.cpp \
         communicationmanager.cpp \
         gate.cpp \
         instance.cpp \
         instancebuilder.cpp \
         instancemanager.cpp \
+        instanceregistry.cpp \
         main.cpp \
-        systemconfig.cpp
+        scheduler.cpp \
+        spawner.cpp \
+        systemconfig.cpp \
+        telemetry.cpp \
+        timerwheel.cpp \
+        zygote.cpp
 
 HEADERS += \
+    cgroup.h \
     communicationmanager.h \
     gate.h \
     instance.h \
     instancebuilder.h \
     instancemanager.h \
-    systemconfig.h
+    instanceregistry.h \
+    scheduler.h \
+    spawner.h \
+    systemconfig.h \
+    telemetry.h \
+    timerwheel.h \
+    zygote.h
@@ -0,0 +1,94 @@
+#include "spawner.h"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+extern char** environ;
+
+namespace {
+
+struct ExecArgs
+{
+    std::vector<char*> argv;
+    std::vector<char*> envp;
+};
+
+ExecArgs makeExecArgs(const std::string& path, const std::vector<std::string>& args, const std::vector<std::string>& env)
+{
+    ExecArgs exec;
+    exec.argv.push_back(const_cast<char*>(path.c_str()));
+    for (auto& arg : args)
+        exec.argv.push_back(const_cast<char*>(arg.c_str()));
+    exec.argv.push_back(nullptr);
+
+    for (char** var = environ; *var; ++var) {
+        bool overridden = false;
+        for (auto& set : env) {
+            size_t nameLength = std::min(set.find('='), set.size());
+            if (strncmp(*var, set.c_str(), nameLength) == 0 && (*var)[nameLength] == '=')
+                overridden = true;
+        }
+        if (!overridden)
+            exec.envp.push_back(*var);
+    }
+    for (auto& set : env)
+        if (set.find('=') != std::string::npos)
+            exec.envp.push_back(const_cast<char*>(set.c_str()));
+    exec.envp.push_back(nullptr);
+    return exec;
+}
+
+}
+
+pid_t spawnProcess(const std::string& path, const std::vector<std::string>& args,
+                   const std::vector<int>& inheritFds, const std::vector<std::string>& env)
+{
+    ExecArgs exec = makeExecArgs(path, args, env);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    for (int fd : inheritFds)
+        posix_spawn_file_actions_adddup2(&actions, fd, fd);
+
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK);
+
+    pid_t pid;
+    int error = posix_spawn(&pid, path.c_str(), &actions, &attr, exec.argv.data(), exec.envp.data());
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (error) {
+        errno = error;
+        return -1;
+    }
+    return pid;
+}
+
+pid_t forkExecProcess(const std::string& path, const std::vector<std::string>& args,
+                      const std::vector<int>& inheritFds, const std::vector<std::string>& env)
+{
+    ExecArgs exec = makeExecArgs(path, args, env);
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        for (int fd : inheritFds)
+            fcntl(fd, F_SETFD, 0);
+        execve(exec.argv[0], exec.argv.data(), exec.envp.data());
+        _exit(127);
+    }
+    return pid;
+}
+
+int openPidfd(pid_t pid)
+{
+    return static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+}
@@ -0,0 +1,13 @@
+#ifndef SPAWNER_H
+#define SPAWNER_H
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+pid_t spawnProcess(const std::string& path, const std::vector<std::string>& args,
+                   const std::vector<int>& inheritFds, const std::vector<std::string>& env);
+pid_t forkExecProcess(const std::string& path, const std::vector<std::string>& args,
+                      const std::vector<int>& inheritFds, const std::vector<std::string>& env);
+int openPidfd(pid_t pid);
+
+#endif // SPAWNER_H
@@ -1,3 +1,553 @@
 #include "systemconfig.h"
+#include "instancebuilder.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#ifdef __SSE4_2__
+#include <nmmintrin.h>
+#endif
 
-SystemConfig::SystemConfig() {}
+namespace {
+
+const char configMagic[8] = {'G', 'A', 'T', 'E', 'C', 'F', 'G', '\0'};
+constexpr uint32_t configVersion = 1;
+
+static_assert(sizeof(ConfigHeader) == 64, "ConfigHeader layout");
+static_assert(sizeof(ConfigRecord) == 40, "ConfigRecord layout");
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t size)
+{
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+    crc = ~crc;
+#ifdef __SSE4_2__
+    for (; size >= 8; p += 8, size -= 8) {
+        uint64_t word;
+        memcpy(&word, p, sizeof(word));
+        crc = static_cast<uint32_t>(_mm_crc32_u64(crc, word));
+    }
+    while (size--)
+        crc = _mm_crc32_u8(crc, *p++);
+#else
+    static const auto table = [] {
+        std::array<uint32_t, 256> table{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t value = i;
+            for (int bit = 0; bit < 8; ++bit)
+                value = value & 1 ? (value >> 1) ^ 0x82F63B78 : value >> 1;
+            table[i] = value;
+        }
+        return table;
+    }();
+    while (size--)
+        crc = table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+#endif
+    return ~crc;
+}
+
+uint32_t imageChecksum(const char* image, size_t size)
+{
+    ConfigHeader header;
+    memcpy(&header, image, sizeof(header));
+    header.checksum = 0;
+    return crc32c(crc32c(0, &header, sizeof(header)), image + sizeof(header), size - sizeof(header));
+}
+
+size_t align(size_t offset, size_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+std::string trim(const std::string& text)
+{
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == std::string::npos)
+        return {};
+    return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+}
+
+bool splitArgs(const std::string& text, std::vector<std::string>& args)
+{
+    std::string current;
+    bool quoted = false;
+    bool pending = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        if (c == '"') {
+            quoted = !quoted;
+            pending = true;
+        } else if (c == '\\' && i + 1 < text.size()) {
+            current += text[++i];
+            pending = true;
+        } else if (!quoted && (c == ' ' || c == '\t')) {
+            if (pending)
+                args.push_back(std::move(current));
+            current.clear();
+            pending = false;
+        } else {
+            current += c;
+            pending = true;
+        }
+    }
+    if (pending)
+        args.push_back(std::move(current));
+    return !quoted;
+}
+
+bool parseUNON(const std::string& text, std::array<uint8_t, 16>& unon)
+{
+    std::string digits;
+    for (char c : text)
+        if (c != '-')
+            digits += c;
+    if (digits.size() != 32 || digits.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+        return false;
+    for (size_t i = 0; i < 16; ++i)
+        unon[i] = static_cast<uint8_t>(std::stoul(digits.substr(i * 2, 2), nullptr, 16));
+    return true;
+}
+
+bool parsePriority(const std::string& text, uint8_t& priority)
+{
+    static const char* const names[] = {"low", "medium", "high"};
+    for (uint8_t i = 0; i < 3; ++i)
+        if (text == names[i]) {
+            priority = i;
+            return true;
+        }
+    return false;
+}
+
+}
+
+std::shared_ptr<const ConfigSnapshot> ConfigSnapshot::map(const std::string& path, std::string& error)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    if (fd < 0 || fstat(fd, &status) < 0) {
+        error = path + ": " + strerror(errno);
+        if (fd >= 0)
+            close(fd);
+        return nullptr;
+    }
+    if (static_cast<size_t>(status.st_size) < sizeof(ConfigHeader)) {
+        close(fd);
+        error = path + ": too small for a config header";
+        return nullptr;
+    }
+
+    void* mapping = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        error = path + ": " + strerror(errno);
+        return nullptr;
+    }
+
+    std::shared_ptr<const ConfigSnapshot> snapshot(new ConfigSnapshot(static_cast<const char*>(mapping), status.st_size));
+    if (!snapshot->validate(error)) {
+        error = path + ": " + error;
+        return nullptr;
+    }
+    return snapshot;
+}
+
+ConfigSnapshot::ConfigSnapshot(const char* mapping, size_t size)
+    : m_mapping(mapping), m_size(size), m_header(reinterpret_cast<const ConfigHeader*>(mapping)),
+      m_records(nullptr), m_args(nullptr)
+{}
+
+ConfigSnapshot::~ConfigSnapshot()
+{
+    munmap(const_cast<char*>(m_mapping), m_size);
+}
+
+uint64_t ConfigSnapshot::getGeneration() const
+{
+    return m_header->generation;
+}
+
+uint32_t ConfigSnapshot::size() const
+{
+    return m_header->instanceCount;
+}
+
+uint32_t ConfigSnapshot::findUNON(const std::array<uint8_t, 16>& unon) const
+{
+    const ConfigRecord* end = m_records + m_header->instanceCount;
+    const ConfigRecord* found = std::lower_bound(m_records, end, unon, [](const ConfigRecord& record, const std::array<uint8_t, 16>& key) {
+        return memcmp(record.UNON, key.data(), key.size()) < 0;
+    });
+    if (found == end || memcmp(found->UNON, unon.data(), unon.size()) != 0)
+        return npos;
+    return static_cast<uint32_t>(found - m_records);
+}
+
+std::array<uint8_t, 16> ConfigSnapshot::getUNON(uint32_t index) const
+{
+    std::array<uint8_t, 16> unon;
+    memcpy(unon.data(), m_records[index].UNON, unon.size());
+    return unon;
+}
+
+const char* ConfigSnapshot::getExecutable(uint32_t index) const
+{
+    return string(m_records[index].executable);
+}
+
+uint32_t ConfigSnapshot::getArgCount(uint32_t index) const
+{
+    return m_records[index].argCount;
+}
+
+const char* ConfigSnapshot::getArg(uint32_t index, uint32_t arg) const
+{
+    return string(m_args[m_records[index].firstArg + arg]);
+}
+
+Instance::ProcessPriority ConfigSnapshot::getPriority(uint32_t index) const
+{
+    return static_cast<Instance::ProcessPriority>(m_records[index].priority);
+}
+
+__UINTPTR_TYPE__ ConfigSnapshot::getSharedAddress(uint32_t index) const
+{
+    return m_records[index].sharedAddress;
+}
+
+__SIZE_TYPE__ ConfigSnapshot::getSharedSize(uint32_t index) const
+{
+    return m_records[index].sharedSize;
+}
+
+std::unique_ptr<Instance> ConfigSnapshot::build(uint32_t index) const
+{
+    const ConfigRecord& record = m_records[index];
+    std::vector<std::string> args;
+    args.reserve(record.argCount);
+    for (uint32_t arg = 0; arg < record.argCount; ++arg)
+        args.emplace_back(getArg(index, arg));
+
+    InstanceBuilder builder;
+    builder.executable(getExecutable(index)).args(args).UNON(getUNON(index)).priority(getPriority(index));
+    if (record.sharedAddress)
+        builder.sharedComponent(record.sharedAddress, record.sharedSize);
+    return builder.build();
+}
+
+bool ConfigSnapshot::validate(std::string& error) const
+{
+    const ConfigHeader& header = *m_header;
+    if (memcmp(header.magic, configMagic, sizeof(configMagic)) != 0) {
+        error = "not a compiled GATE config";
+        return false;
+    }
+    if (header.version != configVersion || header.headerSize != sizeof(ConfigHeader)) {
+        error = "unsupported config version " + std::to_string(header.version);
+        return false;
+    }
+    if (header.fileSize != m_size || header.checksum != imageChecksum(m_mapping, m_size)) {
+        error = "checksum mismatch";
+        return false;
+    }
+    if (header.instanceOffset % alignof(ConfigRecord) || header.argOffset % alignof(uint32_t)
+        || header.instanceOffset + uint64_t(header.instanceCount) * sizeof(ConfigRecord) > m_size
+        || header.argOffset + uint64_t(header.argCount) * sizeof(uint32_t) > m_size
+        || header.stringSize == 0 || header.stringOffset + uint64_t(header.stringSize) > m_size
+        || m_mapping[header.stringOffset + header.stringSize - 1] != '\0') {
+        error = "table out of bounds";
+        return false;
+    }
+
+    auto* self = const_cast<ConfigSnapshot*>(this);
+    self->m_records = reinterpret_cast<const ConfigRecord*>(m_mapping + header.instanceOffset);
+    self->m_args = reinterpret_cast<const uint32_t*>(m_mapping + header.argOffset);
+    for (uint32_t i = 0; i < header.instanceCount; ++i) {
+        const ConfigRecord& record = m_records[i];
+        bool valid = record.executable < header.stringSize && record.priority <= 2
+            && uint64_t(record.firstArg) + record.argCount <= header.argCount;
+        for (uint32_t arg = 0; valid && arg < record.argCount; ++arg)
+            valid = m_args[record.firstArg + arg] < header.stringSize;
+        if (!valid) {
+            error = "instance " + std::to_string(i) + " out of bounds";
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* ConfigSnapshot::string(uint32_t offset) const
+{
+    return m_mapping + m_header->stringOffset + offset;
+}
+
+SystemConfig::SystemConfig()
+    : m_inotifyFd(-1), m_wakeFd(-1)
+{}
+
+SystemConfig::~SystemConfig()
+{
+    unwatch();
+}
+
+bool SystemConfig::load(const std::string& path)
+{
+    m_path = path;
+    return reload();
+}
+
+bool SystemConfig::reload()
+{
+    std::string error;
+    std::shared_ptr<const ConfigSnapshot> snapshot = ConfigSnapshot::map(m_path, error);
+    if (!snapshot) {
+        setError(error);
+        return false;
+    }
+
+    std::atomic_store(&m_snapshot, snapshot);
+    if (m_handler)
+        m_handler(snapshot);
+    return true;
+}
+
+std::shared_ptr<const ConfigSnapshot> SystemConfig::get() const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+bool SystemConfig::watch(ReloadHandler handler)
+{
+    if (m_thread.joinable() || m_path.empty())
+        return false;
+
+    size_t separator = m_path.rfind('/');
+    std::string directory = separator == std::string::npos ? "." : m_path.substr(0, std::max<size_t>(separator, 1));
+    std::string name = separator == std::string::npos ? m_path : m_path.substr(separator + 1);
+
+    m_inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (m_inotifyFd < 0 || m_wakeFd < 0 || inotify_add_watch(m_inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        setError(directory + ": " + strerror(errno));
+        unwatch();
+        return false;
+    }
+
+    m_handler = std::move(handler);
+    m_thread = std::thread(&SystemConfig::watchLoop, this, name);
+    return true;
+}
+
+void SystemConfig::unwatch()
+{
+    if (m_thread.joinable()) {
+        eventfd_write(m_wakeFd, 1);
+        m_thread.join();
+    }
+    if (m_inotifyFd >= 0)
+        close(m_inotifyFd);
+    if (m_wakeFd >= 0)
+        close(m_wakeFd);
+    m_inotifyFd = -1;
+    m_wakeFd = -1;
+}
+
+std::string SystemConfig::getError()
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    return m_error;
+}
+
+bool SystemConfig::compile(const std::string& source, const std::string& output, std::string& error)
+{
+    struct Entry
+    {
+        std::array<uint8_t, 16> UNON{};
+        std::string executable;
+        std::vector<std::string> args;
+        uint8_t priority = static_cast<uint8_t>(Instance::ProcessPriority::Medium);
+        uint64_t sharedAddress = 0;
+        uint32_t sharedSize = 0;
+        size_t line = 0;
+    };
+
+    std::ifstream in(source);
+    if (!in) {
+        error = source + ": " + strerror(errno);
+        return false;
+    }
+
+    std::vector<Entry> entries;
+    uint64_t generation = 0;
+    std::string text;
+    for (size_t line = 1; std::getline(in, text); ++line) {
+        text = trim(text);
+        if (text.empty() || text[0] == '#')
+            continue;
+        auto fail = [&](const std::string& message) {
+            error = source + ":" + std::to_string(line) + ": " + message;
+            return false;
+        };
+        if (text == "[instance]") {
+            entries.emplace_back();
+            entries.back().line = line;
+            continue;
+        }
+
+        size_t equals = text.find('=');
+        if (equals == std::string::npos)
+            return fail("expected key = value");
+        std::string key = trim(text.substr(0, equals));
+        std::string value = trim(text.substr(equals + 1));
+        try {
+            if (key == "generation" && entries.empty()) {
+                generation = std::stoull(value);
+                continue;
+            }
+            if (entries.empty())
+                return fail("'" + key + "' outside an [instance] section");
+            Entry& entry = entries.back();
+            if (key == "unon") {
+                if (!parseUNON(value, entry.UNON))
+                    return fail("UNON must be 32 hex digits");
+            } else if (key == "executable") {
+                entry.executable = value;
+            } else if (key == "args") {
+                entry.args.clear();
+                if (!splitArgs(value, entry.args) || entry.args.size() > UINT16_MAX)
+                    return fail("bad argument list");
+            } else if (key == "priority") {
+                if (!parsePriority(value, entry.priority))
+                    return fail("priority must be low, medium or high");
+            } else if (key == "shared") {
+                std::istringstream fields(value);
+                std::string address;
+                std::string size = "4096";
+                fields >> address >> size;
+                entry.sharedAddress = std::stoull(address, nullptr, 0);
+                entry.sharedSize = static_cast<uint32_t>(std::stoul(size, nullptr, 0));
+            } else {
+                return fail("unknown key '" + key + "'");
+            }
+        } catch (const std::exception&) {
+            return fail("bad number '" + value + "'");
+        }
+    }
+
+    std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.UNON < b.UNON; });
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].executable.empty()) {
+            error = source + ":" + std::to_string(entries[i].line) + ": instance without executable";
+            return false;
+        }
+        if (i > 0 && entries[i].UNON == entries[i - 1].UNON && entries[i].UNON != std::array<uint8_t, 16>{}) {
+            error = source + ":" + std::to_string(entries[i].line) + ": duplicate UNON";
+            return false;
+        }
+    }
+
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> interned;
+    auto intern = [&](const std::string& value) {
+        auto found = interned.emplace(value, static_cast<uint32_t>(strings.size()));
+        if (found.second)
+            strings.append(value.c_str(), value.size() + 1);
+        return found.first->second;
+    };
+
+    std::vector<ConfigRecord> records;
+    std::vector<uint32_t> args;
+    for (const Entry& entry : entries) {
+        ConfigRecord record = {};
+        memcpy(record.UNON, entry.UNON.data(), sizeof(record.UNON));
+        record.sharedAddress = entry.sharedAddress;
+        record.sharedSize = entry.sharedSize;
+        record.executable = intern(entry.executable);
+        record.firstArg = static_cast<uint32_t>(args.size());
+        record.argCount = static_cast<uint16_t>(entry.args.size());
+        record.priority = entry.priority;
+        for (const auto& arg : entry.args)
+            args.push_back(intern(arg));
+        records.push_back(record);
+    }
+    if (strings.empty())
+        strings.push_back('\0');
+
+    ConfigHeader header = {};
+    memcpy(header.magic, configMagic, sizeof(configMagic));
+    header.version = configVersion;
+    header.headerSize = sizeof(ConfigHeader);
+    header.generation = generation;
+    header.instanceCount = static_cast<uint32_t>(records.size());
+    header.instanceOffset = sizeof(ConfigHeader);
+    header.argCount = static_cast<uint32_t>(args.size());
+    header.argOffset = static_cast<uint32_t>(align(header.instanceOffset + records.size() * sizeof(ConfigRecord), 8));
+    header.stringOffset = static_cast<uint32_t>(align(header.argOffset + args.size() * sizeof(uint32_t), 8));
+    header.stringSize = static_cast<uint32_t>(strings.size());
+    header.fileSize = header.stringOffset + strings.size();
+
+    std::string image(header.fileSize, '\0');
+    memcpy(&image[header.instanceOffset], records.data(), records.size() * sizeof(ConfigRecord));
+    memcpy(&image[header.argOffset], args.data(), args.size() * sizeof(uint32_t));
+    memcpy(&image[header.stringOffset], strings.data(), strings.size());
+    memcpy(&image[0], &header, sizeof(header));
+    header.checksum = imageChecksum(image.data(), image.size());
+    memcpy(&image[0], &header, sizeof(header));
+
+    std::string temporary = output + ".tmp." + std::to_string(getpid());
+    int fd = open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool written = fd >= 0;
+    for (size_t offset = 0; written && offset < image.size();) {
+        ssize_t size = write(fd, image.data() + offset, image.size() - offset);
+        written = size > 0 || (size < 0 && errno == EINTR);
+        offset += size > 0 ? size : 0;
+    }
+    written = written && fsync(fd) == 0;
+    if (fd >= 0)
+        close(fd);
+    if (!written || rename(temporary.c_str(), output.c_str()) < 0) {
+        error = output + ": " + strerror(errno);
+        unlink(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+void SystemConfig::watchLoop(std::string name)
+{
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {{m_inotifyFd, POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0 && errno != EINTR)
+            return;
+        if (fds[1].revents)
+            return;
+
+        bool changed = false;
+        ssize_t size;
+        while ((size = read(m_inotifyFd, buffer, sizeof(buffer))) > 0)
+            for (char* p = buffer; p < buffer + size;) {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                changed = changed || (event->len && name == event->name);
+                p += sizeof(inotify_event) + event->len;
+            }
+        if (changed)
+            reload();
+    }
+}
+
+void SystemConfig::setError(const std::string& error)
+{
+    std::lock_guard<std::mutex> lock(m_errorMutex);
+    m_error = error;
+}
@@ -1,10 +1,97 @@
 #ifndef SYSTEMCONFIG_H
 #define SYSTEMCONFIG_H
+#include "instance.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+struct ConfigHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint64_t generation;
+    uint32_t checksum;
+    uint32_t instanceCount;
+    uint32_t instanceOffset;
+    uint32_t argCount;
+    uint32_t argOffset;
+    uint32_t stringOffset;
+    uint32_t stringSize;
+    uint32_t reserved;
+};
+
+struct ConfigRecord
+{
+    uint8_t UNON[16];
+    uint64_t sharedAddress;
+    uint32_t sharedSize;
+    uint32_t executable;
+    uint32_t firstArg;
+    uint16_t argCount;
+    uint8_t priority;
+    uint8_t reserved;
+};
+
+class ConfigSnapshot
+{
+public:
+    static constexpr uint32_t npos = UINT32_MAX;
+    static std::shared_ptr<const ConfigSnapshot> map(const std::string& path, std::string& error);
+    ~ConfigSnapshot();
+    ConfigSnapshot(const ConfigSnapshot&) = delete;
+    ConfigSnapshot& operator=(const ConfigSnapshot&) = delete;
+    uint64_t getGeneration() const;
+    uint32_t size() const;
+    uint32_t findUNON(const std::array<uint8_t, 16>& unon) const;
+    std::array<uint8_t, 16> getUNON(uint32_t index) const;
+    const char* getExecutable(uint32_t index) const;
+    uint32_t getArgCount(uint32_t index) const;
+    const char* getArg(uint32_t index, uint32_t arg) const;
+    Instance::ProcessPriority getPriority(uint32_t index) const;
+    __UINTPTR_TYPE__ getSharedAddress(uint32_t index) const;
+    __SIZE_TYPE__ getSharedSize(uint32_t index) const;
+    std::unique_ptr<Instance> build(uint32_t index) const;
+private:
+    ConfigSnapshot(const char* mapping, size_t size);
+    bool validate(std::string& error) const;
+    const char* string(uint32_t offset) const;
+    const char* m_mapping;
+    size_t m_size;
+    const ConfigHeader* m_header;
+    const ConfigRecord* m_records;
+    const uint32_t* m_args;
+};
 
 class SystemConfig
 {
 public:
+    using ReloadHandler = std::function<void(const std::shared_ptr<const ConfigSnapshot>&)>;
     SystemConfig();
+    ~SystemConfig();
+    bool load(const std::string& path);
+    bool reload();
+    std::shared_ptr<const ConfigSnapshot> get() const;
+    bool watch(ReloadHandler handler = nullptr);
+    void unwatch();
+    std::string getError();
+    static bool compile(const std::string& source, const std::string& output, std::string& error);
+private:
+    void watchLoop(std::string name);
+    void setError(const std::string& error);
+    std::string m_path;
+    std::shared_ptr<const ConfigSnapshot> m_snapshot;
+    ReloadHandler m_handler;
+    int m_inotifyFd;
+    int m_wakeFd;
+    std::thread m_thread;
+    std::mutex m_errorMutex;
+    std::string m_error;
 };
 
 #endif // SYSTEMCONFIG_H
@@ -0,0 +1,434 @@
+#include "telemetry.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+const char telemetryMagic[4] = {'G', 'T', 'L', 'M'};
+constexpr uint32_t telemetryVersion = 1;
+constexpr size_t sampleFields = 8;
+
+const uint64_t ticksToNanoseconds = 1000000000ULL / static_cast<uint64_t>(sysconf(_SC_CLK_TCK));
+const uint64_t pageSize = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+
+int64_t nanoseconds(clockid_t clock)
+{
+    timespec now;
+    clock_gettime(clock, &now);
+    return static_cast<int64_t>(now.tv_sec) * 1000000000 + now.tv_nsec;
+}
+
+ssize_t readProc(int fd, char* buffer, size_t size)
+{
+    ssize_t length = pread(fd, buffer, size - 1, 0);
+    if (length > 0)
+        buffer[length] = '\0';
+    return length;
+}
+
+uint64_t parseNumber(const char*& p)
+{
+    while (*p == ' ')
+        ++p;
+    uint64_t value = 0;
+    while (*p >= '0' && *p <= '9')
+        value = value * 10 + static_cast<uint64_t>(*p++ - '0');
+    return value;
+}
+
+uint64_t parseField(const char* buffer, const char* name)
+{
+    const char* field = strstr(buffer, name);
+    if (!field)
+        return 0;
+    field += strlen(name);
+    return parseNumber(field);
+}
+
+bool parseStat(const char* buffer, TelemetrySample& sample)
+{
+    const char* p = strrchr(buffer, ')');
+    if (!p || p[1] != ' ' || !p[2])
+        return false;
+    p += 3;
+    uint64_t fields[25] = {};
+    for (int field = 4; field <= 24; ++field) {
+        while (*p == ' ')
+            ++p;
+        if (*p == '-')
+            ++p;
+        fields[field] = parseNumber(p);
+    }
+    sample.majorFaults = static_cast<uint32_t>(fields[12]);
+    sample.cpuTime = (fields[14] + fields[15]) * ticksToNanoseconds;
+    sample.threads = static_cast<uint32_t>(fields[20]);
+    sample.rss = fields[24] * pageSize;
+    return true;
+}
+
+void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+bool getVarint(const std::string& in, size_t& offset, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; offset < in.size() && shift < 64; shift += 7) {
+        uint8_t byte = static_cast<uint8_t>(in[offset++]);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+void sampleFieldsOf(const TelemetrySample& sample, uint64_t (&fields)[sampleFields])
+{
+    fields[0] = static_cast<uint64_t>(sample.time);
+    fields[1] = sample.cpuTime;
+    fields[2] = sample.rss;
+    fields[3] = sample.contextSwitches;
+    fields[4] = sample.readBytes;
+    fields[5] = sample.writeBytes;
+    fields[6] = sample.majorFaults;
+    fields[7] = sample.threads;
+}
+
+TelemetrySample sampleFrom(const uint64_t (&fields)[sampleFields])
+{
+    return {static_cast<int64_t>(fields[0]), fields[1], fields[2], fields[3], fields[4], fields[5],
+            static_cast<uint32_t>(fields[6]), static_cast<uint32_t>(fields[7])};
+}
+
+}
+
+double CollectorStats::cpuLoad() const
+{
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    return elapsed > 0 ? std::chrono::duration<double>(cpuTime).count() / elapsed : 0;
+}
+
+TelemetryCollector::TelemetryCollector(size_t capacity, unsigned sources, unsigned refreshPasses)
+    : m_capacity(std::max<size_t>(capacity, 1)), m_sources(sources), m_refreshPasses(std::max(refreshPasses, 1u)),
+      m_stopping(false)
+{}
+
+TelemetryCollector::~TelemetryCollector()
+{
+    stop();
+    for (auto& series : m_series)
+        closeFds(series);
+}
+
+bool TelemetryCollector::track(uint64_t id, pid_t pid, const std::array<uint8_t, 16>& unon)
+{
+    static const std::pair<Source, const char*> files[] = {{Stat, "stat"}, {Io, "io"}, {Schedstat, "schedstat"}};
+    std::array<int, 3> fds = {-1, -1, -1};
+    bool opened = false;
+    for (size_t i = 0; i < 3; ++i) {
+        if (!(m_sources & files[i].first))
+            continue;
+        char path[64];
+        snprintf(path, sizeof(path), "/proc/%d/%s", pid, files[i].second);
+        fds[i] = open(path, O_RDONLY | O_CLOEXEC);
+        opened = opened || fds[i] >= 0;
+    }
+    if (!opened)
+        return false;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(id);
+    if (found == m_index.end()) {
+        found = m_index.emplace(id, m_series.size()).first;
+        m_series.push_back(Series{id, pid, unon, {-1, -1, -1}, 0, 0, 0, 0, std::vector<TelemetrySample>(m_capacity)});
+    }
+    Series& series = m_series[found->second];
+    closeFds(series);
+    series.pid = pid;
+    series.UNON = unon;
+    series.fds = fds;
+    series.runTime = 0;
+    series.slices = 0;
+    return true;
+}
+
+void TelemetryCollector::untrack(uint64_t id)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(id);
+    if (found == m_index.end())
+        return;
+
+    size_t slot = found->second;
+    closeFds(m_series[slot]);
+    m_index.erase(found);
+    if (slot != m_series.size() - 1) {
+        m_series[slot] = std::move(m_series.back());
+        m_index[m_series[slot].id] = slot;
+    }
+    m_series.pop_back();
+}
+
+bool TelemetryCollector::start(std::chrono::milliseconds interval)
+{
+    if (m_thread.joinable())
+        return false;
+    m_stopping = false;
+    m_thread = std::thread(&TelemetryCollector::collectorLoop, this, interval);
+    return true;
+}
+
+void TelemetryCollector::stop()
+{
+    if (!m_thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(m_threadMutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    m_thread.join();
+}
+
+bool TelemetryCollector::isRunning()
+{
+    return m_thread.joinable();
+}
+
+void TelemetryCollector::collect()
+{
+    int64_t cpuBegin = nanoseconds(CLOCK_THREAD_CPUTIME_ID);
+    int64_t wallBegin = nanoseconds(CLOCK_MONOTONIC);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_series.size(); ++i) {
+        Series& series = m_series[i];
+        if (series.fds[0] >= 0 || series.fds[1] >= 0 || series.fds[2] >= 0)
+            m_stats.samples += sample(series, (m_stats.passes + i) % m_refreshPasses == 0);
+    }
+
+    ++m_stats.passes;
+    m_stats.cpuTime += std::chrono::nanoseconds(nanoseconds(CLOCK_THREAD_CPUTIME_ID) - cpuBegin);
+    m_stats.lastPass = std::chrono::nanoseconds(nanoseconds(CLOCK_MONOTONIC) - wallBegin);
+}
+
+bool TelemetryCollector::getSeries(uint64_t id, TelemetrySeries& series)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(id);
+    if (found == m_index.end())
+        return false;
+    copySeries(m_series[found->second], series);
+    return true;
+}
+
+bool TelemetryCollector::getLatest(uint64_t id, TelemetrySample& sample)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto found = m_index.find(id);
+    if (found == m_index.end() || m_series[found->second].count == 0)
+        return false;
+    const Series& series = m_series[found->second];
+    sample = series.ring[(series.next + m_capacity - 1) % m_capacity];
+    return true;
+}
+
+size_t TelemetryCollector::size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_series.size();
+}
+
+CollectorStats TelemetryCollector::getStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void TelemetryCollector::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats = {};
+}
+
+bool TelemetryCollector::exportBinary(int fd)
+{
+    std::string out(telemetryMagic, sizeof(telemetryMagic));
+    putVarint(out, telemetryVersion);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        putVarint(out, m_series.size());
+        for (const auto& series : m_series) {
+            putVarint(out, static_cast<uint32_t>(series.pid));
+            out.append(reinterpret_cast<const char*>(series.UNON.data()), series.UNON.size());
+            putVarint(out, series.count);
+
+            uint64_t previous[sampleFields] = {};
+            for (size_t i = 0; i < series.count; ++i) {
+                uint64_t fields[sampleFields];
+                sampleFieldsOf(series.ring[(series.next + m_capacity - series.count + i) % m_capacity], fields);
+                for (size_t field = 0; field < sampleFields; ++field) {
+                    int64_t delta = static_cast<int64_t>(fields[field] - previous[field]);
+                    putVarint(out, (static_cast<uint64_t>(delta) << 1) ^ static_cast<uint64_t>(delta >> 63));
+                    previous[field] = fields[field];
+                }
+            }
+        }
+    }
+
+    for (size_t written = 0; written < out.size();) {
+        ssize_t size = write(fd, out.data() + written, out.size() - written);
+        if (size < 0 && errno == EINTR)
+            continue;
+        if (size <= 0)
+            return false;
+        written += size;
+    }
+    return true;
+}
+
+bool TelemetryCollector::importBinary(const std::string& data, std::vector<TelemetrySeries>& series)
+{
+    if (data.compare(0, sizeof(telemetryMagic), telemetryMagic, sizeof(telemetryMagic)) != 0)
+        return false;
+
+    size_t offset = sizeof(telemetryMagic);
+    uint64_t version;
+    uint64_t count;
+    if (!getVarint(data, offset, version) || version != telemetryVersion || !getVarint(data, offset, count))
+        return false;
+
+    series.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        TelemetrySeries imported;
+        uint64_t pid;
+        uint64_t samples;
+        if (!getVarint(data, offset, pid) || offset + imported.UNON.size() > data.size())
+            return false;
+        imported.pid = static_cast<pid_t>(pid);
+        memcpy(imported.UNON.data(), data.data() + offset, imported.UNON.size());
+        offset += imported.UNON.size();
+        if (!getVarint(data, offset, samples))
+            return false;
+
+        uint64_t fields[sampleFields] = {};
+        for (uint64_t j = 0; j < samples; ++j) {
+            for (size_t field = 0; field < sampleFields; ++field) {
+                uint64_t zigzag;
+                if (!getVarint(data, offset, zigzag))
+                    return false;
+                fields[field] += (zigzag >> 1) ^ (~(zigzag & 1) + 1);
+            }
+            imported.samples.push_back(sampleFrom(fields));
+        }
+        series.push_back(std::move(imported));
+    }
+    return offset == data.size();
+}
+
+void TelemetryCollector::dumpText(std::ostream& out)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out << "# pid time_ms cpu_ms rss_kb switches read_bytes write_bytes major_faults threads\n";
+    char line[192];
+    for (const auto& series : m_series)
+        for (size_t i = 0; i < series.count; ++i) {
+            const TelemetrySample& sample = series.ring[(series.next + m_capacity - series.count + i) % m_capacity];
+            snprintf(line, sizeof(line), "%d %lld %.1f %llu %llu %llu %llu %u %u\n", series.pid,
+                     static_cast<long long>(sample.time / 1000000), sample.cpuTime / 1e6,
+                     static_cast<unsigned long long>(sample.rss >> 10), static_cast<unsigned long long>(sample.contextSwitches),
+                     static_cast<unsigned long long>(sample.readBytes), static_cast<unsigned long long>(sample.writeBytes),
+                     sample.majorFaults, sample.threads);
+            out << line;
+        }
+}
+
+bool TelemetryCollector::sample(Series& series, bool refresh)
+{
+    char buffer[1024];
+    TelemetrySample next = series.count ? series.ring[(series.next + m_capacity - 1) % m_capacity] : TelemetrySample{};
+    next.time = nanoseconds(CLOCK_REALTIME);
+
+    if (series.fds[2] >= 0) {
+        if (readProc(series.fds[2], buffer, sizeof(buffer)) <= 0) {
+            closeFds(series);
+            return false;
+        }
+        const char* p = buffer;
+        uint64_t runTime = parseNumber(p);
+        parseNumber(p);
+        uint64_t slices = parseNumber(p);
+        bool idle = series.count && next.threads == 1 && runTime == series.runTime && slices == series.slices;
+        series.runTime = runTime;
+        series.slices = slices;
+        next.contextSwitches = slices;
+        if (idle && !refresh) {
+            push(series, next);
+            return true;
+        }
+        next.cpuTime = runTime;
+    }
+
+    ++m_stats.fullReads;
+    if (series.fds[0] >= 0) {
+        if (readProc(series.fds[0], buffer, sizeof(buffer)) <= 0 || !parseStat(buffer, next)) {
+            closeFds(series);
+            return false;
+        }
+        if (series.fds[2] >= 0 && next.threads == 1)
+            next.cpuTime = series.runTime;
+    }
+    if (series.fds[1] >= 0 && readProc(series.fds[1], buffer, sizeof(buffer)) > 0) {
+        next.readBytes = parseField(buffer, "rchar:");
+        next.writeBytes = parseField(buffer, "wchar:");
+    }
+    push(series, next);
+    return true;
+}
+
+void TelemetryCollector::push(Series& series, const TelemetrySample& sample)
+{
+    series.ring[series.next] = sample;
+    series.next = (series.next + 1) % m_capacity;
+    series.count = std::min(series.count + 1, m_capacity);
+}
+
+void TelemetryCollector::closeFds(Series& series)
+{
+    for (int& fd : series.fds) {
+        if (fd >= 0)
+            close(fd);
+        fd = -1;
+    }
+}
+
+void TelemetryCollector::copySeries(const Series& from, TelemetrySeries& to)
+{
+    to.pid = from.pid;
+    to.UNON = from.UNON;
+    to.samples.resize(from.count);
+    for (size_t i = 0; i < from.count; ++i)
+        to.samples[i] = from.ring[(from.next + m_capacity - from.count + i) % m_capacity];
+}
+
+void TelemetryCollector::collectorLoop(std::chrono::milliseconds interval)
+{
+    std::unique_lock<std::mutex> lock(m_threadMutex);
+    auto deadline = std::chrono::steady_clock::now();
+    while (!m_stopping) {
+        lock.unlock();
+        collect();
+        lock.lock();
+        deadline += interval;
+        m_wake.wait_until(lock, deadline, [this] { return m_stopping; });
+    }
+}
@@ -0,0 +1,104 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/types.h>
+
+struct TelemetrySample
+{
+    int64_t time;
+    uint64_t cpuTime;
+    uint64_t rss;
+    uint64_t contextSwitches;
+    uint64_t readBytes;
+    uint64_t writeBytes;
+    uint32_t majorFaults;
+    uint32_t threads;
+};
+
+struct TelemetrySeries
+{
+    pid_t pid;
+    std::array<uint8_t, 16> UNON;
+    std::vector<TelemetrySample> samples;
+};
+
+struct CollectorStats
+{
+    uint64_t passes = 0;
+    uint64_t samples = 0;
+    uint64_t fullReads = 0;
+    std::chrono::nanoseconds cpuTime{0};
+    std::chrono::nanoseconds lastPass{0};
+    std::chrono::steady_clock::time_point since = std::chrono::steady_clock::now();
+
+    double cpuLoad() const;
+};
+
+class TelemetryCollector
+{
+public:
+    enum Source {
+        Stat = 1,
+        Io = 2,
+        Schedstat = 4
+    };
+    explicit TelemetryCollector(size_t capacity = 300, unsigned sources = Stat | Io | Schedstat, unsigned refreshPasses = 60);
+    ~TelemetryCollector();
+    TelemetryCollector(const TelemetryCollector&) = delete;
+    TelemetryCollector& operator=(const TelemetryCollector&) = delete;
+    bool track(uint64_t id, pid_t pid, const std::array<uint8_t, 16>& unon = {});
+    void untrack(uint64_t id);
+    bool start(std::chrono::milliseconds interval = std::chrono::seconds(1));
+    void stop();
+    bool isRunning();
+    void collect();
+    bool getSeries(uint64_t id, TelemetrySeries& series);
+    bool getLatest(uint64_t id, TelemetrySample& sample);
+    size_t size();
+    CollectorStats getStats();
+    void resetStats();
+    bool exportBinary(int fd);
+    static bool importBinary(const std::string& data, std::vector<TelemetrySeries>& series);
+    void dumpText(std::ostream& out);
+private:
+    struct Series
+    {
+        uint64_t id;
+        pid_t pid;
+        std::array<uint8_t, 16> UNON;
+        std::array<int, 3> fds;
+        uint64_t runTime;
+        uint64_t slices;
+        size_t next;
+        size_t count;
+        std::vector<TelemetrySample> ring;
+    };
+    bool sample(Series& series, bool refresh);
+    void push(Series& series, const TelemetrySample& sample);
+    void closeFds(Series& series);
+    void copySeries(const Series& from, TelemetrySeries& to);
+    void collectorLoop(std::chrono::milliseconds interval);
+    size_t m_capacity;
+    unsigned m_sources;
+    unsigned m_refreshPasses;
+    std::vector<Series> m_series;
+    std::unordered_map<uint64_t, size_t> m_index;
+    CollectorStats m_stats;
+    std::mutex m_mutex;
+    std::thread m_thread;
+    std::mutex m_threadMutex;
+    std::condition_variable m_wake;
+    bool m_stopping;
+};
+
+#endif // TELEMETRY_H
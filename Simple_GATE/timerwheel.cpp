@@ -0,0 +1,246 @@
+#include "timerwheel.h"
+#include <algorithm>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+TimerWheel::TimerWheel(std::chrono::milliseconds tick)
+    : m_tick(std::max(tick, std::chrono::milliseconds(1))), m_origin(std::chrono::steady_clock::now()),
+      m_fd(timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC)), m_now(0), m_armedTick(UINT64_MAX),
+      m_count(0), m_free(npos), m_occupied{}
+{
+    m_heads.fill(npos);
+}
+
+TimerWheel::~TimerWheel()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+TimerWheel::TimerId TimerWheel::schedule(std::chrono::milliseconds delay, Callback callback)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_count == 0)
+        m_now = std::max(m_now, currentTick());
+    uint32_t index = m_free;
+    if (index != npos) {
+        m_free = m_nodes[index].next;
+    } else {
+        index = static_cast<uint32_t>(m_nodes.size());
+        m_nodes.emplace_back();
+    }
+
+    Node& node = m_nodes[index];
+    node.callback = std::move(callback);
+    node.expires = expiryTick(delay);
+    place(index);
+    ++m_count;
+    if (node.expires < m_armedTick)
+        arm();
+    return static_cast<TimerId>(node.generation) << 32 | (index + 1);
+}
+
+bool TimerWheel::reschedule(TimerId timer, std::chrono::milliseconds delay)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t index = find(timer);
+    if (index == npos)
+        return false;
+
+    unlink(index);
+    m_nodes[index].expires = expiryTick(delay);
+    place(index);
+    if (m_nodes[index].expires < m_armedTick)
+        arm();
+    return true;
+}
+
+bool TimerWheel::cancel(TimerId timer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t index = find(timer);
+    if (index == npos)
+        return false;
+
+    unlink(index);
+    release(index);
+    return true;
+}
+
+bool TimerWheel::isArmed(TimerId timer)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return find(timer) != npos;
+}
+
+size_t TimerWheel::advance()
+{
+    uint64_t expirations;
+    if (read(m_fd, &expirations, sizeof(expirations)) < 0 && m_count == 0)
+        return 0;
+
+    std::vector<Callback> fired;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_armedTick = UINT64_MAX;
+        advanceTo(currentTick());
+        arm();
+        fired.swap(m_fired);
+    }
+    for (auto& callback : fired)
+        callback();
+
+    size_t count = fired.size();
+    fired.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fired.empty())
+        m_fired.swap(fired);
+    return count;
+}
+
+int TimerWheel::getFd()
+{
+    return m_fd;
+}
+
+size_t TimerWheel::size()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count;
+}
+
+std::chrono::milliseconds TimerWheel::getTick()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(m_tick);
+}
+
+uint64_t TimerWheel::currentTick()
+{
+    return static_cast<uint64_t>((std::chrono::steady_clock::now() - m_origin) / m_tick);
+}
+
+uint64_t TimerWheel::expiryTick(std::chrono::milliseconds delay)
+{
+    auto due = std::chrono::steady_clock::now() - m_origin + delay;
+    return std::max(static_cast<uint64_t>((due + m_tick - std::chrono::nanoseconds(1)) / m_tick), m_now + 1);
+}
+
+uint32_t TimerWheel::find(TimerId timer)
+{
+    uint32_t index = static_cast<uint32_t>(timer) - 1;
+    if (timer == invalid || index >= m_nodes.size() || m_nodes[index].generation != timer >> 32 || m_nodes[index].slot == npos)
+        return npos;
+    return index;
+}
+
+void TimerWheel::place(uint32_t index)
+{
+    Node& node = m_nodes[index];
+    uint32_t slot = npos;
+    for (int level = 0; level < levels && slot == npos; ++level) {
+        int shift = level * slotBits;
+        if ((node.expires >> shift) - (m_now >> shift) < slots)
+            slot = level * slots + ((node.expires >> shift) & (slots - 1));
+    }
+    if (slot == npos)
+        slot = (levels - 1) * slots + (((m_now >> ((levels - 1) * slotBits)) + slots - 1) & (slots - 1));
+
+    node.slot = slot;
+    node.previous = npos;
+    node.next = m_heads[slot];
+    if (node.next != npos)
+        m_nodes[node.next].previous = index;
+    m_heads[slot] = index;
+    m_occupied[slot / 64] |= uint64_t(1) << (slot % 64);
+}
+
+void TimerWheel::unlink(uint32_t index)
+{
+    Node& node = m_nodes[index];
+    if (node.previous != npos)
+        m_nodes[node.previous].next = node.next;
+    else
+        m_heads[node.slot] = node.next;
+    if (node.next != npos)
+        m_nodes[node.next].previous = node.previous;
+    if (m_heads[node.slot] == npos)
+        m_occupied[node.slot / 64] &= ~(uint64_t(1) << (node.slot % 64));
+    node.slot = npos;
+}
+
+void TimerWheel::release(uint32_t index)
+{
+    Node& node = m_nodes[index];
+    node.callback = nullptr;
+    ++node.generation;
+    node.next = m_free;
+    m_free = index;
+    --m_count;
+}
+
+void TimerWheel::cascade(int level)
+{
+    uint32_t slot = level * slots + ((m_now >> (level * slotBits)) & (slots - 1));
+    uint32_t index = m_heads[slot];
+    m_heads[slot] = npos;
+    m_occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+    while (index != npos) {
+        uint32_t next = m_nodes[index].next;
+        place(index);
+        index = next;
+    }
+}
+
+void TimerWheel::advanceTo(uint64_t tick)
+{
+    while (m_now < tick && m_count > 0) {
+        m_now = std::min(nextEvent(), tick);
+        if ((m_now & (slots - 1)) == 0) {
+            int top = 1;
+            while (top < levels - 1 && ((m_now >> (top * slotBits)) & (slots - 1)) == 0)
+                ++top;
+            for (int level = top; level > 0; --level)
+                cascade(level);
+        }
+
+        uint32_t slot = m_now & (slots - 1);
+        uint32_t index = m_heads[slot];
+        m_heads[slot] = npos;
+        m_occupied[slot / 64] &= ~(uint64_t(1) << (slot % 64));
+        while (index != npos) {
+            uint32_t next = m_nodes[index].next;
+            m_nodes[index].slot = npos;
+            m_fired.push_back(std::move(m_nodes[index].callback));
+            release(index);
+            index = next;
+        }
+    }
+    m_now = std::max(m_now, tick);
+}
+
+uint64_t TimerWheel::nextEvent()
+{
+    uint32_t position = (m_now & (slots - 1)) + 1;
+    for (uint32_t word = position / 64; word < slots / 64; ++word) {
+        uint64_t bits = m_occupied[word];
+        if (word == position / 64)
+            bits &= position % 64 ? ~uint64_t(0) << (position % 64) : ~uint64_t(0);
+        if (bits)
+            return (m_now & ~uint64_t(slots - 1)) + word * 64 + __builtin_ctzll(bits);
+    }
+    return (m_now | (slots - 1)) + 1;
+}
+
+void TimerWheel::arm()
+{
+    itimerspec value = {};
+    m_armedTick = UINT64_MAX;
+    if (m_count > 0) {
+        m_armedTick = nextEvent();
+        auto at = m_origin.time_since_epoch() + m_tick * m_armedTick;
+        auto seconds = std::chrono::duration_cast<std::chrono::seconds>(at);
+        value.it_value.tv_sec = seconds.count();
+        value.it_value.tv_nsec = std::chrono::duration_cast<std::chrono::nanoseconds>(at - seconds).count();
+    }
+    timerfd_settime(m_fd, TFD_TIMER_ABSTIME, &value, nullptr);
+}
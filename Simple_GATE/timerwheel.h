@@ -0,0 +1,66 @@
+#ifndef TIMERWHEEL_H
+#define TIMERWHEEL_H
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+class TimerWheel
+{
+public:
+    using TimerId = uint64_t;
+    using Callback = std::function<void()>;
+    static constexpr TimerId invalid = 0;
+    explicit TimerWheel(std::chrono::milliseconds tick = std::chrono::milliseconds(10));
+    ~TimerWheel();
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+    TimerId schedule(std::chrono::milliseconds delay, Callback callback);
+    bool reschedule(TimerId timer, std::chrono::milliseconds delay);
+    bool cancel(TimerId timer);
+    bool isArmed(TimerId timer);
+    size_t advance();
+    int getFd();
+    size_t size();
+    std::chrono::milliseconds getTick();
+private:
+    static constexpr int levels = 4;
+    static constexpr int slotBits = 8;
+    static constexpr uint32_t slots = 1 << slotBits;
+    static constexpr uint32_t npos = UINT32_MAX;
+    struct Node
+    {
+        Callback callback;
+        uint64_t expires = 0;
+        uint32_t previous = npos;
+        uint32_t next = npos;
+        uint32_t generation = 0;
+        uint32_t slot = npos;
+    };
+    uint64_t currentTick();
+    uint64_t expiryTick(std::chrono::milliseconds delay);
+    uint32_t find(TimerId timer);
+    void place(uint32_t index);
+    void unlink(uint32_t index);
+    void release(uint32_t index);
+    void cascade(int level);
+    void advanceTo(uint64_t tick);
+    uint64_t nextEvent();
+    void arm();
+    std::chrono::nanoseconds m_tick;
+    std::chrono::steady_clock::time_point m_origin;
+    int m_fd;
+    uint64_t m_now;
+    uint64_t m_armedTick;
+    size_t m_count;
+    std::vector<Node> m_nodes;
+    uint32_t m_free;
+    std::array<uint32_t, levels * slots> m_heads;
+    std::array<uint64_t, levels * slots / 64> m_occupied;
+    std::vector<Callback> m_fired;
+    std::mutex m_mutex;
+};
+
+#endif // TIMERWHEEL_H
@@ -0,0 +1,126 @@
+#include "zygote.h"
+#include "spawner.h"
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+Zygote::Zygote()
+    : m_pid(-1), m_socket(-1)
+{}
+
+Zygote::~Zygote()
+{
+    stop();
+}
+
+bool Zygote::start(const std::string& executablePath)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pid > 0)
+        return false;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) < 0)
+        return false;
+
+    pid_t pid = spawnProcess(executablePath, {"-Z", std::to_string(sv[1])}, {sv[1]}, {});
+    close(sv[1]);
+    if (pid < 0) {
+        close(sv[0]);
+        return false;
+    }
+
+    m_pid = pid;
+    m_socket = sv[0];
+    m_executablePath = executablePath;
+    return true;
+}
+
+void Zygote::stop()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pid <= 0)
+        return;
+
+    close(m_socket);
+    int status;
+    while (waitpid(m_pid, &status, 0) < 0 && errno == EINTR)
+        ;
+    m_socket = -1;
+    m_pid = -1;
+}
+
+bool Zygote::isRunning()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pid > 0;
+}
+
+std::string Zygote::getExecutablePath()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_executablePath;
+}
+
+pid_t Zygote::spawn(const std::vector<std::string>& argv, int sharedFd, int& pidfd)
+{
+    pidfd = -1;
+
+    std::string request;
+    for (auto& arg : argv) {
+        request += arg;
+        request += '\0';
+    }
+
+    int fds[4] = {STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO, sharedFd};
+    int fdCount = sharedFd >= 0 ? 4 : 3;
+    alignas(cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+
+    iovec iov = {request.data(), request.size()};
+    msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = CMSG_SPACE(fdCount * sizeof(int));
+    cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(fdCount * sizeof(int));
+    memcpy(CMSG_DATA(cm), fds, fdCount * sizeof(int));
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pid <= 0) {
+        errno = ESRCH;
+        return -1;
+    }
+    if (sendmsg(m_socket, &msg, MSG_NOSIGNAL) < 0)
+        return -1;
+
+    pid_t pid = -1;
+    alignas(cmsghdr) char replyControl[CMSG_SPACE(sizeof(int))] = {};
+    iovec replyIov = {&pid, sizeof(pid)};
+    msghdr reply = {};
+    reply.msg_iov = &replyIov;
+    reply.msg_iovlen = 1;
+    reply.msg_control = replyControl;
+    reply.msg_controllen = sizeof(replyControl);
+
+    ssize_t received;
+    while ((received = recvmsg(m_socket, &reply, MSG_CMSG_CLOEXEC)) < 0 && errno == EINTR)
+        ;
+    if (received != sizeof(pid)) {
+        errno = EPIPE;
+        return -1;
+    }
+
+    cm = CMSG_FIRSTHDR(&reply);
+    if (cm && cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+        memcpy(&pidfd, CMSG_DATA(cm), sizeof(int));
+    if (pid <= 0) {
+        errno = EAGAIN;
+        return -1;
+    }
+    return pid;
+}
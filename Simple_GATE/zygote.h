@@ -0,0 +1,25 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class Zygote
+{
+public:
+    Zygote();
+    ~Zygote();
+    bool start(const std::string& executablePath);
+    void stop();
+    bool isRunning();
+    std::string getExecutablePath();
+    pid_t spawn(const std::vector<std::string>& argv, int sharedFd, int& pidfd);
+private:
+    pid_t m_pid;
+    int m_socket;
+    std::string m_executablePath;
+    std::mutex m_mutex;
+};
+
+#endif // ZYGOTE_H
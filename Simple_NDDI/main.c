@@ -1,21 +1,105 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include "qe_nddi.h"
 
 qe_args args = {0, 0, 0};
-qe_result __attribute__((section(".v_component"))) result = {QE_NO_RESULT, 0, 0, 0};
+qe_result_v __attribute__((section(".v_component"))) published = {0, {QE_NO_RESULT, 0, 0, 0}};
+qe_result result = {QE_NO_RESULT, 0, 0, 0};
 
 
-int main (){   
-  
+static void usage (const char *prog){
+   fprintf(stderr, "usage: %s [-i | -s] [-f file] [-o file] [-u path | -p port] [-w workers]\n"
+                   "  -i       interactive text mode (default when stdin is a terminal)\n"
+                   "  -s       binary stream mode: packed qe_args in, packed qe_result out\n"
+                   "  -f file  stream records from file (mmap) instead of stdin\n"
+                   "  -o file  write results to file instead of stdout\n"
+                   "  -u path  serve solve requests on a unix socket\n"
+                   "  -p port  serve solve requests on an IPv6 TCP port\n"
+                   "  -w n     server worker threads (default: one per CPU)\n"
+                   "  -Z fd    zygote: fork instances on requests from GATE on socket fd\n", prog);
+}
+
+int main (int argc, char *argv[]){   
+   /* the zygote returns only in a forked child, with that child's arguments */
+   if (argc == 3 && strcmp(argv[1], "-Z") == 0 && qe_zygote(atoi(argv[2]), &argc, &argv) < 0)
+      return 1;
+
+   int interactive = isatty(STDIN_FILENO);
+   const char *in_path = NULL;
+   int out_fd = STDOUT_FILENO;
+   const char *unix_path = NULL;
+   int port = 0;
+   int workers = 0;
+   int opt;
+
+   while ((opt = getopt(argc, argv, "isf:o:u:p:w:h")) != -1){
+      switch (opt){
+         case 'i':
+            interactive = 1;
+            break;
+         case 's':
+            interactive = 0;
+            break;
+         case 'f':
+            in_path = optarg;
+            interactive = 0;
+            break;
+         case 'o':
+            out_fd = open(optarg, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+            if (out_fd < 0){
+               perror(optarg);
+               return 1;
+            }
+            break;
+         case 'u':
+            unix_path = optarg;
+            break;
+         case 'p':
+            port = atoi(optarg);
+            break;
+         case 'w':
+            workers = atoi(optarg);
+            break;
+         default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+      }
+   }
+
+   if (v_component_share() < 0)
+      perror("v_component_share");
+
+   if (unix_path || port){
+      if (qe_server(unix_path, port, workers, &published) < 0){
+         perror("qe_server");
+         return 1;
+      }
+      return 0;
+   }
+
+   if (!interactive){
+      long solved = in_path ? qe_stream_file(in_path, out_fd, &published) : qe_stream(STDIN_FILENO, out_fd, &published);
+      if (solved < 0){
+         perror("qe_stream");
+         return 1;
+      }
+      return 0;
+   }
+
    while (1){
 
       printf("Enter quadratic equation parameters: a, b, c: \n");
-      scanf("%f%f%f", &args.a, &args.b, &args.c );
+      if (scanf("%f%f%f", &args.a, &args.b, &args.c) != 3)
+         return 0;
 
       solve_qe(&args, &result);
-      printf("Struct adress: %p\n", (void*)&result);
-      printf("Flag: %p\n", (void*)&result.flag);
-      printf("Discriminant: %p\n", (void*)&result.d);
+      v_publish(&published.seq, &published.value, &result, sizeof(result));
+      printf("Struct adress: %p\n", (void*)&published.value);
+      printf("Flag: %p\n", (void*)&published.value.flag);
+      printf("Discriminant: %p\n", (void*)&published.value.d);
 
       switch(result.flag){
          case QE_NO_RESULT:
@@ -25,10 +109,10 @@ int main (){
 	    printf("Zero roots\n");
             break;
          case QE_ONE_ROOT:
-	    printf("One root: x1=%f with adress=%p\n", result.x1, (void*)&result.x1);
+	    printf("One root: x1=%f with adress=%p\n", result.x1, (void*)&published.value.x1);
 	    break;
 	 case QE_TWO_ROOTS:
-	    printf("Two roots: x1=%f with adress=%p, x2=%f with adress %p\n", result.x1, (void*)&result.x1, result.x2, (void*)&result.x2);
+	    printf("Two roots: x1=%f with adress=%p, x2=%f with adress %p\n", result.x1, (void*)&published.value.x1, result.x2, (void*)&published.value.x2);
 	    break;
 
 	 default:
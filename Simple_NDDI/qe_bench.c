@@ -0,0 +1,96 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "qe_nddi.h"
+
+/* throughput of solve_qe against the batch kernels, and the results of the kernels
+   checked against the scalar batch path */
+
+#define BENCH_COUNT   (1 << 20)
+#define BENCH_ROUNDS  20
+
+static float rand_coef (void){
+   return (float)rand() / RAND_MAX * 20 - 10;
+}
+
+static double now (void){
+   struct timespec ts;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void alloc_result (qe_result_soa *r, unsigned long n){
+   r->flag = malloc(n * sizeof(int));
+   r->d = malloc(n * sizeof(float));
+   r->x1 = malloc(n * sizeof(float));
+   r->x2 = malloc(n * sizeof(float));
+}
+
+static int close_enough (float x, float y){
+   return x == y || fabsf(x - y) <= 1e-5f * fmaxf(fabsf(x), fabsf(y));
+}
+
+int main (){
+   static const char *names[] = {"scalar", "sse2", "avx2"};
+   unsigned long n = BENCH_COUNT;
+   float *a = malloc(n * sizeof(float));
+   float *b = malloc(n * sizeof(float));
+   float *c = malloc(n * sizeof(float));
+   qe_args *aos = malloc(n * sizeof(qe_args));
+   qe_result one;
+   qe_result_soa ref, out;
+   qe_args_soa args = {a, b, c};
+
+   srand(1);
+   for (unsigned long i = 0; i < n; i++){
+      a[i] = i % 100 == 0 ? 0 : rand_coef();
+      b[i] = i % 100 == 1 ? rand_coef() * 1e4f : rand_coef();
+      c[i] = rand_coef();
+      aos[i].a = a[i];
+      aos[i].b = b[i];
+      aos[i].c = c[i];
+   }
+   alloc_result(&ref, n);
+   alloc_result(&out, n);
+
+   double start = now();
+   float sink = 0;
+   for (int r = 0; r < BENCH_ROUNDS; r++)
+      for (unsigned long i = 0; i < n; i++){
+         solve_qe(&aos[i], &one);
+         sink += one.x1;
+      }
+   double base = (now() - start) / BENCH_ROUNDS;
+   printf("%-8s %8.1f Meq/s\n", "solve_qe", n / base / 1e6);
+
+   solve_qe_batch_isa(&args, &ref, n, QE_ISA_SCALAR);
+   for (int isa = QE_ISA_SCALAR; isa <= qe_batch_isa(); isa++){
+      unsigned long mismatch = 0;
+
+      start = now();
+      for (int r = 0; r < BENCH_ROUNDS; r++)
+         solve_qe_batch_isa(&args, &out, n, isa);
+      double t = (now() - start) / BENCH_ROUNDS;
+
+      for (unsigned long i = 0; i < n; i++)
+         if (out.flag[i] != ref.flag[i] || !close_enough(out.x1[i], ref.x1[i]) || !close_enough(out.x2[i], ref.x2[i]))
+            mismatch++;
+      printf("%-8s %8.1f Meq/s  x%.1f  mismatches %lu\n", names[isa], n / t / 1e6, base / t, mismatch);
+   }
+
+   /* b * b >> 4ac: roots -1e-4 and -1e4 */
+   qe_args wide = {1, 1e4f, 1};
+   float wa = 1, wb = 1e4f, wc = 1;
+   qe_args_soa wide_soa = {&wa, &wb, &wc};
+   int wflag;
+   float wd, wx1, wx2;
+   qe_result_soa wide_out = {&wflag, &wd, &wx1, &wx2};
+
+   solve_qe(&wide, &one);
+   solve_qe_batch(&wide_soa, &wide_out, 1);
+   printf("x^2 + 1e4x + 1: solve_qe x2=%.8g, batch x2=%.8g (exact -1.0000000e-04)\n", one.x2, wx2);
+
+   return sink == 12345 ? 1 : 0;
+}
@@ -1,8 +1,12 @@
+#include "v_component.h"
+
 #define QE_NO_RESULT      0
 #define QE_ZERO_ROOTS     1
 #define QE_ONE_ROOT       2
 #define QE_TWO_ROOTS      3
 
+#define QE_VCOMPONENT_ENV "QE_VCOMPONENT_FD" /* memfd for .v_component, set by GATE */
+
 typedef struct {
    int flag; /* 0 when no result, 1 when 0 roots, 2 when 1 root, 3 when 2 roots */
    float d;
@@ -10,13 +14,50 @@ typedef struct {
    float x2;
 } qe_result; /* quadratic equation result */
 
+typedef V_COMPONENT(qe_result) qe_result_v; /* qe_result published in .v_component */
+
 typedef struct {
    float a;
    float b;
    float c;
 } qe_args; /* quadratic equation arguments */
 
+typedef struct {
+   const float *a;
+   const float *b;
+   const float *c;
+} qe_args_soa; /* arguments of a batch, one array per coefficient */
+
+typedef struct {
+   int *flag;
+   float *d;
+   float *x1;
+   float *x2;
+} qe_result_soa; /* results of a batch */
+
+#define QE_ISA_SCALAR     0
+#define QE_ISA_SSE2       1
+#define QE_ISA_AVX2       2
+
 		/* solve quadratic equation */
 void solve_qe (qe_args *args, qe_result *result);
 float calc_d (qe_args *args);
 
+		/* solve n equations, with the best kernel for this CPU or a given one */
+void solve_qe_batch (const qe_args_soa *args, qe_result_soa *result, unsigned long n);
+void solve_qe_batch_isa (const qe_args_soa *args, qe_result_soa *result, unsigned long n, int isa);
+int qe_batch_isa (void);
+
+		/* binary stream mode, returns the number of equations solved or -1 */
+long qe_stream (int in_fd, int out_fd, qe_result_v *published);
+long qe_stream_file (const char *path, int out_fd, qe_result_v *published);
+
+		/* solve requests from a unix socket (unix_path) or IPv6 port on a worker pool */
+int qe_server (const char *unix_path, int port, int workers, qe_result_v *published);
+
+		/* zygote mode: fork instances on requests from GATE, returns in each child */
+int qe_zygote (int control_fd, int *argc, char ***argv);
+
+		/* map .v_component onto the memfd shared with GATE */
+int v_component_share (void);
+
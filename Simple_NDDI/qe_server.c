@@ -0,0 +1,354 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "qe_nddi.h"
+
+/* server mode: requests are a uint32 count followed by count packed qe_args,
+   the reply is count packed qe_result. one thread reads all connections with epoll
+   and cuts requests into tasks of up to QE_TASK_SIZE equations; tasks go round robin
+   to per-worker queues, an idle worker steals from the others. the worker finishing
+   the last task of a request sends every finished request at the head of its
+   connection, so replies keep the request order */
+
+#define QE_TASK_SIZE      1024
+#define QE_QUEUE_SIZE     4096
+#define QE_MAX_WORKERS    256
+#define QE_MAX_REQUEST    (1 << 20)
+
+struct qe_conn;
+
+struct qe_request {
+   struct qe_conn *conn;
+   struct qe_request *next;
+   uint32_t count;
+   uint32_t remaining;   /* tasks not solved yet */
+   int done;
+   qe_args *args;
+   qe_result *results;
+};
+
+struct qe_conn {
+   int fd;
+   int refs;             /* reader + unanswered requests */
+   pthread_mutex_t lock;
+   struct qe_request *head, *tail;   /* requests in arrival order */
+   struct qe_request *reading;       /* request being received */
+   uint32_t header;
+   size_t got;
+};
+
+struct qe_task {
+   struct qe_request *req;
+   uint32_t offset;
+   uint32_t count;
+};
+
+struct qe_queue {
+   pthread_mutex_t lock;
+   struct qe_task tasks[QE_QUEUE_SIZE];
+   unsigned head, tail;   /* owner takes from head, thieves from tail */
+};
+
+/* on the heap: .bss follows .v_component at 0x20000 and must stay below the text segment */
+static struct qe_queue *queues;
+static int worker_count;
+static sem_t tasks_ready;
+static sem_t slots_free;
+static qe_result_v *server_published;
+static pthread_mutex_t publish_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static void conn_put (struct qe_conn *conn){
+   pthread_mutex_lock(&conn->lock);
+   int refs = --conn->refs;
+   pthread_mutex_unlock(&conn->lock);
+
+   if (refs == 0){
+      close(conn->fd);
+      pthread_mutex_destroy(&conn->lock);
+      free(conn);
+   }
+}
+
+static int send_all (int fd, const void *buf, size_t len){
+   const char *p = buf;
+
+   while (len > 0){
+      ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+      if (n < 0){
+         if (errno == EINTR)
+            continue;
+         return -1;
+      }
+      p += n;
+      len -= n;
+   }
+   return 0;
+}
+
+/* send the finished requests at the head of the connection */
+static void request_finish (struct qe_request *req){
+   struct qe_conn *conn = req->conn;
+   int answered = 0;
+
+   pthread_mutex_lock(&conn->lock);
+   req->done = 1;
+   while (conn->head && conn->head->done){
+      struct qe_request *r = conn->head;
+      conn->head = r->next;
+      if (conn->head == NULL)
+         conn->tail = NULL;
+      send_all(conn->fd, r->results, (size_t)r->count * sizeof(qe_result));
+      free(r->args);
+      free(r->results);
+      free(r);
+      answered++;
+   }
+   pthread_mutex_unlock(&conn->lock);
+
+   while (answered--)
+      conn_put(conn);
+}
+
+static void queue_push (int worker, struct qe_task task){
+   struct qe_queue *q = &queues[worker];
+
+   sem_wait(&slots_free);
+   pthread_mutex_lock(&q->lock);
+   q->tasks[q->tail++ % QE_QUEUE_SIZE] = task;
+   pthread_mutex_unlock(&q->lock);
+   sem_post(&tasks_ready);
+}
+
+static int queue_take (struct qe_queue *q, struct qe_task *task, int steal){
+   int found = 0;
+
+   pthread_mutex_lock(&q->lock);
+   if (q->head != q->tail){
+      *task = steal ? q->tasks[--q->tail % QE_QUEUE_SIZE] : q->tasks[q->head++ % QE_QUEUE_SIZE];
+      found = 1;
+   }
+   pthread_mutex_unlock(&q->lock);
+   return found;
+}
+
+static void *worker_loop (void *arg){
+   int id = (int)(intptr_t)arg;
+   static __thread float a[QE_TASK_SIZE], b[QE_TASK_SIZE], c[QE_TASK_SIZE];
+   static __thread float d[QE_TASK_SIZE], x1[QE_TASK_SIZE], x2[QE_TASK_SIZE];
+   static __thread int flag[QE_TASK_SIZE];
+   qe_args_soa args = {a, b, c};
+   qe_result_soa res = {flag, d, x1, x2};
+
+   for (;;){
+      struct qe_task task;
+
+      /* a post on tasks_ready means a task is queued somewhere, so the search always ends */
+      sem_wait(&tasks_ready);
+      for (int i = 0; !queue_take(&queues[(id + i) % worker_count], &task, i != 0); i = (i + 1) % worker_count)
+         ;
+      sem_post(&slots_free);
+
+      const qe_args *in = task.req->args + task.offset;
+      qe_result *out = task.req->results + task.offset;
+      for (uint32_t i = 0; i < task.count; i++){
+         a[i] = in[i].a;
+         b[i] = in[i].b;
+         c[i] = in[i].c;
+      }
+      solve_qe_batch(&args, &res, task.count);
+      for (uint32_t i = 0; i < task.count; i++){
+         out[i].flag = flag[i];
+         out[i].d = d[i];
+         out[i].x1 = x1[i];
+         out[i].x2 = x2[i];
+      }
+
+      /* .v_component has a single writer: a worker that finds it busy skips publishing */
+      if (server_published && pthread_mutex_trylock(&publish_lock) == 0){
+         v_publish(&server_published->seq, &server_published->value, &out[task.count - 1], sizeof(qe_result));
+         pthread_mutex_unlock(&publish_lock);
+      }
+
+      if (__atomic_sub_fetch(&task.req->remaining, 1, __ATOMIC_ACQ_REL) == 0)
+         request_finish(task.req);
+   }
+   return NULL;
+}
+
+/* queue a fully received request */
+static void request_submit (struct qe_conn *conn, struct qe_request *req){
+   static int next_worker;
+
+   req->remaining = (req->count + QE_TASK_SIZE - 1) / QE_TASK_SIZE;
+
+   pthread_mutex_lock(&conn->lock);
+   conn->refs++;
+   if (conn->tail)
+      conn->tail->next = req;
+   else
+      conn->head = req;
+   conn->tail = req;
+   pthread_mutex_unlock(&conn->lock);
+
+   if (req->count == 0){
+      request_finish(req);
+      return;
+   }
+   for (uint32_t off = 0; off < req->count; off += QE_TASK_SIZE){
+      struct qe_task task = {req, off, req->count - off < QE_TASK_SIZE ? req->count - off : QE_TASK_SIZE};
+      queue_push(next_worker, task);
+      next_worker = (next_worker + 1) % worker_count;
+   }
+}
+
+/* read what is available; returns -1 when the connection is finished */
+static int conn_read (struct qe_conn *conn){
+   for (;;){
+      char *dst;
+      size_t want;
+
+      if (conn->reading == NULL){
+         dst = (char *)&conn->header + conn->got;
+         want = sizeof(conn->header) - conn->got;
+      } else {
+         dst = (char *)conn->reading->args + conn->got;
+         want = (size_t)conn->reading->count * sizeof(qe_args) - conn->got;
+      }
+
+      ssize_t n = want ? recv(conn->fd, dst, want, MSG_DONTWAIT) : 0;
+      if (n < 0)
+         return errno == EAGAIN || errno == EINTR ? 0 : -1;
+      if (n == 0 && want)
+         return -1;
+      conn->got += n;
+      if (conn->got < (conn->reading ? (size_t)conn->reading->count * sizeof(qe_args) : sizeof(conn->header)))
+         continue;
+
+      if (conn->reading == NULL){
+         if (conn->header > QE_MAX_REQUEST)
+            return -1;
+         struct qe_request *req = calloc(1, sizeof(*req));
+         req->conn = conn;
+         req->count = conn->header;
+         req->args = malloc((size_t)req->count * sizeof(qe_args) + 1);
+         req->results = malloc((size_t)req->count * sizeof(qe_result) + 1);
+         conn->reading = req;
+      } else {
+         request_submit(conn, conn->reading);
+         conn->reading = NULL;
+      }
+      conn->got = 0;
+   }
+}
+
+static int open_listener (const char *unix_path, int port){
+   int fd;
+
+   if (unix_path){
+      struct sockaddr_un addr;
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sun_family = AF_UNIX;
+      strncpy(addr.sun_path, unix_path, sizeof(addr.sun_path) - 1);
+      unlink(unix_path);
+      fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0 || bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+         return -1;
+   } else {
+      struct sockaddr_in6 addr;
+      int one = 1;
+
+      memset(&addr, 0, sizeof(addr));
+      addr.sin6_family = AF_INET6;
+      addr.sin6_addr = in6addr_any;
+      addr.sin6_port = htons(port);
+      fd = socket(AF_INET6, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd < 0)
+         return -1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+         return -1;
+   }
+   return listen(fd, SOMAXCONN) < 0 ? -1 : fd;
+}
+
+int qe_server (const char *unix_path, int port, int workers, qe_result_v *published){
+   struct epoll_event ev, events[64];
+   pthread_t thread;
+
+   if (workers <= 0)
+      workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   worker_count = workers < 1 ? 1 : workers > QE_MAX_WORKERS ? QE_MAX_WORKERS : workers;
+   server_published = published;
+
+   int listen_fd = open_listener(unix_path, port);
+   int epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+   if (listen_fd < 0 || epoll_fd < 0)
+      return -1;
+
+   queues = calloc(worker_count, sizeof(*queues));
+   if (queues == NULL)
+      return -1;
+   sem_init(&tasks_ready, 0, 0);
+   sem_init(&slots_free, 0, QE_QUEUE_SIZE);
+   for (int i = 0; i < worker_count; i++){
+      pthread_mutex_init(&queues[i].lock, NULL);
+      if (pthread_create(&thread, NULL, worker_loop, (void *)(intptr_t)i) != 0)
+         return -1;
+      pthread_detach(thread);
+   }
+
+   ev.events = EPOLLIN;
+   ev.data.ptr = NULL;
+   epoll_ctl(epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+   if (unix_path)
+      fprintf(stderr, "qe_server: unix:%s, %d workers\n", unix_path, worker_count);
+   else
+      fprintf(stderr, "qe_server: [::]:%d, %d workers\n", port, worker_count);
+
+   for (;;){
+      int n = epoll_wait(epoll_fd, events, 64, -1);
+      if (n < 0 && errno != EINTR)
+         return -1;
+
+      for (int i = 0; i < n; i++){
+         struct qe_conn *conn = events[i].data.ptr;
+
+         if (conn == NULL){
+            int fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+            if (fd < 0)
+               continue;
+            conn = calloc(1, sizeof(*conn));
+            conn->fd = fd;
+            conn->refs = 1;
+            pthread_mutex_init(&conn->lock, NULL);
+            ev.events = EPOLLIN | EPOLLRDHUP;
+            ev.data.ptr = conn;
+            epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+            continue;
+         }
+
+         if (conn_read(conn) < 0){
+            /* unanswered requests keep the socket open until their replies are sent */
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+            if (conn->reading){
+               free(conn->reading->args);
+               free(conn->reading->results);
+               free(conn->reading);
+            }
+            conn_put(conn);
+         }
+      }
+   }
+}
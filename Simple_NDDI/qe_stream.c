@@ -0,0 +1,133 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "qe_nddi.h"
+
+/* binary stream mode: packed qe_args records in, packed qe_result records out,
+   solved QE_STREAM_CHUNK at a time with solve_qe_batch */
+
+#define QE_STREAM_CHUNK 8192
+
+static float a[QE_STREAM_CHUNK], b[QE_STREAM_CHUNK], c[QE_STREAM_CHUNK];
+static int flag[QE_STREAM_CHUNK];
+static float d[QE_STREAM_CHUNK], x1[QE_STREAM_CHUNK], x2[QE_STREAM_CHUNK];
+static qe_result out[QE_STREAM_CHUNK];
+
+static int write_all (int fd, const void *buf, size_t len){
+   const char *p = buf;
+
+   while (len > 0){
+      ssize_t n = write(fd, p, len);
+      if (n < 0){
+         if (errno == EINTR)
+            continue;
+         return -1;
+      }
+      p += n;
+      len -= n;
+   }
+   return 0;
+}
+
+/* solve n records and write the results, the last one is published for GATE */
+static int solve_chunk (const qe_args *in, size_t n, int out_fd, qe_result_v *published){
+   qe_args_soa args = {a, b, c};
+   qe_result_soa res = {flag, d, x1, x2};
+
+   for (size_t i = 0; i < n; i++){
+      a[i] = in[i].a;
+      b[i] = in[i].b;
+      c[i] = in[i].c;
+   }
+   solve_qe_batch(&args, &res, n);
+   for (size_t i = 0; i < n; i++){
+      out[i].flag = flag[i];
+      out[i].d = d[i];
+      out[i].x1 = x1[i];
+      out[i].x2 = x2[i];
+   }
+
+   if (published && n > 0)
+      v_publish(&published->seq, &published->value, &out[n - 1], sizeof(qe_result));
+   return write_all(out_fd, out, n * sizeof(qe_result));
+}
+
+/* records from a pipe or socket; a trailing partial record is an error */
+long qe_stream (int in_fd, int out_fd, qe_result_v *published){
+   static qe_args in[QE_STREAM_CHUNK];
+   size_t filled = 0;
+   long total = 0;
+
+   for (;;){
+      ssize_t n = read(in_fd, (char *)in + filled, sizeof(in) - filled);
+      if (n < 0){
+         if (errno == EINTR)
+            continue;
+         return -1;
+      }
+      if (n == 0)
+         break;
+      filled += n;
+
+      /* every complete record read so far is answered, a producer waiting for results does not stall */
+      size_t records = filled / sizeof(qe_args);
+      if (records == 0)
+         continue;
+      if (solve_chunk(in, records, out_fd, published) < 0)
+         return -1;
+      total += records;
+
+      size_t rest = filled - records * sizeof(qe_args);
+      memmove(in, (char *)in + records * sizeof(qe_args), rest);
+      filled = rest;
+   }
+
+   if (filled){
+      errno = EINVAL;
+      return -1;
+   }
+   return total;
+}
+
+/* records from a file, solved in place from a read-only mapping */
+long qe_stream_file (const char *path, int out_fd, qe_result_v *published){
+   struct stat st;
+   int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+   if (fd < 0)
+      return -1;
+   if (fstat(fd, &st) < 0){
+      close(fd);
+      return -1;
+   }
+   if (st.st_size == 0){
+      close(fd);
+      return 0;
+   }
+
+   const qe_args *in = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (in == MAP_FAILED)
+      return -1;
+   madvise((void *)in, st.st_size, MADV_SEQUENTIAL);
+
+   long total = st.st_size / sizeof(qe_args);
+   long rc = total;
+   for (long i = 0; i < total; i += QE_STREAM_CHUNK){
+      size_t n = total - i < QE_STREAM_CHUNK ? total - i : QE_STREAM_CHUNK;
+      if (solve_chunk(in + i, n, out_fd, published) < 0){
+         rc = -1;
+         break;
+      }
+   }
+
+   munmap((void *)in, st.st_size);
+   if (rc >= 0 && st.st_size % sizeof(qe_args)){
+      errno = EINVAL;
+      rc = -1;
+   }
+   return rc;
+}
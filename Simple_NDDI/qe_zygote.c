@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "qe_nddi.h"
+
+/* zygote mode (-Z fd): the solver is started once by GATE, loaded and warmed up, then
+   forks ready-to-run children on request. a request on the SOCK_SEQPACKET control
+   socket carries the child's argv as NUL separated strings and, as SCM_RIGHTS, its
+   stdin, stdout, stderr and optionally the .v_component memfd. the reply is the child
+   pid with a pidfd for it, since the child is not a child of GATE */
+
+#define QE_ZYGOTE_ARGS   4096
+#define QE_ZYGOTE_FDS    4
+
+static void warm_up (void){
+   float a[16], b[16], c[16], d[16], x1[16], x2[16];
+   int flag[16];
+   qe_args_soa args = {a, b, c};
+   qe_result_soa res = {flag, d, x1, x2};
+
+   for (int i = 0; i < 16; i++){
+      a[i] = 1;
+      b[i] = -i;
+      c[i] = i;
+   }
+   solve_qe_batch(&args, &res, 16);
+}
+
+static void reap_children (int sig){
+   int saved = errno;
+
+   (void)sig;
+   while (waitpid(-1, NULL, WNOHANG) > 0)
+      ;
+   errno = saved;
+}
+
+static void reply (int control_fd, pid_t pid, int pidfd){
+   char cmsg_buf[CMSG_SPACE(sizeof(int))];
+   struct iovec iov = {&pid, sizeof(pid)};
+   struct msghdr msg;
+
+   memset(&msg, 0, sizeof(msg));
+   msg.msg_iov = &iov;
+   msg.msg_iovlen = 1;
+   if (pidfd >= 0){
+      msg.msg_control = cmsg_buf;
+      msg.msg_controllen = sizeof(cmsg_buf);
+      struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+      cm->cmsg_level = SOL_SOCKET;
+      cm->cmsg_type = SCM_RIGHTS;
+      cm->cmsg_len = CMSG_LEN(sizeof(int));
+      memcpy(CMSG_DATA(cm), &pidfd, sizeof(int));
+   }
+   sendmsg(control_fd, &msg, MSG_NOSIGNAL);
+}
+
+/* returns only in a forked child, with argc/argv replaced by the requested ones */
+int qe_zygote (int control_fd, int *argc, char ***argv){
+   static char args[QE_ZYGOTE_ARGS];
+   char cmsg_buf[CMSG_SPACE(QE_ZYGOTE_FDS * sizeof(int))];
+   sigset_t chld, old_mask;
+
+   /* GATE follows the children through their pidfds; SIGCHLD is blocked from fork
+      until the pidfd is open, so a child exiting at once is not reaped before that */
+   sigemptyset(&chld);
+   sigaddset(&chld, SIGCHLD);
+   signal(SIGCHLD, reap_children);
+   warm_up();
+
+   for (;;){
+      struct iovec iov = {args, sizeof(args) - 1};
+      struct msghdr msg;
+      int fds[QE_ZYGOTE_FDS];
+      int nfds = 0;
+
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = &iov;
+      msg.msg_iovlen = 1;
+      msg.msg_control = cmsg_buf;
+      msg.msg_controllen = sizeof(cmsg_buf);
+
+      ssize_t len = recvmsg(control_fd, &msg, MSG_CMSG_CLOEXEC);
+      if (len < 0 && errno == EINTR)
+         continue;
+      if (len <= 0)
+         exit(0);
+      args[len] = '\0';
+
+      for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm))
+         if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS){
+            nfds = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            memcpy(fds, CMSG_DATA(cm), nfds * sizeof(int));
+         }
+
+      sigprocmask(SIG_BLOCK, &chld, &old_mask);
+      pid_t pid = nfds >= 3 ? fork() : -1;
+      if (pid == 0){
+         char **child_argv = calloc(len + 2, sizeof(char *));
+         int child_argc = 0;
+
+         signal(SIGCHLD, SIG_DFL);
+         sigprocmask(SIG_SETMASK, &old_mask, NULL);
+         close(control_fd);
+         for (int i = 0; i < 3; i++)
+            dup2(fds[i], i);
+         if (nfds > 3){
+            char env[16];
+            int shared = dup(fds[3]);
+            snprintf(env, sizeof(env), "%d", shared);
+            setenv(QE_VCOMPONENT_ENV, env, 1);
+         }
+         for (int i = 0; i < nfds; i++)
+            if (fds[i] > 2)
+               close(fds[i]);
+
+         for (char *p = args; p < args + len; p += strlen(p) + 1)
+            child_argv[child_argc++] = p;
+         *argc = child_argc;
+         *argv = child_argv;
+         return 0;
+      }
+
+      int pidfd = pid > 0 ? (int)syscall(SYS_pidfd_open, pid, 0) : -1;
+      sigprocmask(SIG_SETMASK, &old_mask, NULL);
+      reply(control_fd, pid, pidfd);
+      if (pidfd >= 0)
+         close(pidfd);
+      for (int i = 0; i < nfds; i++)
+         close(fds[i]);
+   }
+}
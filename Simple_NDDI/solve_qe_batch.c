@@ -0,0 +1,163 @@
+#include "qe_nddi.h"
+#include <math.h>
+#include <immintrin.h>
+
+/* batch solver over structure-of-arrays coefficients.
+   roots use the stable form q = -(b + sign(b) * sqrt(d)) / 2, x = q / a and c / q,
+   so the smaller root is not lost to cancellation when b * b >> 4ac.
+   a == 0 is solved as the linear equation bx + c = 0 (QE_NO_RESULT when b == 0 too).
+   flags and roots are selected with masks, there are no branches on d */
+
+static void solve_one (float a, float b, float c, int *flag, float *d, float *x1, float *x2){
+   float disc = b * b - 4 * a * c;
+   float s = sqrtf(fmaxf(disc, 0));
+   float q = -0.5f * (b + copysignf(s, b));
+
+   *d = disc;
+   if (a == 0){
+      *flag = b != 0 ? QE_ONE_ROOT : QE_NO_RESULT;
+      *x1 = b != 0 ? -c / b : 0;
+      *x2 = *x1;
+   } else if (disc > 0){
+      *flag = QE_TWO_ROOTS;
+      *x1 = signbit(b) ? c / q : q / a;
+      *x2 = signbit(b) ? q / a : c / q;
+   } else if (disc == 0){
+      *flag = QE_ONE_ROOT;
+      *x1 = -b / (2 * a);
+      *x2 = *x1;
+   } else {
+      *flag = QE_ZERO_ROOTS;
+      *x1 = 0;
+      *x2 = 0;
+   }
+}
+
+static void solve_scalar (const qe_args_soa *args, qe_result_soa *result, unsigned long from, unsigned long n){
+   for (unsigned long i = from; i < n; i++)
+      solve_one(args->a[i], args->b[i], args->c[i], &result->flag[i], &result->d[i], &result->x1[i], &result->x2[i]);
+}
+
+static void solve_sse2 (const qe_args_soa *args, qe_result_soa *result, unsigned long n){
+   const __m128 zero = _mm_setzero_ps();
+   const __m128 four = _mm_set1_ps(4);
+   const __m128 half = _mm_set1_ps(-0.5f);
+   const __m128 sign = _mm_set1_ps(-0.0f);
+   unsigned long i;
+
+   for (i = 0; i + 4 <= n; i += 4){
+      __m128 a = _mm_loadu_ps(args->a + i);
+      __m128 b = _mm_loadu_ps(args->b + i);
+      __m128 c = _mm_loadu_ps(args->c + i);
+
+      __m128 d = _mm_sub_ps(_mm_mul_ps(b, b), _mm_mul_ps(four, _mm_mul_ps(a, c)));
+      __m128 s = _mm_sqrt_ps(_mm_max_ps(d, zero));
+      __m128 q = _mm_mul_ps(half, _mm_add_ps(b, _mm_or_ps(s, _mm_and_ps(b, sign))));
+      __m128 qa = _mm_div_ps(q, a);
+      __m128 cq = _mm_div_ps(c, q);
+      __m128 one = _mm_div_ps(_mm_xor_ps(b, sign), _mm_add_ps(a, a));
+      __m128 lin = _mm_div_ps(_mm_xor_ps(c, sign), b);
+
+      __m128 b_neg = _mm_castsi128_ps(_mm_srai_epi32(_mm_castps_si128(b), 31));
+      __m128 d_ge = _mm_cmpge_ps(d, zero);
+      __m128 d_gt = _mm_cmpgt_ps(d, zero);
+      __m128 a_zero = _mm_cmpeq_ps(a, zero);
+      __m128 b_nonzero = _mm_cmpneq_ps(b, zero);
+
+      /* two roots, replaced by the double root where d == 0 */
+      __m128 x1 = _mm_or_ps(_mm_and_ps(b_neg, cq), _mm_andnot_ps(b_neg, qa));
+      __m128 x2 = _mm_or_ps(_mm_and_ps(b_neg, qa), _mm_andnot_ps(b_neg, cq));
+      x1 = _mm_or_ps(_mm_and_ps(d_gt, x1), _mm_andnot_ps(d_gt, one));
+      x2 = _mm_or_ps(_mm_and_ps(d_gt, x2), _mm_andnot_ps(d_gt, one));
+      x1 = _mm_and_ps(d_ge, x1);
+      x2 = _mm_and_ps(d_ge, x2);
+      /* linear equation where a == 0 */
+      lin = _mm_and_ps(b_nonzero, lin);
+      x1 = _mm_or_ps(_mm_and_ps(a_zero, lin), _mm_andnot_ps(a_zero, x1));
+      x2 = _mm_or_ps(_mm_and_ps(a_zero, lin), _mm_andnot_ps(a_zero, x2));
+
+      /* QE_ZERO_ROOTS + (d >= 0) + (d > 0); masks are -1 */
+      __m128i flag = _mm_sub_epi32(_mm_sub_epi32(_mm_set1_epi32(QE_ZERO_ROOTS), _mm_castps_si128(d_ge)), _mm_castps_si128(d_gt));
+      __m128i lin_flag = _mm_and_si128(_mm_castps_si128(b_nonzero), _mm_set1_epi32(QE_ONE_ROOT));
+      flag = _mm_or_si128(_mm_and_si128(_mm_castps_si128(a_zero), lin_flag), _mm_andnot_si128(_mm_castps_si128(a_zero), flag));
+
+      _mm_storeu_si128((__m128i *)(result->flag + i), flag);
+      _mm_storeu_ps(result->d + i, d);
+      _mm_storeu_ps(result->x1 + i, x1);
+      _mm_storeu_ps(result->x2 + i, x2);
+   }
+   solve_scalar(args, result, i, n);
+}
+
+__attribute__((target("avx2")))
+static void solve_avx2 (const qe_args_soa *args, qe_result_soa *result, unsigned long n){
+   const __m256 zero = _mm256_setzero_ps();
+   const __m256 four = _mm256_set1_ps(4);
+   const __m256 half = _mm256_set1_ps(-0.5f);
+   const __m256 sign = _mm256_set1_ps(-0.0f);
+   unsigned long i;
+
+   for (i = 0; i + 8 <= n; i += 8){
+      __m256 a = _mm256_loadu_ps(args->a + i);
+      __m256 b = _mm256_loadu_ps(args->b + i);
+      __m256 c = _mm256_loadu_ps(args->c + i);
+
+      __m256 d = _mm256_sub_ps(_mm256_mul_ps(b, b), _mm256_mul_ps(four, _mm256_mul_ps(a, c)));
+      __m256 s = _mm256_sqrt_ps(_mm256_max_ps(d, zero));
+      __m256 q = _mm256_mul_ps(half, _mm256_add_ps(b, _mm256_or_ps(s, _mm256_and_ps(b, sign))));
+      __m256 qa = _mm256_div_ps(q, a);
+      __m256 cq = _mm256_div_ps(c, q);
+      __m256 one = _mm256_div_ps(_mm256_xor_ps(b, sign), _mm256_add_ps(a, a));
+      __m256 lin = _mm256_div_ps(_mm256_xor_ps(c, sign), b);
+
+      __m256 b_neg = _mm256_castsi256_ps(_mm256_srai_epi32(_mm256_castps_si256(b), 31));
+      __m256 d_ge = _mm256_cmp_ps(d, zero, _CMP_GE_OQ);
+      __m256 d_gt = _mm256_cmp_ps(d, zero, _CMP_GT_OQ);
+      __m256 a_zero = _mm256_cmp_ps(a, zero, _CMP_EQ_OQ);
+      __m256 b_nonzero = _mm256_cmp_ps(b, zero, _CMP_NEQ_UQ);
+
+      __m256 x1 = _mm256_blendv_ps(qa, cq, b_neg);
+      __m256 x2 = _mm256_blendv_ps(cq, qa, b_neg);
+      x1 = _mm256_and_ps(d_ge, _mm256_blendv_ps(one, x1, d_gt));
+      x2 = _mm256_and_ps(d_ge, _mm256_blendv_ps(one, x2, d_gt));
+      lin = _mm256_and_ps(b_nonzero, lin);
+      x1 = _mm256_blendv_ps(x1, lin, a_zero);
+      x2 = _mm256_blendv_ps(x2, lin, a_zero);
+
+      __m256i flag = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_set1_epi32(QE_ZERO_ROOTS), _mm256_castps_si256(d_ge)), _mm256_castps_si256(d_gt));
+      __m256i lin_flag = _mm256_and_si256(_mm256_castps_si256(b_nonzero), _mm256_set1_epi32(QE_ONE_ROOT));
+      flag = _mm256_blendv_epi8(flag, lin_flag, _mm256_castps_si256(a_zero));
+
+      _mm256_storeu_si256((__m256i *)(result->flag + i), flag);
+      _mm256_storeu_ps(result->d + i, d);
+      _mm256_storeu_ps(result->x1 + i, x1);
+      _mm256_storeu_ps(result->x2 + i, x2);
+   }
+   solve_scalar(args, result, i, n);
+}
+
+int qe_batch_isa (void){
+   static int isa = -1;
+
+   if (isa < 0)
+      isa = __builtin_cpu_supports("avx2") ? QE_ISA_AVX2 : QE_ISA_SSE2;
+   return isa;
+}
+
+void solve_qe_batch_isa (const qe_args_soa *args, qe_result_soa *result, unsigned long n, int isa){
+   switch (isa){
+      case QE_ISA_AVX2:
+         solve_avx2(args, result, n);
+         break;
+      case QE_ISA_SSE2:
+         solve_sse2(args, result, n);
+         break;
+      default:
+         solve_scalar(args, result, 0, n);
+         break;
+   }
+}
+
+void solve_qe_batch (const qe_args_soa *args, qe_result_soa *result, unsigned long n){
+   solve_qe_batch_isa(args, result, n, qe_batch_isa());
+}
@@ -0,0 +1,39 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "qe_nddi.h"
+
+extern char __v_component_start[];
+extern char __v_component_end[];
+
+/* back .v_component with the memfd passed by GATE in QE_VCOMPONENT_FD,
+   keeping the fixed address from linker.ld; returns 0 when shared or not requested */
+int v_component_share (void){
+   const char *env = getenv(QE_VCOMPONENT_ENV);
+   size_t size = __v_component_end - __v_component_start;
+   struct stat st;
+   char *end;
+
+   if (env == NULL)
+      return 0;
+
+   int fd = (int)strtol(env, &end, 10);
+   unsetenv(QE_VCOMPONENT_ENV);
+   if (*env == '\0' || *end != '\0' || fd < 0)
+      return -1;
+
+   /* current contents (initialized values) go to the memfd before it replaces the pages;
+      the memfd is only grown, GATE may have mapped more than the section */
+   if (fstat(fd, &st) < 0 || ((size_t)st.st_size < size && ftruncate(fd, size) < 0) ||
+       pwrite(fd, __v_component_start, size, 0) != (ssize_t)size){
+      close(fd);
+      return -1;
+   }
+
+   void *mapped = mmap(__v_component_start, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+   close(fd);
+   return mapped == MAP_FAILED ? -1 : 0;
+}
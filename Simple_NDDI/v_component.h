@@ -0,0 +1,51 @@
+#ifndef V_COMPONENT_H
+#define V_COMPONENT_H
+
+/* seqlock publication for .v_component structs shared with GATE:
+   seq is odd while the writer updates value, readers copy value and retry
+   until they see the same even seq before and after the copy;
+   value sizes are multiples of 4 bytes */
+
+#define V_COMPONENT(type) struct { unsigned int seq; type value; }
+
+#define V_SEQ_OFFSET    0
+#define V_VALUE_OFFSET  4
+
+static inline void v_publish (unsigned int *seq, void *dst, const void *src, unsigned long size){
+   unsigned int *to = (unsigned int *)dst;
+   const unsigned int *from = (const unsigned int *)src;
+   unsigned int s = __atomic_load_n(seq, __ATOMIC_RELAXED);
+
+   __atomic_store_n(seq, s + 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   for (unsigned long i = 0; i < size / sizeof(unsigned int); i++)
+      __atomic_store_n(&to[i], from[i], __ATOMIC_RELAXED);
+   __atomic_store_n(seq, s + 2, __ATOMIC_RELEASE);
+}
+
+static inline unsigned int v_read_begin (const unsigned int *seq){
+   return __atomic_load_n(seq, __ATOMIC_ACQUIRE);
+}
+
+/* nonzero when the copy made after v_read_begin may be torn */
+static inline int v_read_retry (const unsigned int *seq, unsigned int start){
+   __atomic_thread_fence(__ATOMIC_ACQUIRE);
+   return (start & 1) || __atomic_load_n(seq, __ATOMIC_RELAXED) != start;
+}
+
+/* consistent copy of value into dst, gives up after tries attempts (writer stopped mid-update) */
+static inline int v_snapshot (const unsigned int *seq, void *dst, const void *src, unsigned long size, int tries){
+   unsigned int *to = (unsigned int *)dst;
+   const unsigned int *from = (const unsigned int *)src;
+
+   while (tries-- > 0){
+      unsigned int s = v_read_begin(seq);
+      for (unsigned long i = 0; i < size / sizeof(unsigned int); i++)
+         to[i] = __atomic_load_n(&from[i], __ATOMIC_RELAXED);
+      if (!v_read_retry(seq, s))
+         return 1;
+   }
+   return 0;
+}
+
+#endif